@@ -0,0 +1,283 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// ConnectionChurn is a benchmark that opens and closes many short TCP
+// connections for a fixed time, at a fixed rate, and then reports how the
+// connection blocks (PCBs) held up. It connects to a server on the same
+// device, so no other hosts are needed.
+//
+// Each connection works like a small HTTP request: the server sends one byte
+// and closes first, so its side of the connection stays in TIME_WAIT. At
+// rates of a thousand or more connections a minute, this uses up all the PCBs
+// long before the TIME_WAIT connections expire.
+//
+// The TIME_WAIT policy, QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY, must be
+// enabled to get the exhaustion and recycle counts. Connecting to the local
+// address also needs LWIP_NETIF_LOOPBACK to be enabled.
+//
+// This file is part of the QNEthernet library.
+
+// C++ includes
+#include <cinttypes>
+
+#include <QNEthernet.h>
+
+using namespace qindesign::network;
+
+// --------------------------------------------------------------------------
+//  Configuration
+// --------------------------------------------------------------------------
+
+constexpr uint16_t kPort = 5002;
+
+constexpr uint32_t kDuration = 60'000;             // How long to run, in ms
+constexpr uint32_t kConnectionsPerMinute = 1200;   // Target rate
+constexpr uint32_t kConnectionTimeout = 5'000;     // Per connection, in ms
+constexpr uint32_t kReportInterval = 10'000;       // Progress reports, in ms
+
+// The number of connections that can be in progress at the same time.
+constexpr size_t kMaxInFlight = 4;
+
+namespace {  // Internal linkage section
+
+// Set these to something to use a static IP instead of one from DHCP
+const IPAddress kStaticIP;//{192, 168, 1, 101};
+const IPAddress kSubnet{255, 255, 255, 0};
+const IPAddress kGateway{192, 168, 1, 1};
+
+}  // namespace
+
+// --------------------------------------------------------------------------
+//  Types
+// --------------------------------------------------------------------------
+
+// The client side of one connection.
+struct Connection {
+  enum class States {
+    kIdle,
+    kWaiting,  // Connecting or waiting for the byte
+  };
+
+  EthernetClient client;
+  States state = States::kIdle;
+  uint32_t startTime = 0;
+};
+
+// The benchmark counts.
+struct Counts {
+  uint32_t started   = 0;  // Connections started
+  uint32_t completed = 0;  // Connections that received their byte
+  uint32_t failed    = 0;  // Connections that couldn't start, closed
+                           // without data, or timed out
+  uint32_t accepted  = 0;  // Connections accepted by the server
+};
+
+// --------------------------------------------------------------------------
+//  Program State
+// --------------------------------------------------------------------------
+
+namespace {  // Internal linkage section
+
+EthernetServer server{kPort};
+
+Connection connections[kMaxInFlight];
+Counts counts;
+
+bool haveAddress = false;
+bool running = false;
+bool done    = false;
+uint32_t startTime  = 0;
+uint32_t lastReport = 0;
+
+}  // namespace
+
+// --------------------------------------------------------------------------
+//  Main Program
+// --------------------------------------------------------------------------
+
+namespace {
+// Forward declarations
+void start();
+void serve();
+void churn(uint32_t elapsed);
+void report(uint32_t elapsed);
+}  // namespace
+
+// Program setup.
+void setup() {
+  Serial.begin(115200);
+  while (!Serial && (millis() < 4000)) {
+    // Wait for Serial
+  }
+  printf("Starting...\r\n");
+
+#if !LWIP_NETIF_LOOPBACK
+  printf("LWIP_NETIF_LOOPBACK must be enabled to connect to this device\r\n");
+  return;
+#endif  // !LWIP_NETIF_LOOPBACK
+#if !QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+  printf("Note: QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY is disabled, so the"
+         " PCB counts will be zero\r\n");
+#endif  // !QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+
+  const uint8_t* const mac = Ethernet.macAddress();
+  printf("MAC = %02x:%02x:%02x:%02x:%02x:%02x\r\n",
+         mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+  // The benchmark starts when there's a link and an address
+  Ethernet.onAddressChanged([]() {
+    IPAddress ip = Ethernet.localIP();
+    haveAddress = (ip != INADDR_NONE);
+    if (!haveAddress) {
+      printf("[Ethernet] Address changed: No IP address\r\n");
+      return;
+    }
+    printf("[Ethernet] Address changed: Local IP = %u.%u.%u.%u\r\n",
+           ip[0], ip[1], ip[2], ip[3]);
+  });
+
+  // Start Ethernet
+  bool success = false;
+  if (kStaticIP == INADDR_NONE) {
+    printf("Starting Ethernet with DHCP...\r\n");
+    success = Ethernet.begin();
+  } else {
+    printf("Starting Ethernet with a static IP...\r\n");
+    success = Ethernet.begin(kStaticIP, kSubnet, kGateway);
+  }
+  if (!success) {
+    printf("Failed to start Ethernet\r\n");
+    return;
+  }
+}
+
+// Main program loop.
+void loop() {
+  if (!running) {
+    if (!done && haveAddress && Ethernet.linkState()) {
+      start();
+    }
+    return;
+  }
+
+  const uint32_t elapsed = millis() - startTime;
+  serve();
+  churn(elapsed);
+
+  if (millis() - lastReport >= kReportInterval) {
+    lastReport = millis();
+    report(elapsed);
+  }
+
+  if (elapsed >= kDuration) {
+    // Let the in-flight connections finish
+    bool idle = true;
+    for (const Connection& c : connections) {  // Use a reference
+      idle = idle && (c.state == Connection::States::kIdle);
+    }
+    if (idle) {
+      running = false;
+      done    = true;
+      server.end();
+      printf("Done.\r\n");
+      report(millis() - startTime);
+    }
+  }
+}
+
+namespace {
+
+// Starts the server and resets the counts.
+void start() {
+  printf("Listening on port %" PRIu16 "...\r\n", kPort);
+  if (!server.beginWithReuse()) {
+    printf("Failed to start the server\r\n");
+    done = true;
+    return;
+  }
+  for (Connection& c : connections) {  // Use a reference
+    c.client.setConnectionTimeoutEnabled(false);
+  }
+
+  printf("Running for %" PRIu32 " s at %" PRIu32 " connections/min"
+         " (PCBs: %zu, TIME_WAIT timeout: %" PRIu32 " ms)...\r\n",
+         kDuration / 1000, kConnectionsPerMinute,
+         EthernetClient::pcbStats().capacity,
+         EthernetClient::timeWaitTimeout());
+  EthernetClient::resetPcbStats();
+  startTime  = millis();
+  lastReport = startTime;
+  running = true;
+}
+
+// Accepts connections, sends each one byte, and closes them.
+void serve() {
+  EthernetClient client = server.accept();
+  if (client) {
+    counts.accepted++;
+    client.writeFully(static_cast<uint8_t>(counts.accepted));
+    client.close();
+  }
+}
+
+// Starts connections at the target rate and finishes the ones that are done.
+void churn(const uint32_t elapsed) {
+  const uint32_t due =
+      (elapsed < kDuration)
+          ? static_cast<uint32_t>(uint64_t{elapsed} * kConnectionsPerMinute /
+                                  60'000)
+          : counts.started;
+
+  for (Connection& c : connections) {  // Use a reference
+    switch (c.state) {
+      case Connection::States::kIdle:
+        if (counts.started >= due) {
+          break;
+        }
+        counts.started++;
+        if (!c.client.connectNoWait(Ethernet.localIP(), kPort)) {
+          counts.failed++;
+          break;
+        }
+        c.startTime = millis();
+        c.state = Connection::States::kWaiting;
+        break;
+
+      case Connection::States::kWaiting:
+        if (c.client.available() > 0) {
+          c.client.read();
+          c.client.close();
+          counts.completed++;
+          c.state = Connection::States::kIdle;
+        } else if (!c.client.connecting() && !c.client.connected()) {
+          // Reset or closed without data
+          c.client.close();
+          counts.failed++;
+          c.state = Connection::States::kIdle;
+        } else if (millis() - c.startTime >= kConnectionTimeout) {
+          c.client.abort();
+          counts.failed++;
+          c.state = Connection::States::kIdle;
+        }
+        break;
+    }
+  }
+}
+
+// Prints the counts so far.
+void report(const uint32_t elapsed) {
+  const EthernetClient::PcbStats stats = EthernetClient::pcbStats();
+  const uint32_t rate = static_cast<uint32_t>(
+      uint64_t{counts.completed} * 60'000 / ((elapsed > 0) ? elapsed : 1));
+
+  printf("[%" PRIu32 " s] started=%" PRIu32 " completed=%" PRIu32
+         " failed=%" PRIu32 " accepted=%" PRIu32 " (%" PRIu32 "/min)\r\n",
+         elapsed / 1000, counts.started, counts.completed, counts.failed,
+         counts.accepted, rate);
+  printf("    PCBs: active=%zu timeWait=%zu exhausted=%" PRIu32
+         " recycled=%" PRIu32 " reused=%" PRIu32 " failed=%" PRIu32 "\r\n",
+         stats.active, stats.timeWait, stats.exhausted, stats.recycled,
+         stats.reused, stats.failed);
+}
+
+}  // namespace
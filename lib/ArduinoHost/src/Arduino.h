@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// Arduino.h is a minimal host version of the Arduino core, enough to build
+// QNEthernet with the simulated driver and to run its tests.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+// C++ includes
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "IPAddress.h"
+#include "Print.h"
+#include "Stream.h"
+
+#define FLASHMEM
+#define PROGMEM
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+extern "C" void yield();
+
+// Program entry points, called by the host's main()
+void setup();
+void loop();
+
+// Serial writes to stdout and never has input.
+class HostSerial final : public Stream {
+ public:
+  void begin(const long baud) {
+    (void)baud;
+  }
+
+  size_t write(const uint8_t b) override {
+    return std::fwrite(&b, 1, 1, stdout);
+  }
+
+  size_t write(const uint8_t* const buffer, const size_t size) override {
+    return std::fwrite(buffer, 1, size, stdout);
+  }
+
+  void flush() override {
+    std::fflush(stdout);
+  }
+
+  int available() override {
+    return 0;
+  }
+
+  int read() override {
+    return -1;
+  }
+
+  int peek() override {
+    return -1;
+  }
+
+  explicit operator bool() const {
+    return true;
+  }
+};
+
+extern HostSerial Serial;
@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// ArduinoHost.cpp implements the host Arduino functions.
+// This file is part of the QNEthernet library.
+
+#include "Arduino.h"
+
+// C++ includes
+#include <chrono>
+#include <thread>
+
+const IPAddress INADDR_NONE;
+
+HostSerial Serial;
+
+static const std::chrono::steady_clock::time_point kStart =
+    std::chrono::steady_clock::now();
+
+uint32_t millis() {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - kStart)
+          .count());
+}
+
+uint32_t micros() {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - kStart)
+          .count());
+}
+
+void delay(const uint32_t ms) {
+  const uint32_t t = millis();
+  while (millis() - t < ms) {
+    yield();
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+}
+
+// Runs setup() once. Programs on the host, such as the tests, are expected to
+// do all their work there, so loop() isn't called.
+int main() {
+  setup();
+  return 0;
+}
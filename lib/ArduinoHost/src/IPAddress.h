@@ -0,0 +1,73 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// IPAddress.h is the host version of the Arduino IPv4 IPAddress class.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+// C++ includes
+#include <cstdint>
+#include <cstring>
+
+#include "Print.h"
+
+class IPAddress : public Printable {
+ public:
+  IPAddress() = default;
+
+  IPAddress(const uint8_t a, const uint8_t b, const uint8_t c,
+            const uint8_t d) {
+    bytes_[0] = a;
+    bytes_[1] = b;
+    bytes_[2] = c;
+    bytes_[3] = d;
+  }
+
+  // The address is in network order.
+  IPAddress(const uint32_t address) {
+    std::memcpy(bytes_, &address, sizeof(bytes_));
+  }
+
+  IPAddress(const uint8_t* const address) {
+    std::memcpy(bytes_, address, sizeof(bytes_));
+  }
+
+  IPAddress(const IPAddress&) = default;
+  IPAddress& operator=(const IPAddress&) = default;
+
+  operator uint32_t() const {
+    uint32_t address;
+    std::memcpy(&address, bytes_, sizeof(address));
+    return address;
+  }
+
+  bool operator==(const IPAddress& other) const {
+    return std::memcmp(bytes_, other.bytes_, sizeof(bytes_)) == 0;
+  }
+
+  bool operator!=(const IPAddress& other) const {
+    return !(*this == other);
+  }
+
+  bool operator==(const uint8_t* const address) const {
+    return std::memcmp(bytes_, address, sizeof(bytes_)) == 0;
+  }
+
+  uint8_t operator[](const int index) const {
+    return bytes_[index];
+  }
+
+  uint8_t& operator[](const int index) {
+    return bytes_[index];
+  }
+
+  size_t printTo(Print& p) const override {
+    return p.printf("%u.%u.%u.%u", bytes_[0], bytes_[1], bytes_[2], bytes_[3]);
+  }
+
+ private:
+  uint8_t bytes_[4]{};
+};
+
+extern const IPAddress INADDR_NONE;
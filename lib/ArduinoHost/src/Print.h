@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// Print.h is the host version of the Arduino Print class. Only the parts used
+// by the library and its tests are here.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+// C++ includes
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+class Print {
+ public:
+  virtual ~Print() = default;
+
+  virtual size_t write(uint8_t b) = 0;
+
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size-- > 0) {
+      if (write(*buffer++) == 0) {
+        break;
+      }
+      ++n;
+    }
+    return n;
+  }
+
+  size_t write(const char* const s) {
+    if (s == nullptr) {
+      return 0;
+    }
+    return write(reinterpret_cast<const uint8_t*>(s), std::strlen(s));
+  }
+
+  size_t write(const char* const buffer, const size_t size) {
+    return write(reinterpret_cast<const uint8_t*>(buffer), size);
+  }
+
+  virtual int availableForWrite() {
+    return 0;
+  }
+
+  virtual void flush() {}
+
+  size_t print(const char* const s) {
+    return write(s);
+  }
+
+  size_t print(const char c) {
+    return write(static_cast<uint8_t>(c));
+  }
+
+  size_t print(const int v) {
+    return printf("%d", v);
+  }
+
+  size_t print(const unsigned int v) {
+    return printf("%u", v);
+  }
+
+  size_t print(const long v) {
+    return printf("%ld", v);
+  }
+
+  size_t print(const unsigned long v) {
+    return printf("%lu", v);
+  }
+
+  size_t println() {
+    return write("\r\n");
+  }
+
+  template <typename T>
+  size_t println(const T v) {
+    const size_t n = print(v);
+    return n + println();
+  }
+
+  int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    const int n = std::vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n > 0) {
+      write(buf, (static_cast<size_t>(n) < sizeof(buf)) ? n : sizeof(buf) - 1);
+    }
+    return n;
+  }
+
+  int getWriteError() {
+    return writeError_;
+  }
+
+  void clearWriteError() {
+    setWriteError(0);
+  }
+
+ protected:
+  void setWriteError(const int err = 1) {
+    writeError_ = err;
+  }
+
+ private:
+  int writeError_ = 0;
+};
+
+class Printable {
+ public:
+  virtual ~Printable() = default;
+  virtual size_t printTo(Print& p) const = 0;
+};
@@ -0,0 +1,14 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// Server.h is the host version of the Arduino Server interface.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+#include "Print.h"
+
+class Server : public Print {
+ public:
+  virtual void begin() = 0;
+};
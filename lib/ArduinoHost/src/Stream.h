@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// Stream.h is the host version of the Arduino Stream class.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+#include "Print.h"
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  size_t readBytes(char* const buffer, const size_t length) {
+    size_t n = 0;
+    while (n < length) {
+      const int c = read();
+      if (c < 0) {
+        break;
+      }
+      buffer[n++] = static_cast<char>(c);
+    }
+    return n;
+  }
+
+  size_t readBytes(uint8_t* const buffer, const size_t length) {
+    return readBytes(reinterpret_cast<char*>(buffer), length);
+  }
+
+  void setTimeout(const unsigned long timeout) {
+    (void)timeout;
+  }
+};
@@ -104,6 +104,48 @@ class EthernetClass final {
     return driverCapabilities_;
   }
 
+  // Sets the driver buffer configuration: the ring sizes and where the buffers
+  // go. This must be called before the first begin() call because the driver
+  // allocates its buffers only once, when it's first initialized. This returns
+  // whether the configuration was accepted.
+  //
+  // If there was an error then errno will be set appropriately.
+  //
+  // See: driverRegionSize(config)
+  bool setDriverConfig(const DriverConfig& config);
+
+  // Returns the size of the caller-supplied region needed for the given
+  // driver configuration. This returns zero if the driver doesn't support a
+  // caller-supplied region or if the configuration is invalid.
+  size_t driverRegionSize(const DriverConfig& config) const;
+
+  // Sets the receive processing settings: interrupt coalescing, the per-loop
+  // frame budget, and adaptive polling. This may be called either before or
+  // after Ethernet has started. This returns whether the settings
+  // were accepted.
+  //
+  // If there was an error then errno will be set appropriately.
+  //
+  // See: driverCapabilities()
+  bool setRxSettings(const RxSettings& settings);
+
+  // Returns the receive loop statistics. These include the number of frames
+  // processed by the most recent loop() call.
+  RxLoopStats rxLoopStats() const;
+
+  // Resets the receive loop statistics.
+  void resetRxLoopStats();
+
+  // Returns the checksum offload statistics. These count the frames whose
+  // checksums were handled by the hardware. They stay at zero if the driver
+  // doesn't offload checksums.
+  //
+  // See: driverCapabilities()
+  ChecksumOffloadStats checksumOffloadStats() const;
+
+  // Resets the checksum offload statistics.
+  void resetChecksumOffloadStats();
+
   // Gets the interface name. This will return an empty string if Ethernet is
   // not initialized.
   const char* interfaceName() const {
@@ -138,7 +180,8 @@ class EthernetClass final {
   // See: driverCapabilities()
   void setMACAddress(const uint8_t mac[kMACAddrSize]);
 
-  // Call often.
+  // Call often. This is also where any EthernetClient and EthernetServer
+  // event callbacks are called.
   void loop();
 
   // Starts Ethernet. The DHCP client will be started depending on whether it's
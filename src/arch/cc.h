@@ -10,6 +10,7 @@
 #if __STDC_VERSION__ < 202311L
 #include <stdalign.h>
 #endif  // C < 23
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -467,6 +467,11 @@ void tcp_rst(const struct tcp_pcb* pcb, u32_t seqno, u32_t ackno,
 void tcp_rst_netif(struct netif *netif, u32_t seqno, u32_t ackno,
                    const ip_addr_t *local_ip, const ip_addr_t *remote_ip,
                    u16_t local_port, u16_t remote_port);
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+void tcp_synack_netif(struct netif *netif, u32_t seqno, u32_t ackno,
+                      const ip_addr_t *local_ip, const ip_addr_t *remote_ip,
+                      u16_t local_port, u16_t remote_port);
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES */
 
 u32_t tcp_next_iss(struct tcp_pcb *pcb);
 
@@ -1446,7 +1446,11 @@ tcp_slowtmr_start:
     pcb_remove = 0;
 
     /* Check if this PCB has stayed long enough in TIME-WAIT */
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+    if ((u32_t)(tcp_ticks - pcb->tmr) > tcp_time_wait_timeout() / TCP_SLOW_INTERVAL) {
+#else
     if ((u32_t)(tcp_ticks - pcb->tmr) > 2 * TCP_MSL / TCP_SLOW_INTERVAL) {
+#endif /* QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY */
       ++pcb_remove;
     }
 
@@ -1802,6 +1806,9 @@ tcp_kill_timewait(void)
   if (inactive != NULL) {
     LWIP_DEBUGF(TCP_DEBUG, ("tcp_kill_timewait: killing oldest TIME-WAIT PCB %p (%"S32_F")\n",
                             (void *)inactive, inactivity));
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+    tcp_count_pcb_event(TCP_PCB_EVENT_RECYCLED);
+#endif /* QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY */
     tcp_abort(inactive);
   }
 }
@@ -1843,6 +1850,9 @@ tcp_alloc(u8_t prio)
 
   pcb = (struct tcp_pcb *)memp_malloc(MEMP_TCP_PCB);
   if (pcb == NULL) {
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+    tcp_count_pcb_event(TCP_PCB_EVENT_EXHAUSTED);
+#endif /* QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY */
     /* Try to send FIN for all pcbs stuck in TF_CLOSEPEND first */
     tcp_handle_closepend();
 
@@ -1888,6 +1898,11 @@ tcp_alloc(u8_t prio)
       /* adjust err stats: memp_malloc failed above */
       MEMP_STATS_DEC(err, MEMP_TCP_PCB);
     }
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+    if (pcb == NULL) {
+      tcp_count_pcb_event(TCP_PCB_EVENT_FAILED);
+    }
+#endif /* QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY */
   }
   if (pcb != NULL) {
     /* zero out the whole pcb, so there is no need to initialize members to zero */
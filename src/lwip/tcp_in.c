@@ -94,6 +94,19 @@ static void tcp_parseopt(struct tcp_pcb *pcb);
 
 static void tcp_listen_input(struct tcp_pcb_listen *pcb);
 static void tcp_timewait_input(struct tcp_pcb *pcb);
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+static void tcp_listen_send_cookie(struct tcp_pcb_listen *pcb);
+static struct tcp_pcb *tcp_listen_cookie_input(struct tcp_pcb_listen *pcb);
+static u16_t tcp_parse_syn_mss(void);
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES */
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+static int tcp_timewait_reusable(struct tcp_pcb *pcb);
+#endif /* QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY */
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES || \
+    (QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY && LWIP_TCP_TIMESTAMPS)
+static int tcp_find_opt(u8_t opt, u8_t len);
+static u8_t tcp_get_next_optbyte(void);
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES || ... */
 
 static int tcp_input_delayed_close(struct tcp_pcb *pcb);
 
@@ -300,6 +313,16 @@ tcp_input(struct pbuf *p, struct netif *inp)
            of the list since we are not very likely to receive that
            many segments for connections in TIME-WAIT. */
         LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for TIME_WAITing connection.\n"));
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+        if (tcp_timewait_reusable(pcb)) {
+          /* Free the old connection and let a listener have the SYN */
+          LWIP_DEBUGF(TCP_DEBUG, ("tcp_input: SYN reuses TIME_WAIT connection\n"));
+          tcp_count_pcb_event(TCP_PCB_EVENT_REUSED);
+          tcp_abandon(pcb, 0);
+          pcb = NULL;
+          break;
+        }
+#endif /* QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY */
 #ifdef LWIP_HOOK_TCP_INPACKET_PCB
         if (LWIP_HOOK_TCP_INPACKET_PCB(pcb, tcphdr, tcphdr_optlen, tcphdr_opt1len,
                                        tcphdr_opt2, p) == ERR_OK)
@@ -371,6 +394,15 @@ tcp_input(struct pbuf *p, struct netif *inp)
         TCP_STATS_INC(tcp.cachehit);
       }
 
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+      /* An ACK returning a valid SYN cookie creates the connection, which then
+         processes the segment like any other */
+      pcb = tcp_listen_cookie_input(lpcb);
+      if (pcb != NULL) {
+        goto syn_cookie_accepted;
+      }
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES */
+
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for LISTENing connection.\n"));
 #ifdef LWIP_HOOK_TCP_INPACKET_PCB
       if (LWIP_HOOK_TCP_INPACKET_PCB((struct tcp_pcb *)lpcb, tcphdr, tcphdr_optlen,
@@ -384,6 +416,9 @@ tcp_input(struct pbuf *p, struct netif *inp)
     }
   }
 
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+syn_cookie_accepted:
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES */
 #if TCP_INPUT_DEBUG
   LWIP_DEBUGF(TCP_INPUT_DEBUG, ("+-+-+-+-+-+-+-+-+-+-+-+-+-+- tcp_input: flags "));
   tcp_debug_print_flags(TCPH_FLAGS(tcphdr));
@@ -653,6 +688,9 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
 #if TCP_LISTEN_BACKLOG
     if (pcb->accepts_pending >= pcb->backlog) {
       LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_input: listen backlog exceeded for port %"U16_F"\n", tcphdr->dest));
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+      tcp_listen_send_cookie(pcb);
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES */
       return;
     }
 #endif /* TCP_LISTEN_BACKLOG */
@@ -664,6 +702,10 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
       err_t err;
       LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_input: could not allocate PCB\n"));
       TCP_STATS_INC(tcp.memerr);
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+      /* With a SYN cookie, the PCB is only needed once the ACK comes back */
+      tcp_listen_send_cookie(pcb);
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES */
       TCP_EVENT_ACCEPT(pcb, NULL, pcb->callback_arg, ERR_MEM, err);
       LWIP_UNUSED_ARG(err); /* err not useful here */
       return;
@@ -729,6 +771,142 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
   return;
 }
 
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+/**
+ * Answers a SYN for a listening connection without creating a PCB. The
+ * SYN|ACK's sequence number is a cookie that encodes the peer's MSS, so that
+ * the connection can be created by tcp_listen_cookie_input() when the ACK
+ * comes back.
+ *
+ * @param pcb the tcp_pcb_listen for which a SYN arrived
+ */
+static void
+tcp_listen_send_cookie(struct tcp_pcb_listen *pcb)
+{
+  u32_t iss = tcp_syn_cookie_isn(ip_current_dest_addr(), pcb->local_port,
+                                 ip_current_src_addr(), tcphdr->src,
+                                 seqno, tcp_parse_syn_mss());
+  tcp_synack_netif(ip_data.current_input_netif, iss, seqno + 1,
+                   ip_current_dest_addr(), ip_current_src_addr(),
+                   tcphdr->dest, tcphdr->src);
+}
+
+/**
+ * Called by tcp_input() when a segment arrives for a listening connection.
+ * If it's an ACK returning a valid SYN cookie, this creates the connection in
+ * the SYN_RCVD state, as if it had sent the SYN|ACK, so that the segment
+ * completes the handshake.
+ *
+ * @param pcb the tcp_pcb_listen for which a segment arrived
+ * @return the new pcb, or NULL if the segment isn't a valid cookie ACK or if
+ *         there's no free pcb
+ */
+static struct tcp_pcb *
+tcp_listen_cookie_input(struct tcp_pcb_listen *pcb)
+{
+  struct tcp_pcb *npcb;
+  u16_t mss;
+
+  if ((flags & (TCP_SYN | TCP_ACK | TCP_RST)) != TCP_ACK) {
+    return NULL;
+  }
+  mss = tcp_syn_cookie_check(ip_current_dest_addr(), pcb->local_port,
+                             ip_current_src_addr(), tcphdr->src,
+                             seqno - 1, ackno - 1);
+  if (mss == 0) {
+    return NULL;
+  }
+
+  npcb = tcp_alloc(pcb->prio);
+  if (npcb == NULL) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_cookie_input: could not allocate PCB\n"));
+    TCP_STATS_INC(tcp.memerr);
+    tcp_syn_cookie_count(0);
+    return NULL;
+  }
+  LWIP_DEBUGF(TCP_DEBUG, ("TCP connection from SYN cookie %"U16_F" -> %"U16_F".\n", tcphdr->src, tcphdr->dest));
+
+  /* Set up the new PCB as tcp_listen_input() would have, after sending the
+     SYN|ACK. It doesn't count against the backlog. */
+  ip_addr_copy(npcb->local_ip, *ip_current_dest_addr());
+  ip_addr_copy(npcb->remote_ip, *ip_current_src_addr());
+  npcb->local_port = pcb->local_port;
+  npcb->remote_port = tcphdr->src;
+  npcb->state = SYN_RCVD;
+  npcb->rcv_nxt = seqno;
+  npcb->rcv_ann_right_edge = npcb->rcv_nxt;
+  npcb->snd_wl2 = ackno - 1;
+  npcb->snd_nxt = ackno;
+  npcb->lastack = ackno - 1;
+  npcb->snd_lbb = ackno;
+  npcb->snd_wl1 = seqno - 1;/* initialise to seqno-1 to force window update */
+  npcb->callback_arg = pcb->callback_arg;
+#if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
+  npcb->listener = pcb;
+#endif /* LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG */
+#if LWIP_VLAN_PCP
+  npcb->netif_hints.tci = pcb->netif_hints.tci;
+#endif /* LWIP_VLAN_PCP */
+  /* inherit socket options */
+  npcb->so_options = pcb->so_options & SOF_INHERITED;
+  npcb->netif_idx = pcb->netif_idx;
+  TCP_REG_ACTIVE(npcb);
+
+  npcb->mss = mss;
+  npcb->snd_wnd = tcphdr->wnd;
+  npcb->snd_wnd_max = npcb->snd_wnd;
+
+#if TCP_CALCULATE_EFF_SEND_MSS
+  npcb->mss = tcp_eff_send_mss(npcb->mss, &npcb->local_ip, &npcb->remote_ip);
+#endif /* TCP_CALCULATE_EFF_SEND_MSS */
+
+  MIB2_STATS_INC(mib2.tcppassiveopens);
+
+#if LWIP_TCP_PCB_NUM_EXT_ARGS
+  if (tcp_ext_arg_invoke_callbacks_passive_open(pcb, npcb) != ERR_OK) {
+    tcp_abandon(npcb, 0);
+    tcp_syn_cookie_count(0);
+    return NULL;
+  }
+#endif
+
+  tcp_syn_cookie_count(1);
+  return npcb;
+}
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES */
+
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+/**
+ * Checks whether a segment for a connection in TIME_WAIT is a SYN that may
+ * start a new connection with the same addresses and ports, following
+ * RFC 6191. If both the old connection and the SYN use timestamps then the
+ * SYN's timestamp must be newer than the last one received. Otherwise, its
+ * sequence number must be past the end of the old connection (RFC 1122,
+ * section 4.2.2.13).
+ *
+ * @param pcb the tcp_pcb in TIME_WAIT for which a segment arrived
+ * @return 1 if the old connection can be freed for the SYN, 0 otherwise
+ */
+static int
+tcp_timewait_reusable(struct tcp_pcb *pcb)
+{
+  if ((flags & (TCP_SYN | TCP_ACK | TCP_RST)) != TCP_SYN) {
+    return 0;
+  }
+#if LWIP_TCP_TIMESTAMPS
+  if ((pcb->flags & TF_TIMESTAMP) &&
+      tcp_find_opt(LWIP_TCP_OPT_TS, LWIP_TCP_OPT_LEN_TS)) {
+    u32_t tsval = ((u32_t)tcp_get_next_optbyte() << 24);
+    tsval |= ((u32_t)tcp_get_next_optbyte() << 16);
+    tsval |= ((u32_t)tcp_get_next_optbyte() << 8);
+    tsval |= tcp_get_next_optbyte();
+    return TCP_SEQ_GT(tsval, pcb->ts_recent);
+  }
+#endif /* LWIP_TCP_TIMESTAMPS */
+  return TCP_SEQ_GT(seqno, pcb->rcv_nxt);
+}
+#endif /* QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY */
+
 /**
  * Called by tcp_input() when a segment arrives for a connection in
  * TIME_WAIT.
@@ -2045,6 +2223,64 @@ tcp_parseopt(struct tcp_pcb *pcb)
   }
 }
 
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+/**
+ * Returns the MSS option from an incoming SYN, limited to TCP_MSS, or 536 if
+ * there isn't one. This is tcp_parseopt() for when there's no pcb.
+ */
+static u16_t
+tcp_parse_syn_mss(void)
+{
+  u16_t mss;
+
+  if (tcp_find_opt(LWIP_TCP_OPT_MSS, LWIP_TCP_OPT_LEN_MSS)) {
+    mss = (u16_t)(tcp_get_next_optbyte() << 8);
+    mss |= tcp_get_next_optbyte();
+    /* Limit the mss to the configured TCP_MSS and prevent division by zero */
+    return ((mss > TCP_MSS) || (mss == 0)) ? TCP_MSS : mss;
+  }
+  return LWIP_MIN(536, TCP_MSS);
+}
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES */
+
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES || \
+    (QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY && LWIP_TCP_TIMESTAMPS)
+/**
+ * Finds an option in the incoming segment. This is tcp_parseopt() for when
+ * there's no pcb.
+ *
+ * @param opt the option kind
+ * @param len the option's length, including the kind and length bytes
+ * @return 1 if the option was found, with tcp_optidx at its data, or 0 if not
+ */
+static int
+tcp_find_opt(u8_t opt, u8_t len)
+{
+  u8_t kind;
+  u8_t kind_len;
+
+  for (tcp_optidx = 0; tcp_optidx < tcphdr_optlen; ) {
+    kind = tcp_get_next_optbyte();
+    if (kind == LWIP_TCP_OPT_EOL) {
+      break;
+    }
+    if (kind == LWIP_TCP_OPT_NOP) {
+      continue;
+    }
+    kind_len = tcp_get_next_optbyte();
+    if ((kind_len < 2) || ((tcp_optidx - 2 + kind_len) > tcphdr_optlen)) {
+      /* Bad length */
+      break;
+    }
+    if ((kind == opt) && (kind_len == len)) {
+      return 1;
+    }
+    tcp_optidx = (u16_t)(tcp_optidx + kind_len - 2);
+  }
+  return 0;
+}
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES || ... */
+
 void
 tcp_trigger_input_pcb_close(void)
 {
@@ -2080,6 +2080,55 @@ tcp_rst_netif(struct netif *netif, u32_t seqno, u32_t ackno,
   }
 }
 
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+/**
+ * Send a SYN|ACK without a pcb, for answering a SYN with a SYN cookie.
+ *
+ * Called by tcp_listen_input() when no pcb is kept for a SYN. Only the MSS
+ * option is sent, since nothing else about the SYN is remembered, and so the
+ * window isn't scaled.
+ *
+ * @param netif the netif on which to send the SYN|ACK (since we have no pcb)
+ * @param seqno the sequence number to use for the outgoing segment (the cookie)
+ * @param ackno the acknowledge number to use for the outgoing segment
+ * @param local_ip the local IP address to send the segment from
+ * @param remote_ip the remote IP address to send the segment to
+ * @param local_port the local TCP port to send the segment from
+ * @param remote_port the remote TCP port to send the segment to
+ */
+void
+tcp_synack_netif(struct netif *netif, u32_t seqno, u32_t ackno,
+                 const ip_addr_t *local_ip, const ip_addr_t *remote_ip,
+                 u16_t local_port, u16_t remote_port)
+{
+  struct pbuf *p;
+  u16_t mss;
+
+  if (netif == NULL) {
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_synack_netif: no netif given\n"));
+    return;
+  }
+
+#if TCP_CALCULATE_EFF_SEND_MSS
+  mss = tcp_eff_send_mss_netif(TCP_MSS, netif, remote_ip);
+#else /* TCP_CALCULATE_EFF_SEND_MSS */
+  mss = TCP_MSS;
+#endif /* TCP_CALCULATE_EFF_SEND_MSS */
+
+  p = tcp_output_alloc_header_common(ackno, LWIP_TCP_OPT_LEN_MSS, 0, lwip_htonl(seqno),
+    local_port, remote_port, TCP_SYN | TCP_ACK, TCPWND16(TCP_WND));
+  if (p == NULL) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_synack_netif: could not allocate memory for pbuf\n"));
+    return;
+  }
+  /* cast through void* to get rid of alignment warnings */
+  *(u32_t *)(void *)((struct tcp_hdr *)p->payload + 1) = TCP_BUILD_MSS_OPTION(mss);
+
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_synack_netif: seqno %"U32_F" ackno %"U32_F".\n", seqno, ackno));
+  tcp_output_control_segment_netif(NULL, p, local_ip, remote_ip, netif);
+}
+#endif /* QNETHERNET_ENABLE_TCP_SYN_COOKIES */
+
 /**
  * Send an ACK without data.
  *
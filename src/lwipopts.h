@@ -42,7 +42,12 @@ void qnethernet_hal_check_core_locking(const char* file, int line,
 // #define MEM_CUSTOM_CALLOC                      calloc
 // #define MEMP_MEM_MALLOC                        0
 // #define MEMP_MEM_INIT                          0
+#if defined(__SIZEOF_POINTER__) && (__SIZEOF_POINTER__ > 4)
+// Align to pointers on 64-bit hosts, for the memp and pbuf structs
+#define MEM_ALIGNMENT                          __SIZEOF_POINTER__  /* 1 */
+#else
 #define MEM_ALIGNMENT                          4  /* 1 */
+#endif  // __SIZEOF_POINTER__ > 4
 #ifndef MEM_SIZE
 // Note: MEM_SIZE is not used if MEM_LIBC_MALLOC is enabled
 #define MEM_SIZE                               24000  /* 1600 */
@@ -99,7 +104,12 @@ void qnethernet_hal_check_core_locking(const char* file, int line,
 // #define MEMP_NUM_TCPIP_MSG_INPKT           8
 // #define MEMP_NUM_NETDB                     1
 // #define MEMP_NUM_LOCALHOSTLIST             1
-// #define PBUF_POOL_SIZE                     16
+// Enough buffers to hold a full TCP_WND of MSS-sized segments, and at least 16
+#ifndef PBUF_POOL_SIZE
+#define PBUF_POOL_SIZE \
+  ((((TCP_WND) + (TCP_MSS) - 1) / (TCP_MSS) > 16) \
+       ? (((TCP_WND) + (TCP_MSS) - 1) / (TCP_MSS)) : 16)  /* 16 */
+#endif  // !PBUF_POOL_SIZE
 // #define MEMP_NUM_API_MSG                   MEMP_NUM_TCPIP_MSG_API
 // #define MEMP_NUM_DNS_API_MSG               MEMP_NUM_TCPIP_MSG_API
 // #define MEMP_NUM_SOCKET_SETGETSOCKOPT_DATA MEMP_NUM_TCPIP_MSG_API
@@ -246,27 +256,47 @@ void qnethernet_hal_check_core_locking(const char* file, int line,
 // #if TCP_OOSEQ_MAX_PBUFS
 // #define TCP_OOSEQ_PBUFS_LIMIT(pcb) TCP_OOSEQ_MAX_PBUFS
 // #endif
-// #define TCP_LISTEN_BACKLOG         0
-// #define TCP_DEFAULT_LISTEN_BACKLOG 0xff
+#ifndef TCP_LISTEN_BACKLOG
+#define TCP_LISTEN_BACKLOG         QNETHERNET_ENABLE_TCP_SYN_COOKIES  /* 0 */
+#endif  // !TCP_LISTEN_BACKLOG
+#ifndef TCP_DEFAULT_LISTEN_BACKLOG
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+#define TCP_DEFAULT_LISTEN_BACKLOG ((MEMP_NUM_TCP_PCB + 3) / 4)  /* 0xff */
+#else
+#define TCP_DEFAULT_LISTEN_BACKLOG 0xff
+#endif  // QNETHERNET_ENABLE_TCP_SYN_COOKIES
+#endif  // !TCP_DEFAULT_LISTEN_BACKLOG
 // #define TCP_OVERSIZE               TCP_MSS
 // #define LWIP_TCP_TIMESTAMPS        0
 // #define TCP_WND_UPDATE_THRESHOLD   LWIP_MIN((TCP_WND / 4), (TCP_MSS * 4))
 // #define LWIP_EVENT_API             0
 // #define LWIP_CALLBACK_API          1
-// #define LWIP_WND_SCALE             0
-// #define TCP_RCV_SCALE              0
-// #define LWIP_TCP_PCB_NUM_EXT_ARGS  0
+// Window scaling is only enabled when TCP_WND is larger than 64KiB
+#ifndef LWIP_WND_SCALE
+#define LWIP_WND_SCALE             ((TCP_WND) > 0xffff)  /* 0 */
+#endif  // !LWIP_WND_SCALE
+#ifndef TCP_RCV_SCALE
+#define TCP_RCV_SCALE              (((TCP_WND) <= 0xffff)  ? 0 : \
+                                    ((TCP_WND) <= 0x1fffe) ? 1 : \
+                                    ((TCP_WND) <= 0x3fffc) ? 2 : \
+                                    ((TCP_WND) <= 0x7fff8) ? 3 : 4)  /* 0 */
+#endif  // !TCP_RCV_SCALE
+#ifndef LWIP_TCP_PCB_NUM_EXT_ARGS
+#define LWIP_TCP_PCB_NUM_EXT_ARGS  ((QNETHERNET_ENABLE_TCP_COUNTERS) ? 1 : 0)  /* 0 */
+#endif  // !LWIP_TCP_PCB_NUM_EXT_ARGS
 #ifndef LWIP_ALTCP
 // #define LWIP_ALTCP                 0
 #endif  // !LWIP_ALTCP
 #ifndef LWIP_ALTCP_TLS
 // #define LWIP_ALTCP_TLS             0
 #endif  // !LWIP_ALTCP_TLS
+// This is the largest receive window a connection's window can be tuned to.
+// PBUF_POOL_SIZE, LWIP_WND_SCALE, and TCP_RCV_SCALE follow it.
 #ifndef TCP_WND
 #if LWIP_ALTCP && LWIP_ALTCP_TLS
 #define TCP_WND                    (16 * 1024)  /* 16KiB for TLS */
 #else
-// #define TCP_WND                    (4 * TCP_MSS)
+#define TCP_WND                    (16 * TCP_MSS)  /* (4 * TCP_MSS) */
 #endif  // LWIP_ALTCP && LWIP_ALTCP_TLS
 #endif  // !TCP_WND
 
@@ -286,7 +316,8 @@ void qnethernet_hal_check_core_locking(const char* file, int line,
 #define LWIP_NETIF_EXT_STATUS_CALLBACK 1  /* 0 */
 // #define LWIP_NETIF_LINK_CALLBACK       0
 // #define LWIP_NETIF_REMOVE_CALLBACK     0
-// #define LWIP_NETIF_HWADDRHINT          0
+// Lets each PCB remember its last ARP entry; see EthernetUDP::sendBatch()
+#define LWIP_NETIF_HWADDRHINT          1  /* 0 */
 // #define LWIP_NETIF_TX_SINGLE_PBUF      0
 #if !defined(LWIP_MDNS_RESPONDER) || LWIP_MDNS_RESPONDER
 // Increment LWIP_NUM_NETIF_CLIENT_DATA by 1 for mDNS:
@@ -378,7 +409,9 @@ void qnethernet_hal_check_core_locking(const char* file, int line,
 // #define MIB2_STATS         0
 
 // Checksum options
-// #define LWIP_CHECKSUM_CTRL_PER_NETIF 0
+// Per-netif control lets drivers that offload checksums turn off the software
+// checksums for their interface only; see DriverCapabilities
+#define LWIP_CHECKSUM_CTRL_PER_NETIF 1  /* 0 */
 // #define CHECKSUM_GEN_IP              1
 // #define CHECKSUM_GEN_UDP             1
 // #define CHECKSUM_GEN_TCP             1
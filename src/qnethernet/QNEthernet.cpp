@@ -39,6 +39,10 @@ static_assert(TEENSYDUINO >= 159, "Must be built with Teensydino >= 1.59");
 #include "lwip/igmp.h"
 #include "lwip/sys.h"
 #include "qnethernet/QNDNSClient.h"
+#if LWIP_TCP
+#include "qnethernet/internal/ConnectionManager.h"
+#include "qnethernet/internal/ConnectionState.h"
+#endif  // LWIP_TCP
 #include "qnethernet/platforms/pgmspace.h"
 
 extern "C" void yield();
@@ -184,6 +188,46 @@ void EthernetClass::setMACAddress(const uint8_t mac[kMACAddrSize]) {
   // TODO: Return value?
 }
 
+bool EthernetClass::setDriverConfig(const DriverConfig& config) {
+  if (!driver::set_config(&config)) {
+    errno = EINVAL;
+    return false;
+  }
+  return true;
+}
+
+size_t EthernetClass::driverRegionSize(const DriverConfig& config) const {
+  return driver::get_region_size(&config);
+}
+
+bool EthernetClass::setRxSettings(const RxSettings& settings) {
+  if (!enet::set_rx_settings(&settings)) {
+    errno = EINVAL;
+    return false;
+  }
+  return true;
+}
+
+RxLoopStats EthernetClass::rxLoopStats() const {
+  RxLoopStats stats;
+  enet::get_rx_loop_stats(&stats);
+  return stats;
+}
+
+void EthernetClass::resetRxLoopStats() {
+  enet::reset_rx_loop_stats();
+}
+
+ChecksumOffloadStats EthernetClass::checksumOffloadStats() const {
+  ChecksumOffloadStats stats;
+  enet::get_checksum_offload_stats(&stats);
+  return stats;
+}
+
+void EthernetClass::resetChecksumOffloadStats() {
+  enet::reset_checksum_offload_stats();
+}
+
 void EthernetClass::loop() {
   enet::proc_input();
 
@@ -198,6 +242,17 @@ void EthernetClass::loop() {
     enet::poll();
     lastPollTime_ = sys_now();
   }
+
+#if LWIP_TCP
+  // Send corked data that's waited long enough
+  internal::ConnectionState::pushCorked();
+
+  // Retry queued data that the stack refused while nothing was in flight
+  internal::ConnectionState::retryQueued();
+
+  // Call any asynchronous TCP callbacks outside the stack
+  internal::ConnectionManager::instance().dispatchEvents();
+#endif  // LWIP_TCP
 }
 
 bool EthernetClass::begin() {
@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <cerrno>
 #include <cstring>
+#include <utility>
 
 #include "QNEthernet.h"
 #include "lwip/altcp.h"
@@ -20,12 +21,13 @@
 #include "lwip/err.h"
 #include "lwip/netif.h"
 #include "lwip/priv/altcp_priv.h"
+#include "lwip/priv/tcp_priv.h"
 #include "lwip/sys.h"
-#if LWIP_ALTCP
 #include "lwip/tcp.h"
-#endif  // LWIP_ALTCP
 #include "qnethernet/QNDNSClient.h"
+#include "qnethernet/internal/ChunkPool.h"
 #include "qnethernet/internal/ConnectionManager.h"
+#include "qnethernet/lwip_hooks.h"
 #include "qnethernet/util/PrintUtils.h"
 #include "qnethernet/util/ip_tools.h"
 #include "qnethernet_opts.h"
@@ -50,6 +52,91 @@ EthernetClient::EthernetClient(
 //  Connection
 // --------------------------------------------------------------------------
 
+bool EthernetClient::setReceivePool(const size_t chunkSize,
+                                    const size_t chunkCount) {
+  return internal::ChunkPool::instance().init(chunkSize, chunkCount);
+}
+
+EthernetClient::ReceivePoolStats EthernetClient::receivePoolStats() {
+  const internal::ChunkPool::Stats& s = internal::ChunkPool::instance().stats();
+  ReceivePoolStats stats;
+  stats.chunkSize     = s.chunkSize;
+  stats.chunkCount    = s.chunkCount;
+  stats.inUse         = s.inUse;
+  stats.highWatermark = s.highWatermark;
+  stats.exhausted     = s.exhausted;
+  return stats;
+}
+
+void EthernetClient::resetReceivePoolStats() {
+  internal::ChunkPool::instance().resetStats();
+}
+
+EthernetClient::ConnectionPoolStats EthernetClient::connectionPoolStats() {
+  const auto& holders = internal::ConnectionHolderPool::instance();
+  const auto& states = internal::ConnectionStatePool::instance();
+  ConnectionPoolStats stats;
+  stats.capacity     = internal::ConnectionHolderPool::kCount;
+  stats.holdersInUse = holders.inUse();
+  stats.statesInUse  = states.inUse();
+  stats.overflows    = holders.overflows() + states.overflows();
+  return stats;
+}
+
+void EthernetClient::setReceiveWindowBudget(const size_t budget) {
+  internal::ConnectionState::setWindowBudget(budget);
+}
+
+size_t EthernetClient::receiveWindowBudget() {
+  return internal::ConnectionState::windowBudget();
+}
+
+size_t EthernetClient::receiveWindowTotal() {
+  return internal::ConnectionState::windowTotal();
+}
+
+EthernetClient::PcbStats EthernetClient::pcbStats() {
+  PcbStats stats;
+  stats.capacity = MEMP_NUM_TCP_PCB;
+  for (const struct tcp_pcb* pcb = tcp_active_pcbs; pcb != nullptr;
+       pcb = pcb->next) {
+    ++stats.active;
+  }
+  for (const struct tcp_pcb* pcb = tcp_tw_pcbs; pcb != nullptr;
+       pcb = pcb->next) {
+    ++stats.timeWait;
+  }
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+  stats.exhausted = tcp_pcb_event_count(TCP_PCB_EVENT_EXHAUSTED);
+  stats.recycled  = tcp_pcb_event_count(TCP_PCB_EVENT_RECYCLED);
+  stats.reused    = tcp_pcb_event_count(TCP_PCB_EVENT_REUSED);
+  stats.failed    = tcp_pcb_event_count(TCP_PCB_EVENT_FAILED);
+#endif  // QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+  return stats;
+}
+
+void EthernetClient::resetPcbStats() {
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+  tcp_reset_pcb_event_counts();
+#endif  // QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+}
+
+void EthernetClient::setTimeWaitTimeout(const uint32_t timeout) {
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+  tcp_set_time_wait_timeout(timeout);
+#else
+  (void)timeout;
+#endif  // QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+}
+
+uint32_t EthernetClient::timeWaitTimeout() {
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+  return tcp_time_wait_timeout();
+#else
+  return 2*TCP_MSL;
+#endif  // QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+}
+
 int EthernetClient::connect(const IPAddress ip, const uint16_t port) {
 #if LWIP_IPV4
   const ip_addr_t ipaddr IPADDR4_INIT(static_cast<uint32_t>(ip));
@@ -232,6 +319,7 @@ void EthernetClient::close(const bool wait) {
   if (pendingConnect_ || conn_->connected) {
     if (!pendingConnect_) {
       // First try to flush any data
+      (void)state->sendCorked(true);
       // TODO: Is ignoring the return the correct thing to do?
       (void)altcp_output(state->pcb);
       Ethernet.loop();  // Maybe some TCP data gets in
@@ -242,10 +330,19 @@ void EthernetClient::close(const bool wait) {
         altcp_abort(state->pcb);
         errno = err_to_errno(err);
       }
+      // Closing an unconnected PCB frees it
+      state->pcbFreed = true;
       state = nullptr;
     }
 
     if (state != nullptr) {
+      // Return all unread data so that closing doesn't reset and free the PCB
+      state->releaseWindow();
+#if !LWIP_ALTCP
+      // Unless the stack is still holding refused data
+      const bool reset = state->closeResets();
+#endif  // !LWIP_ALTCP
+
       // Note: In altcp, altcp_close() removes TCP callbacks
       const err_t err = altcp_close(state->pcb);
       if (err != ERR_OK) {
@@ -257,7 +354,12 @@ void EthernetClient::close(const bool wait) {
       conn_->connected = false;
       state = nullptr;
 #else
-      if ((err == ERR_OK) && wait) {
+      if ((err == ERR_OK) && reset) {
+        // The PCB was freed without an error event
+        conn_->connected = false;
+        state->pcbFreed = true;
+        state = nullptr;
+      } else if ((err == ERR_OK) && wait) {
         const uint32_t t = sys_now();
         // TODO: Make this work for altcp, if possible
         // NOTE: conn_ could be set to NULL somewhere during the yield
@@ -289,6 +391,7 @@ void EthernetClient::closeOutput() {
   }
 
   // First try to flush any data
+  (void)state->sendCorked(true);
   // TODO: Is ignoring the return the correct thing to do?
   (void)altcp_output(state->pcb);
   Ethernet.loop();  // Maybe some TCP data gets in
@@ -408,6 +511,16 @@ size_t EthernetClient::write(const uint8_t b) {
 }
 
 size_t EthernetClient::write(const uint8_t* const buf, const size_t size) {
+  return write(buf, size, nullptr);
+}
+
+size_t EthernetClient::writeNoCopy(const void* const buf, const size_t size,
+                                   std::function<void(bool acked)> cb) {
+  return write(static_cast<const uint8_t*>(buf), size, &cb);
+}
+
+size_t EthernetClient::write(const uint8_t* const buf, const size_t size,
+                             std::function<void(bool acked)>* const cb) {
   if (!static_cast<bool>(*this)) {
     return 0;
   }
@@ -422,6 +535,37 @@ size_t EthernetClient::write(const uint8_t* const buf, const size_t size) {
     return 0;
   }
 
+  // Data queued by EthernetServer::broadcast() goes first
+  if (!state->queuedWrites.empty()) {
+    state->sendQueued();
+    if (!state->queuedWrites.empty()) {
+      Ethernet.loop();  // Loop to allow incoming TCP data
+      return 0;
+    }
+  }
+
+  // Corked data is only handed to the stack in full segments, so small writes
+  // don't need to go through the stack or loop()
+  if (state->corked && (cb == nullptr)) {
+    size_t written = state->cork(buf, size);
+    if (written == 0) {  // Possibly flush if there's no space
+      // TODO: Is ignoring the return the correct thing to do?
+      (void)altcp_output(state->pcb);
+      Ethernet.loop();  // Loop to allow incoming data
+      if (state == nullptr) {  // Re-check the state
+        return 0;
+      }
+      written = state->cork(buf, size);
+    }
+    return written;
+  }
+
+  // Corked data goes before anything else
+  if (!state->corkBuf.empty() && !state->sendCorked(true)) {
+    Ethernet.loop();  // Loop to allow incoming TCP data
+    return 0;
+  }
+
   size_t sndBufSize = altcp_sndbuf(state->pcb);  // 16-bit
   if (sndBufSize == 0) {  // Possibly flush if there's no space
     // TODO: Is ignoring the return the correct thing to do?
@@ -436,11 +580,19 @@ size_t EthernetClient::write(const uint8_t* const buf, const size_t size) {
   // Adjust the size to be the proper type
   auto actualSize = static_cast<uint16_t>(std::min(size, sndBufSize));
   if (actualSize > 0) {
-    const err_t err =
-        altcp_write(state->pcb, buf, actualSize, TCP_WRITE_FLAG_COPY);
+#if LWIP_ALTCP
+    // Layered connections may not finish with the data in order, so copy it
+    const uint8_t flags = TCP_WRITE_FLAG_COPY;
+#else
+    const uint8_t flags = (cb == nullptr) ? TCP_WRITE_FLAG_COPY : 0;
+#endif  // LWIP_ALTCP
+    const err_t err = altcp_write(state->pcb, buf, actualSize, flags);
     if (err != ERR_OK) {
       errno = err_to_errno(err);
       actualSize = 0;
+    } else if (cb != nullptr) {
+      // Track the write before anything can acknowledge it
+      state->addPendingWrite(std::move(*cb));
     }
 #if QNETHERNET_FLUSH_AFTER_TCP_WRITE
     // TODO: Is ignoring the return the correct thing to do?
@@ -469,10 +621,12 @@ int EthernetClient::availableForWrite() {
 
   Ethernet.loop();  // Loop to allow incoming TCP data
   // NOTE: loop() requires a re-check of the state
-  if (state == nullptr) {
+  if ((state == nullptr) || !state->queuedWrites.empty()) {
     return 0;
   }
-  return altcp_sndbuf(state->pcb);
+  const size_t sndBufSize = altcp_sndbuf(state->pcb);
+  const size_t corked = state->corkBuf.size();
+  return (sndBufSize > corked) ? sndBufSize - corked : 0;
 }
 
 void EthernetClient::flush() {
@@ -484,6 +638,10 @@ void EthernetClient::flush() {
     return;
   }
 
+  if (!state->corkBuf.empty()) {
+    (void)state->sendCorked(true);
+  }
+
   // TODO: Is ignoring the return the correct thing to do?
   (void)altcp_output(state->pcb);
   Ethernet.loop();  // Loop to allow incoming TCP data
@@ -498,7 +656,7 @@ ATTRIBUTE_NODISCARD
 static inline bool isAvailable(
     const std::unique_ptr<internal::ConnectionState>& state) {
   return (state != nullptr) &&  // Necessary because loop() may reset state
-         (/*(0 <= state->bufPos) &&*/ (state->bufPos < state->buf.size()));
+         state->isAvailable();
 }
 
 inline bool EthernetClient::checkState() {
@@ -547,7 +705,7 @@ int EthernetClient::available() {
   if (!isAvailable(*state)) {
     return 0;
   }
-  return (*state)->buf.size() - (*state)->bufPos;
+  return (*state)->available();
 }
 
 int EthernetClient::read() {
@@ -573,7 +731,9 @@ int EthernetClient::read() {
   if (!isAvailable(*state)) {
     return -1;
   }
-  return (*state)->buf[(*state)->bufPos++];
+  uint8_t b;
+  (void)(*state)->read(&b, 1);
+  return b;
 }
 
 int EthernetClient::read(uint8_t* const buf, const size_t size) {
@@ -611,13 +771,7 @@ int EthernetClient::read(uint8_t* const buf, const size_t size) {
   if (!isAvailable(*state)) {
     return 0;
   }
-  const size_t actualSize =
-      std::min(size, (*state)->buf.size() - (*state)->bufPos);
-  if (buf != nullptr) {
-    (void)std::copy_n(&(*state)->buf.data()[(*state)->bufPos], actualSize, buf);
-  }
-  (*state)->bufPos += actualSize;
-  return actualSize;
+  return (*state)->read(buf, size);
 }
 
 int EthernetClient::peek() {
@@ -638,7 +792,51 @@ int EthernetClient::peek() {
   if (!isAvailable(*state)) {
     return -1;
   }
-  return (*state)->buf[(*state)->bufPos];
+  return (*state)->peek();
+}
+
+// --------------------------------------------------------------------------
+//  Asynchronous Events
+// --------------------------------------------------------------------------
+
+std::function<void()> EthernetClient::makeEventFunc(
+    const EventFunction cb) const {
+  if (cb == nullptr) {
+    return nullptr;
+  }
+
+  // Use a weak reference so there's no cycle through the holder
+  const std::weak_ptr<internal::ConnectionHolder> conn{conn_};
+  return [conn, cb]() {
+    EthernetClient client{conn.lock()};
+    if (client.conn_ != nullptr) {
+      cb(client);
+    }
+  };
+}
+
+void EthernetClient::onConnected(const EventFunction cb) {
+  if (conn_ != nullptr) {
+    conn_->onConnected = makeEventFunc(cb);
+  }
+}
+
+void EthernetClient::onData(const EventFunction cb) {
+  if (conn_ != nullptr) {
+    conn_->onData = makeEventFunc(cb);
+  }
+}
+
+void EthernetClient::onWritable(const EventFunction cb) {
+  if (conn_ != nullptr) {
+    conn_->onWritable = makeEventFunc(cb);
+  }
+}
+
+void EthernetClient::onClosed(const EventFunction cb) {
+  if (conn_ != nullptr) {
+    conn_->onClosed = makeEventFunc(cb);
+  }
 }
 
 // --------------------------------------------------------------------------
@@ -682,15 +880,7 @@ EthernetClient::getState() const {
 ATTRIBUTE_NODISCARD
 static inline struct tcp_pcb* innermost(
     const std::unique_ptr<internal::ConnectionState>& state) {
-#if LWIP_ALTCP
-  struct altcp_pcb* innermost = state->pcb;
-  while (innermost->inner_conn != nullptr) {
-    innermost = innermost->inner_conn;
-  }
-  return static_cast<struct tcp_pcb*>(innermost->state);
-#else
-  return state->pcb;
-#endif  // LWIP_ALTCP
+  return state->tcpPcb();
 }
 
 bool EthernetClient::setNoDelay(const bool flag) {
@@ -716,6 +906,113 @@ bool EthernetClient::isNoDelay() const {
   return altcp_nagle_disabled((*state)->pcb);
 }
 
+bool EthernetClient::setCork(const bool flag) {
+  const auto* state = getState();
+  if (state == nullptr) {
+    return false;
+  }
+
+  (*state)->setCorked(flag);
+  return true;
+}
+
+bool EthernetClient::isCorked() const {
+  const auto* state = getState();
+  if (state == nullptr) {
+    return false;
+  }
+  return (*state)->corked;
+}
+
+bool EthernetClient::setCorkTimeout(const uint32_t timeout) {
+  const auto* state = getState();
+  if (state == nullptr) {
+    return false;
+  }
+
+  (*state)->corkTimeout = timeout;
+  return true;
+}
+
+uint32_t EthernetClient::corkTimeout() const {
+  const auto* state = getState();
+  if (state == nullptr) {
+    return 0;
+  }
+  return (*state)->corkTimeout;
+}
+
+bool EthernetClient::setZeroCopyReceive(const bool flag) {
+  const auto* state = getState();
+  if (state == nullptr) {
+    return false;
+  }
+
+  (*state)->setZeroCopyReceive(flag);
+  return true;
+}
+
+bool EthernetClient::isZeroCopyReceive() const {
+  const auto* state = getState();
+  if (state == nullptr) {
+    return false;
+  }
+  return (*state)->zeroCopyReceive;
+}
+
+size_t EthernetClient::receiveWindow() const {
+  const auto* state = getState();
+  if (state == nullptr) {
+    return 0;
+  }
+  return (*state)->rcvWnd;
+}
+
+// Converts a number of TCP slow timer ticks to milliseconds. lwIP keeps the
+// smoothed RTT scaled by 8 and the variation scaled by 4.
+static inline uint32_t ticksToMillis(const int ticks) {
+  return (ticks > 0) ? static_cast<uint32_t>(ticks) * TCP_SLOW_INTERVAL : 0;
+}
+
+bool EthernetClient::tcpInfo(TcpInfo& info) const {
+  const auto* state = getState();
+  if (state == nullptr) {
+    return false;
+  }
+
+  const struct tcp_pcb* const pcb = innermost(*state);
+  info.state            = pcb->state;
+  info.mss              = pcb->mss;
+  info.rtt              = ticksToMillis(pcb->sa >> 3);
+  info.rttVar           = ticksToMillis(pcb->sv >> 2);
+  info.rto              = ticksToMillis(pcb->rto);
+  info.rttMeasuring     = (pcb->rttest != 0);
+  info.backoff          = pcb->nrtx;
+  info.dupAcks          = pcb->dupacks;
+  info.probes           = pcb->persist_probe;
+  info.cwnd             = pcb->cwnd;
+  info.ssthresh         = pcb->ssthresh;
+  info.sendWindow       = pcb->snd_wnd;
+  info.receiveWindow    = pcb->rcv_wnd;
+  info.advertisedWindow = pcb->rcv_ann_wnd;
+  info.unackedBytes     = pcb->snd_nxt - pcb->lastack;
+  info.unsentBytes      = pcb->snd_lbb - pcb->snd_nxt;
+  info.queuedSegments   = pcb->snd_queuelen;
+
+  const internal::TcpCounters& c = (*state)->counters;
+  info.bytesSent           = c.bytesSent;
+  info.bytesReceived       = c.bytesReceived;
+  info.bytesRetransmitted  = c.bytesRetransmitted;
+  info.segmentsSent        = c.segmentsSent;
+  info.segmentsReceived    = c.segmentsReceived;
+  info.retransmits         = c.retransmits;
+  info.outOfOrder          = c.outOfOrder;
+  info.zeroWindowsReceived = c.zeroWindowsReceived;
+  info.zeroWindowsSent     = c.zeroWindowsSent;
+
+  return true;
+}
+
 bool EthernetClient::setOutgoingDiffServ(const uint8_t ds) {
   const auto* state = getState();
   if (state == nullptr) {
@@ -13,6 +13,7 @@
 // C++ includes
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 
 #ifdef ARDUINO_ARCH_STM32
@@ -37,7 +38,7 @@ class EthernetServer;
 
 class EthernetClient : public internal::ClientEx,
                        public internal::IPOpts,
-                       public internal::PrintfChecked {
+                       public internal::PrintfChecked<EthernetClient> {
  public:
   EthernetClient() = default;
   virtual ~EthernetClient() = default;
@@ -58,6 +59,98 @@ class EthernetClient : public internal::ClientEx,
     return MEMP_NUM_TCP_PCB;
   }
 
+  // Receive buffer pool statistics.
+  struct ReceivePoolStats final {
+    size_t chunkSize     = 0;  // Size of each chunk
+    size_t chunkCount    = 0;  // Total number of chunks
+    size_t inUse         = 0;  // Chunks currently holding unread data
+    size_t highWatermark = 0;  // Max. chunks in use at once
+    uint32_t exhausted   = 0;  // Times data didn't fit in the free chunks
+  };
+
+  // Sizes the receive buffer pool shared by all connections. Instead of each
+  // connection having its own window-sized buffer, connections borrow chunks
+  // from the pool only while they have unread data. A count of zero disables
+  // the pool, which is the default.
+  //
+  // Each connection still buffers at most TCP_WND bytes in chunks. When the
+  // pool runs out, the connection holds onto the stack's buffer (pbuf)
+  // instead, like with zero-copy receive, and the window stays closed by that
+  // amount until the data is read.
+  //
+  // This should be called at startup. It returns false and sets errno if any
+  // chunks are in use (EBUSY), if the size is zero for a non-zero
+  // count (EINVAL), or if the memory couldn't be allocated (ENOMEM).
+  static bool setReceivePool(size_t chunkSize, size_t chunkCount);
+
+  // Returns the receive buffer pool statistics.
+  static ReceivePoolStats receivePoolStats();
+
+  // Resets the pool's high watermark to the current use and the exhausted
+  // count to zero.
+  static void resetReceivePoolStats();
+
+  // Connection object pool statistics.
+  struct ConnectionPoolStats final {
+    size_t capacity     = 0;  // Objects in each pool
+    size_t holdersInUse = 0;  // Connection objects taken from the pool
+    size_t statesInUse  = 0;  // Open-connection states taken from the pool
+    uint32_t overflows  = 0;  // Times the heap was used instead of a pool
+  };
+
+  // Returns the connection object pool statistics. Each connection's internal
+  // objects come from two pools, each holding maxSockets() objects, instead of
+  // from the heap. A connection object stays in use as long as an
+  // EthernetClient refers to it, even after the connection is closed, so
+  // keeping many closed clients around can empty the pool, in which case the
+  // heap is used.
+  static ConnectionPoolStats connectionPoolStats();
+
+  // Sets the total of all the connections' receive windows, in bytes, beyond
+  // which no connection's window grows. Each connection's window starts at
+  // QNETHERNET_TCP_WND_INITIAL and grows, up to TCP_WND, while the remote side
+  // keeps filling it. When the budget runs out, idle connections' windows are
+  // shrunk to make room. The default is QNETHERNET_TCP_WND_BUDGET.
+  static void setReceiveWindowBudget(size_t budget);
+
+  // Returns the receive window budget.
+  static size_t receiveWindowBudget();
+
+  // Returns the total of all the connections' receive windows.
+  static size_t receiveWindowTotal();
+
+  // TCP PCB statistics. A PCB is the stack's state for one connection, and
+  // there are MEMP_NUM_TCP_PCB of them, not counting listeners.
+  struct PcbStats final {
+    size_t capacity    = 0;  // Total number of PCBs
+    size_t active      = 0;  // PCBs in use, not counting TIME_WAIT
+    size_t timeWait    = 0;  // PCBs in TIME_WAIT
+    uint32_t exhausted = 0;  // Times there were no free PCBs
+    uint32_t recycled  = 0;  // TIME_WAIT PCBs freed early to make room
+    uint32_t reused    = 0;  // TIME_WAIT PCBs taken over by a new SYN
+    uint32_t failed    = 0;  // Times a PCB couldn't be allocated
+  };
+
+  // Returns the TCP PCB statistics. The counters are all zero if
+  // QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY is disabled.
+  static PcbStats pcbStats();
+
+  // Sets the PCB counters to zero.
+  static void resetPcbStats();
+
+  // Sets the time, in milliseconds, that a closed connection stays in
+  // TIME_WAIT. The side that closes first keeps its PCB this long so that
+  // stray segments from the old connection can't be mistaken for a new one.
+  // Shorter times free PCBs sooner when there are many short connections. The
+  // time is checked every TCP_SLOW_INTERVAL. The default is
+  // QNETHERNET_DEFAULT_TCP_TIME_WAIT_TIMEOUT.
+  //
+  // This does nothing if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY is disabled.
+  static void setTimeWaitTimeout(uint32_t timeout);
+
+  // Returns the time that a closed connection stays in TIME_WAIT.
+  static uint32_t timeWaitTimeout();
+
   // Returns a Boolean value.
   //
   // Waiting can be disabled by setConnectionTimeoutEnabled(false).
@@ -195,7 +288,7 @@ class EthernetClient : public internal::ClientEx,
   size_t writeFully(const void* buf, size_t size);
 
   // Use the one from here instead of the one from Print
-  using internal::PrintfChecked::printf;
+  using internal::PrintfChecked<EthernetClient>::printf;
 
   // If this returns zero and there was an error then errno will be set.
   size_t write(uint8_t b) final;
@@ -208,6 +301,27 @@ class EthernetClient : public internal::ClientEx,
     return write(static_cast<const uint8_t*>(buf), size);
   }
 
+  // Writes data without copying it into the stack. The data must stay valid
+  // and unchanged until the callback is called. The callback is called with
+  // true once the remote side has acknowledged all the written bytes, or with
+  // false if the connection went away first. It's called from within the
+  // stack, so it must not close or abort this connection, but it may write
+  // more data.
+  //
+  // Like write(), this may write fewer bytes than requested, and the callback
+  // only covers the bytes actually written. It isn't called if nothing was
+  // written. If this returns zero and there was an error then errno will be
+  // set. For example, the stack may run out of buffer references (ENOMEM),
+  // in which case try again later.
+  //
+  // When the connection closes with data still unacknowledged, the callback
+  // is called once that data is acknowledged or the connection is reset.
+  //
+  // With altcp, for example TLS, the data is copied, and the callback is
+  // still called when the underlying data is acknowledged.
+  size_t writeNoCopy(const void* buf, size_t size,
+                     std::function<void(bool acked)> cb);
+
   int availableForWrite() final;
   void flush() final;
 
@@ -228,6 +342,47 @@ class EthernetClient : public internal::ClientEx,
   //       having to modify the lwIP code for this feature
 #endif  // !LWIP_ALTCP || defined(LWIP_DEBUG)
 
+  // -------------------
+  //  Asynchronous Events
+  // -------------------
+
+  // An event callback. It's called with a client for the connection, which
+  // can be copied if needed.
+  using EventFunction = std::function<void(EthernetClient& client)>;
+
+  // The following set callbacks that are called from Ethernet.loop() when
+  // something happens on the connection, instead of having to poll. They're
+  // never called from inside the stack, so it's safe to do anything in them,
+  // including closing the connection, but avoid the functions that wait, for
+  // example stop() or connect() with a timeout. Use close() and
+  // connectNoWait() instead.
+  //
+  // The callbacks belong to the connection, not to this object, so they must
+  // be set after connectNoWait() or accept(), and they're kept when this
+  // object is copied. They're released after the "closed" callback. Don't
+  // capture this object or a copy of it in a callback because that keeps the
+  // connection alive until it closes; use the client parameter instead.
+  //
+  // These do nothing if there's no connection. An empty function removes
+  // the callback.
+
+  // Sets the callback for when a connection started with connectNoWait()
+  // is established.
+  void onConnected(EventFunction cb);
+
+  // Sets the callback for when new data arrives. This isn't called again
+  // until more data arrives, so read everything or check available() later.
+  void onData(EventFunction cb);
+
+  // Sets the callback for when sent data has been acknowledged and there's
+  // more room to write.
+  void onWritable(EventFunction cb);
+
+  // Sets the callback for when the connection is closed or reset. After a
+  // local close(), this is called once the remote side closes too. Any data
+  // that arrived before the close can still be read.
+  void onClosed(EventFunction cb);
+
   // ----------------
   //  Socket Options
   // ----------------
@@ -243,6 +398,92 @@ class EthernetClient : public internal::ClientEx,
   // returns false if not connected.
   bool isNoDelay() const;
 
+  // Corks or uncorks the connection, similar to Linux's TCP_CORK option. While
+  // corked, written data is only sent in full segments. Data that doesn't fill
+  // a segment is held until the connection is uncorked, flush() is called, or
+  // the cork timeout expires. Uncorking sends everything. This is useful for
+  // building a response out of many small print() calls. The default is false.
+  //
+  // This returns true if connected and the option was set, and false
+  // otherwise. Note that this option must be set for each new connection.
+  bool setCork(bool flag);
+
+  // Returns whether the current connection is corked. This returns false if
+  // not connected.
+  bool isCorked() const;
+
+  // Sets the longest time, in milliseconds, that a corked connection holds
+  // data that doesn't fill a segment. The default is
+  // QNETHERNET_DEFAULT_TCP_CORK_TIMEOUT.
+  //
+  // This returns true if connected and the option was set, and false
+  // otherwise. Note that this option must be set for each new connection.
+  bool setCorkTimeout(uint32_t timeout);
+
+  // Returns the cork timeout for the current connection. This returns zero if
+  // not connected.
+  uint32_t corkTimeout() const;
+
+  // Sets whether received data is queued by holding onto the stack's buffers
+  // (pbufs) instead of copying it into a per-connection buffer. This removes a
+  // copy per byte and frees the connection's receive buffer space. The data is
+  // acknowledged to the remote side as it's read, so the advertised window
+  // tracks what the application has consumed. The default is false.
+  //
+  // Each queued segment holds a buffer from the stack's pool until it's read,
+  // so slow readers with many connections may exhaust the pool.
+  //
+  // This returns true if connected and the option was set, and false
+  // otherwise. Note that this option must be set for each new connection.
+  bool setZeroCopyReceive(bool flag);
+
+  // Returns whether zero-copy receive is enabled for the current connection.
+  // This returns false if not connected.
+  bool isZeroCopyReceive() const;
+
+  // Returns the connection's current receive window, in bytes, or zero if not
+  // connected. See setReceiveWindowBudget().
+  size_t receiveWindow() const;
+
+  // A snapshot of a connection's TCP state, similar to Linux's TCP_INFO. The
+  // times come from the stack's slow timer, so they're only as precise as
+  // TCP_SLOW_INTERVAL (500ms by default).
+  struct TcpInfo final {
+    enum tcp_state state = CLOSED;
+    uint16_t mss         = 0;  // Max. segment size for sending
+    uint32_t rtt         = 0;  // Smoothed round-trip time, in ms
+    uint32_t rttVar      = 0;  // Round-trip time variation, in ms
+    uint32_t rto         = 0;  // Retransmission timeout, in ms
+    bool rttMeasuring    = false;  // Whether a segment is being timed
+    uint8_t backoff      = 0;  // Retransmissions of the current segment
+    uint8_t dupAcks      = 0;  // Duplicate ACKs received in a row
+    uint8_t probes       = 0;  // Zero-window probes sent in a row
+    uint32_t cwnd        = 0;  // Congestion window
+    uint32_t ssthresh    = 0;  // Slow-start threshold
+    uint32_t sendWindow  = 0;  // Window offered by the remote side
+    uint32_t receiveWindow    = 0;  // Stack's receive window
+    uint32_t advertisedWindow = 0;  // Window last advertised to the remote side
+    uint32_t unackedBytes     = 0;  // Sent but not yet acknowledged
+    uint32_t unsentBytes      = 0;  // Written but not yet sent
+    uint16_t queuedSegments   = 0;  // Segments held by the stack
+
+    // Cumulative counters, all zero if QNETHERNET_ENABLE_TCP_COUNTERS
+    // is disabled
+    uint64_t bytesSent           = 0;  // New data, not counting retransmits
+    uint64_t bytesReceived       = 0;  // Including duplicates
+    uint64_t bytesRetransmitted  = 0;
+    uint32_t segmentsSent        = 0;  // Including retransmits and pure ACKs
+    uint32_t segmentsReceived    = 0;
+    uint32_t retransmits         = 0;  // Segments sent again
+    uint32_t outOfOrder          = 0;  // Segments received ahead of a gap
+    uint32_t zeroWindowsReceived = 0;  // Times the remote side's window closed
+    uint32_t zeroWindowsSent     = 0;  // Times this side's window closed
+  };
+
+  // Fills in a snapshot of the connection's TCP state and counters. This
+  // returns false if not connected, in which case 'info' isn't changed.
+  bool tcpInfo(TcpInfo& info) const;
+
   // Sets the differentiated services (DiffServ, DS) field in the outgoing IP
   // header. The top 6 bits are the differentiated services code point (DSCP)
   // value, and the bottom 2 bits are the explicit congestion notification
@@ -273,6 +514,15 @@ class EthernetClient : public internal::ClientEx,
   // unconnected client will be created.
   explicit EthernetClient(std::shared_ptr<internal::ConnectionHolder> holder);
 
+  // Wraps an event callback so that it's called with a client for this
+  // connection. The wrapper doesn't keep the connection alive.
+  std::function<void()> makeEventFunc(EventFunction cb) const;
+
+  // Writes data. If 'cb' is not NULL then the data isn't copied and the
+  // callback is moved into the list of pending writes if anything was written.
+  size_t write(const uint8_t* buf, size_t size,
+               std::function<void(bool acked)>* cb);
+
   // ip_addr_t version of connect() function.
   ATTRIBUTE_NODISCARD
   bool connect(const ip_addr_t* ipaddr, uint16_t port, bool wait);
@@ -43,37 +43,77 @@ err_t EthernetFrameClass::recvFunc(struct pbuf* const p,
 
   const uint32_t timestamp = sys_now();
 
-  const struct pbuf* pNext = p;
+  // Limit the size
+  size_t size = p->tot_len;
+  if ((EthernetFrame.maxReceiveSize_ != 0) &&
+      (size > EthernetFrame.maxReceiveSize_)) {
+    size = EthernetFrame.maxReceiveSize_;
+    ++EthernetFrame.truncatedReceiveCount_;
+  }
 
-  // Push
-  if (EthernetFrame.inBuf_.full()) {
+  ++EthernetFrame.totalReceiveCount_;
+  if (!EthernetFrame.makeReceiveRoom(size)) {
     ++EthernetFrame.droppedReceiveCount_;
+    (void)pbuf_free(p);
+    return ERR_OK;
   }
+
+  // Push
+  const bool full = EthernetFrame.inBuf_.full();
   Frame& frame = EthernetFrame.inBuf_.put();
+  if (full) {
+    ++EthernetFrame.droppedReceiveCount_;
+    EthernetFrame.inBufBytes_ -= frame.data.size();
+  }
   frame.data.clear();
-  if (p->tot_len > 0) {
-    frame.data.reserve(p->tot_len);
-    // TODO: Limit vector size
-    while (pNext != nullptr) {
+  if (size > 0) {
+    internal::reserveSlotStorage(frame.data, size);
+    const struct pbuf* pNext = p;
+    while ((pNext != nullptr) && (frame.data.size() < size)) {
       const auto data = static_cast<const uint8_t*>(pNext->payload);
-      (void)frame.data.insert(frame.data.cend(), &data[0], &data[pNext->len]);
+      const size_t len = std::min(size_t{pNext->len}, size - frame.data.size());
+      (void)frame.data.insert(frame.data.cend(), &data[0], &data[len]);
       pNext = pNext->next;
     }
   }
+  EthernetFrame.inBufBytes_ += size;
   frame.receivedTimestamp = timestamp;
+  frame.hasHardwareTimestamp = enet::get_rx_timestamp(&frame.hardwareTimestamp);
 
   (void)pbuf_free(p);
-  ++EthernetFrame.totalReceiveCount_;
 
   return ERR_OK;
 }
 
+bool EthernetFrameClass::makeReceiveRoom(const size_t size) {
+  if (inBufByteCapacity_ == 0) {
+    return true;
+  }
+  if (size > inBufByteCapacity_) {
+    return false;
+  }
+  while (inBufBytes_ + size > inBufByteCapacity_) {
+    inBufBytes_ -= inBuf_.get().data.size();
+    ++droppedReceiveCount_;
+  }
+  return true;
+}
+
+void EthernetFrameClass::updateReceiveQueueBytes() {
+  inBufBytes_ = 0;
+  for (size_t i = 0; i < inBuf_.size(); ++i) {
+    inBufBytes_ += inBuf_[i].data.size();
+  }
+}
+
 FLASHMEM EthernetFrameClass::EthernetFrameClass()
     : inBuf_(1) {}
 
 void EthernetFrameClass::Frame::clear() {
   data.clear();
   receivedTimestamp = 0;
+  hasHardwareTimestamp = false;
+  hardwareTimestamp = 0;
 }
 
 void EthernetFrameClass::clear() {
@@ -83,11 +123,15 @@ void EthernetFrameClass::clear() {
     outFrame_.value.clear();
   }
 
-  // Incoming
+  // Incoming; CircularBuffer::clear() only resets the indices
   for (size_t i = 0; i < inBuf_.size(); ++i) {
     inBuf_[i].clear();
   }
   inBuf_.clear();
+  inBufBytes_ = 0;
+
+  frame_.clear();
+  framePos_ = -1;
 }
 
 // --------------------------------------------------------------------------
@@ -100,8 +144,9 @@ int EthernetFrameClass::parseFrame() {
     return -1;
   }
 
-  // Pop
-  frame_ = std::move(inBuf_.get());
+  // Pop; the previous frame's storage goes to the slot
+  std::swap(frame_, inBuf_.get());
+  inBufBytes_ -= frame_.data.size();
 
   Ethernet.loop();  // Allow the stack to move along
 
@@ -153,6 +198,14 @@ int EthernetFrameClass::peek() {
   return frame_.data[framePos_];
 }
 
+bool EthernetFrameClass::receivedHardwareTimestamp(uint64_t& timestamp) const {
+  if (!frame_.hasHardwareTimestamp) {
+    return false;
+  }
+  timestamp = frame_.hardwareTimestamp;
+  return true;
+}
+
 const uint8_t* EthernetFrameClass::destinationMAC() const {
   return data();
 }
@@ -176,9 +229,21 @@ const uint8_t* EthernetFrameClass::payload() const {
 void EthernetFrameClass::setReceiveQueueCapacity(const size_t capacity) {
   // ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
   inBuf_.setCapacity(capacity);
+  updateReceiveQueueBytes();
   // }
 }
 
+void EthernetFrameClass::setReceiveQueueByteCapacity(const size_t capacity) {
+  inBufByteCapacity_ = capacity;
+  if (capacity == 0) {
+    return;
+  }
+  while (inBufBytes_ > capacity) {
+    inBufBytes_ -= inBuf_.get().data.size();
+    ++droppedReceiveCount_;
+  }
+}
+
 // --------------------------------------------------------------------------
 //  Transmission
 // --------------------------------------------------------------------------
@@ -230,13 +295,20 @@ bool EthernetFrameClass::endFrame() {
 
   const bool retval = enet::output_frame(outFrame_.value.data.data(),
                                          outFrame_.value.data.size());
+  txFrame_ = retval ? enet::get_last_tx_frame() : 0;
   outFrame_.has_value = false;
   outFrame_.value.clear();
   return retval;
 }
 
-bool EthernetFrameClass::send(const void* const frame, const size_t len) const {
-  return enet::output_frame(frame, len);
+bool EthernetFrameClass::send(const void* const frame, const size_t len) {
+  const bool retval = enet::output_frame(frame, len);
+  txFrame_ = retval ? enet::get_last_tx_frame() : 0;
+  return retval;
+}
+
+bool EthernetFrameClass::sentHardwareTimestamp(uint64_t& timestamp) const {
+  return enet::get_tx_timestamp(txFrame_, &timestamp);
 }
 
 size_t EthernetFrameClass::write(const uint8_t b) {
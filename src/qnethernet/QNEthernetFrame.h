@@ -44,7 +44,9 @@ namespace network {
 // 1. IPv4 (0x0800)
 // 2. ARP  (0x0806)
 // 3. IPv6 (0x86DD) (if enabled)
-class EthernetFrameClass final : public Stream, public internal::PrintfChecked {
+class EthernetFrameClass final
+    : public Stream,
+      public internal::PrintfChecked<EthernetFrameClass> {
  public:
   // Returns the maximum frame length. This includes any padding but does not
   // include the 4-byte FCS (Frame Check Sequence, the CRC value).
@@ -106,10 +108,10 @@ class EthernetFrameClass final : public Stream, public internal::PrintfChecked {
   // 3. The length is not in the range [14, maxFrameLen()-4] for non-VLAN frames
   //    or [18, maxFrameLen()] for VLAN frames (excludes the FCS), or
   // 4. There's no room in the output buffers.
-  bool send(const void* frame, size_t len) const;
+  bool send(const void* frame, size_t len);
 
   // Use the one from here instead of the one from Print
-  using internal::PrintfChecked::printf;
+  using internal::PrintfChecked<EthernetFrameClass>::printf;
 
   // Bring Print::write functions into scope
   using Print::write;
@@ -161,6 +163,23 @@ class EthernetFrameClass final : public Stream, public internal::PrintfChecked {
     return frame_.receivedTimestamp;
   }
 
+  // Gets the hardware timestamp, in nanoseconds on the driver's clock, of the
+  // received frame. This returns whether there is one; it won't exist if the
+  // driver doesn't support frame timestamps. This is only valid if a frame has
+  // been received with parseFrame().
+  //
+  // See: EthernetClass::driverCapabilities().isFrameTimestampable
+  bool receivedHardwareTimestamp(uint64_t& timestamp) const;
+
+  // Gets the hardware transmit timestamp, in nanoseconds on the driver's clock,
+  // of the last frame sent with endFrame() or send(). This returns whether the
+  // timestamp is available. It won't be available until the frame has left the
+  // hardware or if the driver doesn't support frame timestamps.
+  //
+  // The timestamp is only kept until the driver reuses the transmit descriptor,
+  // so it should be retrieved soon after the send.
+  bool sentHardwareTimestamp(uint64_t& timestamp) const;
+
   // Returns a pointer to the destination MAC. This is only valid if a frame has
   // been received with parseFrame() or has had this value written.
   //
@@ -208,6 +227,40 @@ class EthernetFrameClass final : public Stream, public internal::PrintfChecked {
     return inBuf_.size();
   }
 
+  // Sets the total number of frame bytes the receive queue may hold, in
+  // addition to the frame count limit. Zero means no byte limit, which is
+  // the default.
+  //
+  // When a new frame doesn't fit, the oldest frames are dropped until it does.
+  // A frame larger than the whole byte capacity is dropped. If the new capacity
+  // is smaller than the number of queued bytes then the oldest frames that
+  // don't fit are dropped. All of these are counted as dropped.
+  void setReceiveQueueByteCapacity(size_t capacity);
+
+  // Returns the total number of frame bytes the receive queue may hold, or
+  // zero if there's no byte limit.
+  size_t receiveQueueByteCapacity() const {
+    return inBufByteCapacity_;
+  }
+
+  // Returns the number of frame bytes currently in the receive queue.
+  size_t receiveQueueBytes() const {
+    return inBufBytes_;
+  }
+
+  // Sets the maximum size of a received frame. Larger frames are truncated to
+  // this size and counted by truncatedReceiveCount(). Zero means no maximum,
+  // which is the default.
+  void setMaxReceiveSize(size_t size) {
+    maxReceiveSize_ = size;
+  }
+
+  // Returns the maximum size of a received frame, or zero if there's
+  // no maximum.
+  size_t maxReceiveSize() const {
+    return maxReceiveSize_;
+  }
+
   // Returns the total number of dropped received frames since reception was
   // started. Note that this is the count of dropped frames at the layer above
   // the driver.
@@ -222,13 +275,21 @@ class EthernetFrameClass final : public Stream, public internal::PrintfChecked {
     return totalReceiveCount_;
   }
 
-  // Clears any outgoing frame and the incoming queue.
+  // Returns the total number of received frames that were truncated because
+  // they were larger than the maximum receive size.
+  uint32_t truncatedReceiveCount() const {
+    return truncatedReceiveCount_;
+  }
+
+  // Clears any outgoing frame, the incoming queue, and the current frame.
   void clear();
 
  private:
   struct Frame final {
     std::vector<uint8_t> data;
     volatile uint32_t receivedTimestamp = 0;  // Approximate arrival time
+    bool hasHardwareTimestamp = false;
+    uint64_t hardwareTimestamp = 0;           // Frame timestamp, in ns
 
     // Clears all the data.
     void clear();
@@ -245,12 +306,23 @@ class EthernetFrameClass final : public Stream, public internal::PrintfChecked {
 
   static err_t recvFunc(struct pbuf* p, struct netif* netif);
 
+  // Drops the oldest queued frames until a new one of the given size fits
+  // within the byte capacity. This returns false if it can't fit.
+  ATTRIBUTE_NODISCARD
+  bool makeReceiveRoom(size_t size);
+
+  // Recalculates the number of queued bytes.
+  void updateReceiveQueueBytes();
+
   // Checks if there's data still available in the packet.
   ATTRIBUTE_NODISCARD
   bool isAvailable() const;
 
   // Received frames; updated every time one is received
   internal::CircularBuffer<Frame> inBuf_;
+  size_t inBufBytes_        = 0;  // Frame bytes in the queue
+  size_t inBufByteCapacity_ = 0;  // Zero for no limit
+  size_t maxReceiveSize_    = 0;  // Zero for no maximum
 
   // Frame being processed by the caller
   Frame frame_;   // Holds the frame being read
@@ -258,10 +330,12 @@ class EthernetFrameClass final : public Stream, public internal::PrintfChecked {
 
   // Outgoing frames
   internal::optional<Frame> outFrame_;
+  uint32_t txFrame_ = 0;  // Driver frame ID of the last sent frame
 
   // Stats
-  uint32_t droppedReceiveCount_ = 0;
-  uint32_t totalReceiveCount_   = 0;
+  uint32_t droppedReceiveCount_   = 0;
+  uint32_t totalReceiveCount_     = 0;
+  uint32_t truncatedReceiveCount_ = 0;
 
   friend err_t ::unknown_eth_protocol(struct pbuf* p, struct netif* netif);
 
@@ -11,9 +11,14 @@
 // C++ includes
 #include <cerrno>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "QNEthernet.h"
+#include "lwip/altcp.h"
 #include "qnethernet/internal/ConnectionManager.h"
+#include "qnethernet/lwip_hooks.h"
+#include "qnethernet_opts.h"
 
 namespace qindesign {
 namespace network {
@@ -28,6 +33,15 @@ EthernetServer::~EthernetServer() noexcept {
                       // ConnectionManager::stopListening()
 }
 
+EthernetServer::SynCookieStats EthernetServer::synCookieStats() {
+  SynCookieStats stats;
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+  tcp_syn_cookie_stats(&stats.sent, &stats.accepted, &stats.rejected,
+                       &stats.failed);
+#endif  // QNETHERNET_ENABLE_TCP_SYN_COOKIES
+  return stats;
+}
+
 int32_t EthernetServer::port() const {
   if (!port_.has_value) {
     return -1;
@@ -76,6 +90,7 @@ bool EthernetServer::begin(const uint16_t port, const bool reuse) {
     listeningPort_ = p.value;
     port_ = {true, (port == 0) ? uint16_t{0} : p.value};
     reuse_ = reuse;
+    setAcceptFunc();
     return true;
   }
   // Note: errno set by listen()
@@ -106,6 +121,33 @@ EthernetClient EthernetServer::accept() const {
   return EthernetClient{};
 }
 
+void EthernetServer::onAccept(EthernetClient::EventFunction cb) {
+  acceptCB_ = std::move(cb);
+  if (listeningPort_ > 0) {
+    setAcceptFunc();
+  }
+}
+
+void EthernetServer::setAcceptFunc() const {
+  if (acceptCB_ == nullptr) {
+    internal::ConnectionManager::instance().setAcceptFunc(listeningPort_,
+                                                          nullptr);
+    return;
+  }
+
+  const EthernetClient::EventFunction cb = acceptCB_;
+  internal::ConnectionManager::instance().setAcceptFunc(
+      listeningPort_,
+      [cb](const std::shared_ptr<internal::ConnectionHolder>& holder) {
+        if (holder->accepted) {
+          return;  // Already returned by accept()
+        }
+        holder->accepted = true;
+        EthernetClient client{holder};
+        cb(client);
+      });
+}
+
 EthernetClient EthernetServer::available() const {
   if (listeningPort_ > 0) {
     const auto conn =
@@ -152,6 +194,81 @@ void EthernetServer::flush() {
   internal::ConnectionManager::instance().flush(listeningPort_);
 }
 
+EthernetServer::BroadcastResult EthernetServer::broadcast(
+    const void* const buf, const size_t size, const BroadcastOptions& options,
+    const BroadcastStatusFunction& statusFunc) {
+  BroadcastResult result;
+  if ((listeningPort_ == 0) || (size == 0)) {
+    return result;
+  }
+
+  const std::vector<std::shared_ptr<internal::ConnectionHolder>> conns =
+      internal::ConnectionManager::instance().connections(listeningPort_);
+  if (conns.empty()) {
+    return result;
+  }
+
+  // The one copy shared by all the connections
+  const auto p = static_cast<const uint8_t*>(buf);
+  const internal::ConnectionState::SharedData data =
+      std::make_shared<const std::vector<uint8_t>>(p, p + size);
+
+  for (const auto& holder : conns) {
+    // A status function may have closed this connection
+    const auto& state = holder->state;
+    if (state == nullptr) {
+      continue;
+    }
+
+    // Corked data, and then older messages, go first
+    if (!state->corkBuf.empty()) {
+      (void)state->sendCorked(true);
+    }
+    if (!state->queuedWrites.empty() && state->corkBuf.empty()) {
+      state->sendQueued();
+    }
+    const size_t room =
+        (state->queuedWrites.empty() && state->corkBuf.empty())
+            ? altcp_sndbuf(state->pcb)
+            : 0;
+    const size_t spare = (state->queuedBytes < options.bufferLimit)
+                             ? options.bufferLimit - state->queuedBytes
+                             : 0;
+
+    BroadcastStatus status;
+    if (size <= room + spare) {
+      const size_t written = (room > 0) ? state->writeShared(data, 0) : 0;
+      if (written < size) {
+        state->queueShared(data, written);
+        status = BroadcastStatus::kQueued;
+        ++result.queued;
+      } else {
+        status = BroadcastStatus::kSent;
+        ++result.sent;
+      }
+#if QNETHERNET_FLUSH_AFTER_TCP_WRITE
+      // TODO: Is ignoring the return the correct thing to do?
+      (void)altcp_output(state->pcb);
+#endif  // QNETHERNET_FLUSH_AFTER_TCP_WRITE
+    } else if (options.policy == SlowConsumerPolicy::kDisconnect) {
+      altcp_abort(state->pcb);
+      status = BroadcastStatus::kDisconnected;
+      ++result.disconnected;
+    } else {
+      status = BroadcastStatus::kDropped;
+      ++result.dropped;
+    }
+
+    if (statusFunc != nullptr) {
+      EthernetClient client{holder};
+      statusFunc(client, status);
+    }
+  }
+
+  Ethernet.loop();  // Loop to allow incoming TCP data
+  return result;
+}
+
 }  // namespace network
 }  // namespace qindesign
 
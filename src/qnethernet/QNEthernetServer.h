@@ -13,6 +13,7 @@
 // C++ includes
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 
 #ifdef ARDUINO_ARCH_STM32
 #include <Arduino.h>  // STM32's Arduino needs this for namespace arduino
@@ -28,8 +29,54 @@
 namespace qindesign {
 namespace network {
 
-class EthernetServer : public Server, public internal::PrintfChecked {
+class EthernetServer : public Server,
+                       public internal::PrintfChecked<EthernetServer> {
  public:
+  // What broadcast() does with a connection that can't take a whole message.
+  enum class SlowConsumerPolicy : uint8_t {
+    kDrop,        // Skip the message for that connection
+    kDisconnect,  // Abort the connection
+  };
+
+  // What happened to a broadcast message for one connection.
+  enum class BroadcastStatus : uint8_t {
+    kSent,          // Handed to the stack
+    kQueued,        // At least some of it is waiting for send space
+    kDropped,       // Not sent to this connection
+    kDisconnected,  // The connection was aborted
+  };
+
+  // Options for broadcast().
+  struct BroadcastOptions final {
+    // The most data, in bytes, that may wait for send space in each
+    // connection. Zero means a message is sent to a connection only if it
+    // fits right away.
+    size_t bufferLimit = 0;
+
+    // What to do when a message doesn't fit
+    SlowConsumerPolicy policy = SlowConsumerPolicy::kDrop;
+  };
+
+  // Connection counts for a broadcast() call.
+  struct BroadcastResult final {
+    size_t sent         = 0;
+    size_t queued       = 0;
+    size_t dropped      = 0;
+    size_t disconnected = 0;
+  };
+
+  // Function that receives the outcome for each connection.
+  using BroadcastStatusFunction =
+      std::function<void(EthernetClient& client, BroadcastStatus status)>;
+
+  // SYN cookie counts for all the listeners.
+  struct SynCookieStats final {
+    uint32_t sent     = 0;  // SYN|ACKs sent with a cookie
+    uint32_t accepted = 0;  // Connections created from a returned cookie
+    uint32_t rejected = 0;  // ACKs whose cookie didn't match or had expired
+    uint32_t failed   = 0;  // Valid cookies with no free connection
+  };
+
   EthernetServer() = default;
   explicit EthernetServer(uint16_t port);
 
@@ -46,6 +93,14 @@ class EthernetServer : public Server, public internal::PrintfChecked {
     return MEMP_NUM_TCP_PCB_LISTEN;
   }
 
+  // Returns the SYN cookie counts for all the listeners. A listener answers a
+  // SYN with a cookie, instead of dropping it, when its backlog is full or
+  // there are no free connections. These are all zero if SYN cookies
+  // are disabled.
+  //
+  // See: QNETHERNET_ENABLE_TCP_SYN_COOKIES
+  static SynCookieStats synCookieStats();
+
   // Returns the server port. This will return -1 if it is not set. If the port
   // was specified to be zero, then this will return a system-chosen value if
   // the socket has been started or zero if the socket has not been started.
@@ -105,6 +160,17 @@ class EthernetServer : public Server, public internal::PrintfChecked {
   // This function is defined by the Arduino API.
   EthernetClient accept() const;
 
+  // Sets a callback that's called from Ethernet.loop() for each new
+  // connection, instead of having to poll accept(). The connection is already
+  // accepted, and this is the place to set its event callbacks. Connections
+  // already returned by accept() are skipped. An empty function removes
+  // the callback.
+  //
+  // The callback is kept across calls to begin() and end().
+  //
+  // See: EthernetClient::onData()
+  void onAccept(EthernetClient::EventFunction cb);
+
   // Finds a connection with available data. This returns an unconnected client
   // if there is no client with available data or if the port is not set.
   //
@@ -112,7 +178,7 @@ class EthernetServer : public Server, public internal::PrintfChecked {
   EthernetClient available() const;
 
   // Use the one from here instead of the one from Print
-  using internal::PrintfChecked::printf;
+  using internal::PrintfChecked<EthernetServer>::printf;
 
   // Bring Print::write functions into scope
   using Print::write;
@@ -137,6 +203,25 @@ class EthernetServer : public Server, public internal::PrintfChecked {
   // Flushes all the connections, but does nothing if the port is not set.
   void flush() final;
 
+  // Sends the same message to all the connections. Unlike write(), the data is
+  // copied once and shared by every connection, and it's sent whole or not at
+  // all to each one.
+  //
+  // A message that doesn't fit in a connection's send buffer waits for space if
+  // the connection's waiting data would stay within the options' buffer limit.
+  // Otherwise, the slow-consumer policy is applied. While data is waiting,
+  // other writes to that connection send nothing. Queued data is sent from
+  // Ethernet.loop() as the remote side acknowledges earlier data.
+  //
+  // If 'statusFunc' is set then it's called with the outcome for
+  // each connection.
+  //
+  // This returns the number of connections having each outcome. It does nothing
+  // if the port is not set or the size is zero.
+  BroadcastResult broadcast(
+      const void* buf, size_t size, const BroadcastOptions& options,
+      const BroadcastStatusFunction& statusFunc = nullptr);
+
   // Returns whether the server is listening on a port.
   //
   // This function is defined by the Arduino API.
@@ -146,6 +231,9 @@ class EthernetServer : public Server, public internal::PrintfChecked {
   ATTRIBUTE_NODISCARD
   bool begin(uint16_t port, bool reuse);
 
+  // Registers the accept callback, if any, with the listening port.
+  void setAcceptFunc() const;
+
   internal::optional<uint16_t>
       port_;            // Zero means let the system choose a port
   bool reuse_ = false;  // Whether the SO_REUSEADDR socket option is set
@@ -153,6 +241,8 @@ class EthernetServer : public Server, public internal::PrintfChecked {
   // The listening port may be different from the requested port, say if the
   // requested port is zero.
   uint16_t listeningPort_ = 0;
+
+  EthernetClient::EventFunction acceptCB_;
 };
 
 }  // namespace network
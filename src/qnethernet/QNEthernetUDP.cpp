@@ -22,6 +22,7 @@
 #include "lwip/prot/ip4.h"
 #include "lwip/sys.h"
 #include "qnethernet/QNDNSClient.h"
+#include "qnethernet/lwip_driver.h"
 #include "qnethernet/util/ip_tools.h"
 #include "qnethernet_opts.h"
 
@@ -58,35 +59,128 @@ void EthernetUDP::recvFunc(void* const arg, struct udp_pcb* const pcb,
     return;
   }
 
+  if (udp->receiveCB_) {
+    ++udp->totalReceiveCount_;  // The callback might stop the socket
+    udp->callReceiveCallback(pcb, p, addr, port);
+    (void)pbuf_free(p);
+    return;
+  }
+
   const uint32_t timestamp = sys_now();
 
-  const struct pbuf* pNext = p;
+  // Limit the size
+  size_t size = p->tot_len;
+  if ((udp->maxReceiveSize_ != 0) && (size > udp->maxReceiveSize_)) {
+    size = udp->maxReceiveSize_;
+    ++udp->truncatedReceiveCount_;
+  }
 
-  // Push
-  if (udp->inBuf_.full()) {
+  ++udp->totalReceiveCount_;
+  if (!udp->makeReceiveRoom(size)) {
     ++udp->droppedReceiveCount_;
+    (void)pbuf_free(p);
+    return;
   }
+
+  // Push
+  const bool full = udp->inBuf_.full();
   Packet& packet = udp->inBuf_.put();
-  packet.clear();
-  if (pNext->tot_len > 0) {
-    packet.data.reserve(pNext->tot_len);
-    // TODO: Limit vector size
-    while (pNext != nullptr) {
+  if (full) {
+    ++udp->droppedReceiveCount_;
+    udp->inBufBytes_ -= packet.size();
+  }
+  packet.clear();  // Also frees any overwritten pbuf
+  const bool keepPbuf = udp->zeroCopyReceive_ && (p->len == p->tot_len);
+  if (keepPbuf) {
+    if (size < p->len) {
+      pbuf_realloc(p, static_cast<uint16_t>(size));
+    }
+    packet.pbuf.reset(p);  // Take our reference
+  } else if (size > 0) {
+    internal::reserveSlotStorage(packet.data, size);
+    const struct pbuf* pNext = p;
+    while ((pNext != nullptr) && (packet.data.size() < size)) {
       const auto data = static_cast<const uint8_t*>(pNext->payload);
-      (void)packet.data.insert(packet.data.cend(), &data[0], &data[pNext->len]);
+      const size_t len =
+          std::min(size_t{pNext->len}, size - packet.data.size());
+      (void)packet.data.insert(packet.data.cend(), &data[0], &data[len]);
       pNext = pNext->next;
     }
   }
+  udp->inBufBytes_ += size;
   packet.addr = *addr;
   packet.port = port;
   packet.destAddr = *ip4_current_dest_addr();
   packet.receivedTimestamp = timestamp;
   packet.diffServ = pcb->tos;
   packet.ttl = pcb->ttl;
+  packet.hasHardwareTimestamp =
+      enet::get_rx_timestamp(&packet.hardwareTimestamp);
 
-  (void)pbuf_free(p);
+  if (!keepPbuf) {
+    (void)pbuf_free(p);
+  }
+}
 
-  ++udp->totalReceiveCount_;
+bool EthernetUDP::makeReceiveRoom(const size_t size) {
+  if (inBufByteCapacity_ == 0) {
+    return true;
+  }
+  if (size > inBufByteCapacity_) {
+    return false;
+  }
+  while (inBufBytes_ + size > inBufByteCapacity_) {
+    // Pop; this frees any pbuf
+    Packet& packet = inBuf_.get();
+    inBufBytes_ -= packet.size();
+    packet.clear();
+    ++droppedReceiveCount_;
+  }
+  return true;
+}
+
+void EthernetUDP::updateReceiveQueueBytes() {
+  inBufBytes_ = 0;
+  for (size_t i = 0; i < inBuf_.size(); ++i) {
+    inBufBytes_ += inBuf_[i].size();
+  }
+}
+
+void EthernetUDP::releaseReceivedPbufs() {
+  for (size_t i = 0; i < inBuf_.size(); ++i) {
+    inBuf_[i].copyOutPbuf();
+  }
+  packet_.copyOutPbuf();
+}
+
+void EthernetUDP::callReceiveCallback(const struct udp_pcb* const pcb,
+                                      const struct pbuf* const p,
+                                      const ip_addr_t* const addr,
+                                      const uint16_t port) {
+  PacketView view;
+  view.receivedTimestamp = sys_now();
+  view.size = p->tot_len;
+  if (p->len == p->tot_len) {
+    view.data = static_cast<const uint8_t*>(p->payload);
+  } else {
+    receiveCBBuf_.resize(p->tot_len);
+    (void)pbuf_copy_partial(p, receiveCBBuf_.data(), p->tot_len, 0);
+    view.data = receiveCBBuf_.data();
+  }
+#if LWIP_IPV4
+  view.remoteIP = util::ip_addr_get_ip4_uint32(addr);
+  view.destIP = ip4_addr_get_u32(ip4_current_dest_addr());
+#else
+  (void)addr;
+  view.remoteIP = INADDR_NONE;
+  view.destIP = INADDR_NONE;
+#endif  // LWIP_IPV4
+  view.remotePort = port;
+  view.diffServ = pcb->tos;
+  view.ttl = pcb->ttl;
+  view.hasHardwareTimestamp = enet::get_rx_timestamp(&view.hardwareTimestamp);
+
+  receiveCB_(view);
 }
 
 EthernetUDP::EthernetUDP() : EthernetUDP(1) {}
@@ -101,9 +195,24 @@ EthernetUDP::~EthernetUDP() noexcept {
 void EthernetUDP::setReceiveQueueCapacity(const size_t capacity) {
   // ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
   inBuf_.setCapacity(capacity);
+  updateReceiveQueueBytes();
   // }
 }
 
+void EthernetUDP::setReceiveQueueByteCapacity(const size_t capacity) {
+  inBufByteCapacity_ = capacity;
+  if (capacity == 0) {
+    return;
+  }
+  while (inBufBytes_ > capacity) {
+    // Pop; this frees any pbuf
+    Packet& packet = inBuf_.get();
+    inBufBytes_ -= packet.size();
+    packet.clear();
+    ++droppedReceiveCount_;
+  }
+}
+
 uint8_t EthernetUDP::begin(const uint16_t localPort) {
   return begin(localPort, false);
 }
@@ -163,6 +272,8 @@ bool EthernetUDP::begin(const uint16_t localPort, const bool reuse) {
   // Reset some state
   droppedReceiveCount_ = 0;
   totalReceiveCount_ = 0;
+  truncatedReceiveCount_ = 0;
+  batchDroppedCount_ = 0;
 
   return true;
 }
@@ -214,6 +325,8 @@ void EthernetUDP::stop() {
   pcb_ = nullptr;
   listening_ = false;
   listenReuse_ = false;
+
+  releaseReceivedPbufs();
 }
 
 bool EthernetUDP::setOutgoingDiffServ(const uint8_t ds) {
@@ -250,10 +363,22 @@ void EthernetUDP::Packet::clear() {
   diffServ = 0;
   ttl = 0;
   data.clear();
+  pbuf.reset();
   addr = *IP_ANY_TYPE;
   port = 0;
   destAddr = *IP_ANY_TYPE;
   receivedTimestamp = 0;
+  hasHardwareTimestamp = false;
+  hardwareTimestamp = 0;
+}
+
+void EthernetUDP::Packet::copyOutPbuf() {
+  if (pbuf == nullptr) {
+    return;
+  }
+  const uint8_t* const b = static_cast<const uint8_t*>(pbuf->payload);
+  data.assign(b, b + pbuf->len);
+  pbuf.reset();
 }
 
 // --------------------------------------------------------------------------
@@ -272,39 +397,42 @@ int EthernetUDP::parsePacket() {
     return -1;
   }
 
-  // Pop
-  packet_ = std::move(inBuf_.get());
+  // Pop; this frees any pbuf held by the previous packet and gives its storage
+  // to the slot
+  packet_.clear();
+  std::swap(packet_, inBuf_.get());
+  inBufBytes_ -= packet_.size();
 
   packetPos_ = 0;
-  return static_cast<int>(packet_.data.size());
+  return static_cast<int>(packet_.size());
 }
 
 inline bool EthernetUDP::isAvailable() const {
   return (0 <= packetPos_) &&
-         (static_cast<size_t>(packetPos_) < packet_.data.size());
+         (static_cast<size_t>(packetPos_) < packet_.size());
 }
 
 int EthernetUDP::available() {
   if (!isAvailable()) {
     return 0;
   }
-  return static_cast<int>(packet_.data.size() - packetPos_);
+  return static_cast<int>(packet_.size() - packetPos_);
 }
 
 int EthernetUDP::read() {
   if (!isAvailable()) {
     return -1;
   }
-  return packet_.data[packetPos_++];
+  return packet_.bytes()[packetPos_++];
 }
 
 int EthernetUDP::read(unsigned char* const buffer, const size_t len) {
   if ((len == 0) || !isAvailable()) {
     return 0;
   }
-  const size_t actualLen = std::min(len, packet_.data.size() - packetPos_);
+  const size_t actualLen = std::min(len, packet_.size() - packetPos_);
   if (buffer != nullptr) {
-    (void)std::copy_n(&packet_.data.data()[packetPos_], actualLen, buffer);
+    (void)std::copy_n(&packet_.bytes()[packetPos_], actualLen, buffer);
   }
   packetPos_ += actualLen;
   return actualLen;
@@ -318,7 +446,7 @@ int EthernetUDP::peek() {
   if (!isAvailable()) {
     return -1;
   }
-  return packet_.data[packetPos_];
+  return packet_.bytes()[packetPos_];
 }
 
 void EthernetUDP::flush() {
@@ -327,6 +455,56 @@ void EthernetUDP::flush() {
   // Instead, do a no-op.
 }
 
+size_t EthernetUDP::receiveBatch(Message* const msgs, const size_t count,
+                                 BatchInfo* const info) {
+  if (pcb_ == nullptr) {
+    if (info != nullptr) {
+      *info = BatchInfo{};
+    }
+    return 0;
+  }
+
+  Ethernet.loop();  // Allow the stack to move along
+
+  size_t n = 0;
+  size_t truncatedCount = 0;
+  for (; (n < count) && !inBuf_.empty(); ++n) {
+    // Pop; the packet stays in its slot until it's reused
+    Packet& packet = inBuf_.get();
+    inBufBytes_ -= packet.size();
+
+    Message& msg = msgs[n];
+    msg.size = packet.size();
+    msg.len = 0;
+    if (msg.buf != nullptr) {
+      msg.len = std::min(msg.size, msg.bufSize);
+      (void)std::copy_n(packet.bytes(), msg.len, msg.buf);
+      if (msg.len < msg.size) {
+        ++truncatedCount;
+      }
+    }
+#if LWIP_IPV4
+    msg.remoteIP = util::ip_addr_get_ip4_uint32(&packet.addr);
+    msg.destIP = util::ip_addr_get_ip4_uint32(&packet.destAddr);
+#else
+    msg.remoteIP = INADDR_NONE;
+    msg.destIP = INADDR_NONE;
+#endif  // LWIP_IPV4
+    msg.remotePort = packet.port;
+    msg.receivedTimestamp = packet.receivedTimestamp;
+
+    packet.clear();  // Frees any pbuf
+  }
+
+  if (info != nullptr) {
+    info->truncatedCount = truncatedCount;
+    info->droppedCount = droppedReceiveCount_ - batchDroppedCount_;
+  }
+  batchDroppedCount_ = droppedReceiveCount_;
+
+  return n;
+}
+
 IPAddress EthernetUDP::remoteIP() {
 #if LWIP_IPV4
   return util::ip_addr_get_ip4_uint32(&packet_.addr);
@@ -345,6 +523,14 @@ IPAddress EthernetUDP::destIP() const {
 #endif  // LWIP_IPV4
 }
 
+bool EthernetUDP::receivedHardwareTimestamp(uint64_t& timestamp) const {
+  if (!packet_.hasHardwareTimestamp) {
+    return false;
+  }
+  timestamp = packet_.hardwareTimestamp;
+  return true;
+}
+
 // --------------------------------------------------------------------------
 //  Transmission
 // --------------------------------------------------------------------------
@@ -389,6 +575,22 @@ bool EthernetUDP::beginPacket(const ip_addr_t* const ipaddr,
   outPacket_.value.addr = *ipaddr;
   outPacket_.value.port = port;
   outPacket_.value.data.clear();
+  outPacket_.value.pbuf.reset();
+  outPbufLen_ = 0;
+
+  if (zeroCopySend_) {
+    // Note: Use PBUF_RAM for TX
+    outPacket_.value.pbuf.reset(
+        pbuf_alloc(PBUF_TRANSPORT, static_cast<uint16_t>(kMaxPayloadSize),
+                   PBUF_RAM));
+    if (outPacket_.value.pbuf == nullptr) {
+      outPacket_.has_value = false;
+      Ethernet.loop();  // Allow the stack to move along
+      errno = ENOMEM;
+      return false;
+    }
+  }
+
   outPacket_.has_value = true;
   return true;
 }
@@ -399,6 +601,17 @@ int EthernetUDP::endPacket() {
   }
   Packet& op = outPacket_.value;
 
+  if (op.pbuf != nullptr) {
+    // outPbufLen_ is <= kMaxPayloadSize
+    pbuf_realloc(op.pbuf.get(), static_cast<uint16_t>(outPbufLen_));
+    const bool retval = sendPbuf(op.pbuf.get(), &op.addr, op.port);
+
+    outPacket_.has_value = false;
+    op.clear();  // Also frees the pbuf
+
+    return retval;
+  }
+
   // op.data.size() should be <= UINT16_MAX
   const size_t size = op.data.size();
   if (size > std::numeric_limits<uint16_t>::max()) {
@@ -431,18 +644,14 @@ int EthernetUDP::endPacket() {
     return false;
   }
 
-  err = udp_sendto(pcb_, p, &op.addr, op.port);
+  const bool retval = sendPbuf(p, &op.addr, op.port);
 
   outPacket_.has_value = false;
   op.clear();
 
   (void)pbuf_free(p);
 
-  if (err != ERR_OK) {
-    errno = err_to_errno(err);
-    return false;
-  }
-  return true;
+  return retval;
 }
 
 bool EthernetUDP::send(const IPAddress& ip, const uint16_t port,
@@ -505,10 +714,23 @@ bool EthernetUDP::send(const ip_addr_t* const ipaddr, const uint16_t port,
     return false;
   }
 
-  err = udp_sendto(pcb_, p, ipaddr, port);
+  const bool retval = sendPbuf(p, ipaddr, port);
 
   (void)pbuf_free(p);
 
+  return retval;
+}
+
+bool EthernetUDP::sendPbuf(struct pbuf* const p, const ip_addr_t* const ipaddr,
+                           const uint16_t port, struct netif* const netif) {
+  // If the frame goes out now then the last frame ID changes
+  const uint32_t lastFrame = enet::get_last_tx_frame();
+  const err_t err = (netif != nullptr)
+                        ? udp_sendto_if(pcb_, p, ipaddr, port, netif)
+                        : udp_sendto(pcb_, p, ipaddr, port);
+  const uint32_t frame = enet::get_last_tx_frame();
+  txFrame_ = (frame != lastFrame) ? frame : 0;
+
   if (err != ERR_OK) {
     errno = err_to_errno(err);
     return false;
@@ -516,10 +738,84 @@ bool EthernetUDP::send(const ip_addr_t* const ipaddr, const uint16_t port,
   return true;
 }
 
+size_t EthernetUDP::sendBatch(const Datagram* const datagrams,
+                              const size_t count) {
+#if LWIP_IPV4
+  if (!tryCreatePCB()) {
+    return 0;
+  }
+
+  ip_addr_t ipaddr = *IP_ANY_TYPE;
+  struct netif* netif = nullptr;
+  for (size_t i = 0; i < count; ++i) {
+    const Datagram& d = datagrams[i];
+    if (d.len > kMaxPossiblePayloadSize) {
+      errno = ENOBUFS;
+      return i;
+    }
+
+    // Route once per run of the same destination; the PCB's hardware address
+    // hint does the same for the link-layer address lookup. Leave multicast
+    // and interface-bound PCBs to udp_sendto() because they're routed
+    // specially.
+    const auto ip = static_cast<uint32_t>(d.ip);
+    if ((i == 0) || (ip != static_cast<uint32_t>(datagrams[i - 1].ip))) {
+      ip_addr_set_ip4_u32_val(ipaddr, ip);
+      if (ip_addr_ismulticast(&ipaddr) ||
+          (pcb_->netif_idx != NETIF_NO_INDEX)) {
+        netif = nullptr;
+      } else {
+        netif = ip_route(&pcb_->local_ip, &ipaddr);
+        if (netif == nullptr) {
+          errno = err_to_errno(ERR_RTE);
+          return i;
+        }
+      }
+    }
+
+    // Refer to the data instead of copying it; the stack copies it if it needs
+    // to hold onto it
+    struct pbuf* const p =
+        pbuf_alloc(PBUF_TRANSPORT, static_cast<uint16_t>(d.len), PBUF_REF);
+    if (p == nullptr) {
+      Ethernet.loop();  // Allow the stack to move along
+      errno = ENOMEM;
+      return i;
+    }
+    p->payload = const_cast<void*>(d.data);
+
+    const bool retval = sendPbuf(p, &ipaddr, d.port, netif);
+    (void)pbuf_free(p);
+    if (!retval) {
+      return i;
+    }
+  }
+  return count;
+#else
+  (void)datagrams;
+  (void)count;
+
+  errno = ENOSYS;
+  return 0;
+#endif  // LWIP_IPV4
+}
+
+bool EthernetUDP::sentHardwareTimestamp(uint64_t& timestamp) const {
+  return enet::get_tx_timestamp(txFrame_, &timestamp);
+}
+
 size_t EthernetUDP::write(const uint8_t b) {
   if (!outPacket_.has_value) {
     return 0;
   }
+  struct pbuf* const p = outPacket_.value.pbuf.get();
+  if (p != nullptr) {
+    if (outPbufLen_ >= p->len) {
+      return 0;
+    }
+    static_cast<uint8_t*>(p->payload)[outPbufLen_++] = b;
+    return 1;
+  }
   if (outPacket_.value.data.size() >= kMaxPossiblePayloadSize) {
     return 0;
   }
@@ -531,6 +827,15 @@ size_t EthernetUDP::write(const uint8_t* const buffer, const size_t size) {
   if (!outPacket_.has_value || (size == 0) || (buffer == nullptr)) {
     return 0;
   }
+  struct pbuf* const p = outPacket_.value.pbuf.get();
+  if (p != nullptr) {
+    // PBUF_RAM pbufs are contiguous
+    const size_t actualSize = std::min(p->len - outPbufLen_, size);
+    (void)std::copy_n(buffer, actualSize,
+                      &static_cast<uint8_t*>(p->payload)[outPbufLen_]);
+    outPbufLen_ += actualSize;
+    return actualSize;
+  }
   const size_t actualSize =
       std::min(kMaxPossiblePayloadSize - outPacket_.value.data.size(), size);
   (void)outPacket_.value.data.insert(outPacket_.value.data.cend(), &buffer[0],
@@ -542,6 +847,9 @@ int EthernetUDP::availableForWrite() {
   if (!outPacket_.has_value) {
     return 0;
   }
+  if (outPacket_.value.pbuf != nullptr) {
+    return static_cast<int>(outPacket_.value.pbuf->len - outPbufLen_);
+  }
   if (outPacket_.value.data.size() >= kMaxPossiblePayloadSize) {
     return 0;
   }
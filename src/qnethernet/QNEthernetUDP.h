@@ -13,6 +13,7 @@
 // C++ includes
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 #ifdef ARDUINO_ARCH_STM32
@@ -27,6 +28,7 @@
 #include "qnethernet/compat/c++11_compat.h"
 #include "qnethernet/internal/CircularBuffer.h"
 #include "qnethernet/internal/IPOpts.h"
+#include "qnethernet/internal/PbufPtr.h"
 #include "qnethernet/internal/PrintfChecked.h"
 #include "qnethernet/internal/optional.h"
 
@@ -35,8 +37,51 @@ namespace network {
 
 class EthernetUDP : public UDP,
                     public internal::IPOpts,
-                    public internal::PrintfChecked {
+                    public internal::PrintfChecked<EthernetUDP> {
  public:
+  // Describes one packet received with receiveBatch(). The caller supplies the
+  // buffer and its size and the rest is filled in.
+  struct Message final {
+    uint8_t* buf = nullptr;  // Data buffer; may be NULL to skip the data
+    size_t bufSize = 0;      // Buffer size
+
+    size_t len = 0;   // Number of bytes copied into the buffer
+    size_t size = 0;  // Packet size; larger than len if truncated
+    IPAddress remoteIP;
+    uint16_t remotePort = 0;
+    IPAddress destIP;
+    uint32_t receivedTimestamp = 0;  // Approximate arrival time
+  };
+
+  // Counts returned by receiveBatch().
+  struct BatchInfo final {
+    size_t truncatedCount = 0;  // Packets that didn't fit their buffer
+    uint32_t droppedCount = 0;  // Packets dropped since the last batch
+  };
+
+  // A read-only view of a received packet, passed to the receive callback. It,
+  // and the data it points to, are only valid during the callback.
+  struct PacketView final {
+    const uint8_t* data = nullptr;  // May be NULL if the size is zero
+    size_t size = 0;
+    IPAddress remoteIP;
+    uint16_t remotePort = 0;
+    IPAddress destIP;
+    uint32_t receivedTimestamp = 0;  // Arrival time, measured with sys_now()
+    uint8_t diffServ = 0;
+    uint8_t ttl = 0;
+    bool hasHardwareTimestamp = false;
+    uint64_t hardwareTimestamp = 0;  // See receivedHardwareTimestamp()
+  };
+
+  // Describes one packet to send with sendBatch().
+  struct Datagram final {
+    IPAddress ip;
+    uint16_t port = 0;
+    const void* data = nullptr;  // May be NULL if len is zero
+    size_t len = 0;
+  };
+
   EthernetUDP();
 
   // Creates a new UDP socket with the given receive queue capacity. It will be
@@ -72,6 +117,74 @@ class EthernetUDP : public UDP,
   // then all the oldest packets that don't fit are dropped.
   void setReceiveQueueCapacity(size_t capacity);
 
+  // Returns the total number of data bytes the receive queue may hold, or zero
+  // if there's no byte limit.
+  size_t receiveQueueByteCapacity() const {
+    return inBufByteCapacity_;
+  }
+
+  // Returns the number of data bytes currently in the receive queue.
+  size_t receiveQueueBytes() const {
+    return inBufBytes_;
+  }
+
+  // Sets the total number of data bytes the receive queue may hold, in addition
+  // to the packet count limit. Zero means no byte limit, which is the default.
+  //
+  // When a new packet doesn't fit, the oldest packets are dropped until it
+  // does. A packet larger than the whole byte capacity is dropped. If the new
+  // capacity is smaller than the number of queued bytes then the oldest packets
+  // that don't fit are dropped. All of these are counted as dropped.
+  void setReceiveQueueByteCapacity(size_t capacity);
+
+  // Returns the maximum size of a received packet, or zero if there's
+  // no maximum.
+  size_t maxReceiveSize() const {
+    return maxReceiveSize_;
+  }
+
+  // Sets the maximum size of a received packet. Larger packets are truncated
+  // to this size and counted by truncatedReceiveCount(). Zero means no
+  // maximum, which is the default.
+  void setMaxReceiveSize(size_t size) {
+    maxReceiveSize_ = size;
+  }
+
+  // Sets whether received packets are queued by holding onto the stack's
+  // buffer (pbuf) instead of copying the data. This removes a copy and a heap
+  // allocation per packet. The default is false. This only affects packets
+  // received after the call.
+  //
+  // Each queued packet holds a buffer from the stack's pool (or from the
+  // driver) until the packet following it is parsed or it's dropped from the
+  // queue, so large queues may exhaust the pool. Packets that arrive in more
+  // than one buffer, for example reassembled IP fragments, are still copied.
+  void setZeroCopyReceive(bool flag) {
+    zeroCopyReceive_ = flag;
+  }
+
+  // Returns whether zero-copy receive is enabled.
+  bool isZeroCopyReceive() const {
+    return zeroCopyReceive_;
+  }
+
+  // Sets whether beginPacket() reserves a stack buffer (pbuf) that write()
+  // fills directly, instead of accumulating the data in a vector that
+  // endPacket() then copies. The default is false. This only affects packets
+  // started after the call.
+  //
+  // In this mode, a packet is limited to the largest payload that doesn't need
+  // IP fragmentation, and beginPacket() fails with ENOMEM if the buffer can't
+  // be allocated.
+  void setZeroCopySend(bool flag) {
+    zeroCopySend_ = flag;
+  }
+
+  // Returns whether zero-copy send is enabled.
+  bool isZeroCopySend() const {
+    return zeroCopySend_;
+  }
+
   // Returns the total number of dropped received packets since reception was
   // started. Note that this is the count of dropped packets at the layer above
   // the driver.
@@ -79,6 +192,13 @@ class EthernetUDP : public UDP,
     return droppedReceiveCount_;
   }
 
+  // Returns the total number of received packets that were truncated because
+  // they were larger than the maximum receive size, since reception
+  // was started.
+  uint32_t truncatedReceiveCount() const {
+    return truncatedReceiveCount_;
+  }
+
   // Returns the total number of received packets, including dropped packets,
   // since reception was started. Note that this is the count at the layer above
   // the driver.
@@ -142,8 +262,19 @@ class EthernetUDP : public UDP,
   // If this returns false and there was an error then errno will be set.
   bool send(const char* host, uint16_t port, const void* data, size_t len);
 
+  // Sends up to `count` packets in one call, similar to sendmmsg(). This
+  // returns the number of packets sent, stopping at the first failure. The
+  // packet data isn't copied into an intermediate buffer.
+  //
+  // The route and link-layer address are looked up once for each run of
+  // consecutive packets having the same destination, so grouping packets by
+  // destination is faster.
+  //
+  // If this returns less than `count` then errno will be set.
+  size_t sendBatch(const Datagram* datagrams, size_t count);
+
   // Use the one from here instead of the one from Print
-  using internal::PrintfChecked::printf;
+  using internal::PrintfChecked<EthernetUDP>::printf;
 
   // Bring Print::write functions into scope
   using Print::write;
@@ -173,17 +304,41 @@ class EthernetUDP : public UDP,
   int peek() final;
   void flush() final;
 
+  // Sets a function to call for each received packet, instead of queuing it.
+  // The function is called from within the stack, as soon as the packet
+  // arrives, with a view of the packet's data and metadata; the data isn't
+  // copied unless it arrived in more than one buffer. Set an empty function to
+  // go back to queuing. Received packets still count towards
+  // totalReceiveCount().
+  //
+  // The callback may send packets, but it must not call Ethernet.loop() or
+  // onReceive(), or stop or destroy this socket.
+  void onReceive(const std::function<void(const PacketView& packet)> cb) {
+    receiveCB_ = cb;
+  }
+
+  // Receives up to `count` queued packets in one call, similar to recvmmsg().
+  // This fills in the messages in order of arrival and returns the number
+  // received. Packets larger than their buffer are truncated, and the rest of
+  // the packet is discarded. This doesn't affect the packet from
+  // parsePacket(), if any.
+  //
+  // If `info` is not NULL then it's filled with the number of truncated packets
+  // and the number of packets dropped from the queue since the last call to
+  // this function, or since reception was started.
+  size_t receiveBatch(Message* msgs, size_t count, BatchInfo* info = nullptr);
+
   // Returns the total size of the received packet data. This is only valid if a
   // packet has been received with parsePacket().
   size_t size() const {
-    return packet_.data.size();
+    return packet_.size();
   }
 
   // Returns a pointer to the received packet data. This is only valid if a
   // packet has been received with parsePacket(). This may return NULL if the
   // size is zero.
   const uint8_t* data() const {
-    return packet_.data.data();
+    return packet_.bytes();
   }
 
   IPAddress remoteIP() final;
@@ -205,6 +360,24 @@ class EthernetUDP : public UDP,
     return packet_.receivedTimestamp;
   }
 
+  // Gets the hardware timestamp, in nanoseconds on the driver's clock, of the
+  // frame that carried the received packet. This returns whether there is one;
+  // it won't exist if the driver doesn't support frame timestamps. This is only
+  // valid if a packet has been received with parsePacket().
+  //
+  // See: EthernetClass::driverCapabilities().isFrameTimestampable
+  bool receivedHardwareTimestamp(uint64_t& timestamp) const;
+
+  // Gets the hardware transmit timestamp, in nanoseconds on the driver's clock,
+  // of the last packet sent with endPacket() or send(). This returns whether
+  // the timestamp is available. It won't be available until the frame has left
+  // the hardware, if the packet was queued waiting for address resolution, or
+  // if the driver doesn't support frame timestamps.
+  //
+  // The timestamp is only kept until the driver reuses the transmit descriptor,
+  // so it should be retrieved soon after the send.
+  bool sentHardwareTimestamp(uint64_t& timestamp) const;
+
   // Returns whether the socket is listening.
   explicit operator bool() const {
     return listening_;
@@ -264,22 +437,47 @@ class EthernetUDP : public UDP,
 
  private:
   // Packet holds packet data. destAddr is unused for outgoing packets.
+  //
+  // Received data is either in `data` or, for zero-copy receive, in the
+  // single-segment `pbuf`.
   struct Packet final {
     uint8_t diffServ = 0;
     uint8_t ttl = 0;
     std::vector<uint8_t> data;
+    internal::PbufPtr pbuf;
     ip_addr_t addr = *IP_ANY_TYPE;
     volatile uint16_t port = 0;
     ip_addr_t destAddr = *IP_ANY_TYPE;        // Address the packet was sent to
     volatile uint32_t receivedTimestamp = 0;  // Approximate arrival time
+    bool hasHardwareTimestamp = false;
+    uint64_t hardwareTimestamp = 0;           // Frame timestamp, in ns
 
     // Clears all the data.
     void clear();
+
+    // Copies any zero-copy data into `data` and releases the pbuf.
+    void copyOutPbuf();
+
+    // Returns the data size.
+    size_t size() const {
+      return (pbuf != nullptr) ? pbuf->len : data.size();
+    }
+
+    // Returns a pointer to the data. This may return NULL if the size is zero.
+    const uint8_t* bytes() const {
+      return (pbuf != nullptr) ? static_cast<const uint8_t*>(pbuf->payload)
+                               : data.data();
+    }
   };
 
   static void recvFunc(void* arg, struct udp_pcb* pcb, struct pbuf* p,
                        const ip_addr_t* addr, uint16_t port);
 
+  // Passes a received packet to the receive callback. This doesn't free
+  // the pbuf.
+  void callReceiveCallback(const struct udp_pcb* pcb, const struct pbuf* p,
+                           const ip_addr_t* addr, uint16_t port);
+
   // Attempts to create the internal PCB if it's not already set. If
   // unsuccessful, this calls Ethernet.loop(), sets errno to ENOMEM, and returns
   // false. This returns true if the PCB is set.
@@ -307,6 +505,26 @@ class EthernetUDP : public UDP,
   bool send(const ip_addr_t* ipaddr, uint16_t port,
             const void* data, size_t len);
 
+  // Sends the pbuf and records the frame ID for the transmit timestamp. If
+  // `netif` is not NULL then it's used instead of routing.
+  //
+  // If this returns false and there was an error then errno will be set.
+  ATTRIBUTE_NODISCARD
+  bool sendPbuf(struct pbuf* p, const ip_addr_t* ipaddr, uint16_t port,
+                struct netif* netif = nullptr);
+
+  // Drops the oldest queued packets until a new one of the given size fits
+  // within the byte capacity. This returns false if it can't fit.
+  ATTRIBUTE_NODISCARD
+  bool makeReceiveRoom(size_t size);
+
+  // Recalculates the number of queued bytes.
+  void updateReceiveQueueBytes();
+
+  // Copies the data of any queued packets, and the current packet, that are
+  // held as zero-copy pbufs so that the pbufs can be freed.
+  void releaseReceivedPbufs();
+
   // Checks if there's data still available in the packet.
   ATTRIBUTE_NODISCARD
   bool isAvailable() const;
@@ -318,20 +536,33 @@ class EthernetUDP : public UDP,
   bool listenReuse_        = false;
   bool listeningMulticast_ = false;
   IPAddress multicastIP_;
+  bool zeroCopyReceive_ = false;
+  bool zeroCopySend_    = false;
 
   // Received packets; updated every time one is received
   internal::CircularBuffer<Packet> inBuf_;
+  size_t inBufBytes_        = 0;  // Data bytes in the queue
+  size_t inBufByteCapacity_ = 0;  // Zero for no limit
+  size_t maxReceiveSize_    = 0;  // Zero for no maximum
+
+  // Receive callback, and a buffer for flattening chained packets for it
+  std::function<void(const PacketView& packet)> receiveCB_;
+  std::vector<uint8_t> receiveCBBuf_;
 
   // Packet being processed by the caller
   Packet packet_;       // Holds the packet being read
   int packetPos_ = -1;  // -1 if not currently reading a packet
 
   // Outgoing packets
-  internal::optional<Packet> outPacket_;
+  internal::optional<Packet> outPacket_;  // Uses `pbuf` for zero-copy send
+  size_t outPbufLen_ = 0;                  // Amount written to the pbuf
+  uint32_t txFrame_ = 0;  // Driver frame ID of the last sent packet, or zero
 
   // Stats
-  uint32_t droppedReceiveCount_ = 0;
-  uint32_t totalReceiveCount_   = 0;
+  uint32_t droppedReceiveCount_   = 0;
+  uint32_t totalReceiveCount_     = 0;
+  uint32_t truncatedReceiveCount_ = 0;
+  uint32_t batchDroppedCount_     = 0;  // droppedReceiveCount_ at last batch
 };
 
 }  // namespace network
@@ -1,4 +1,4 @@
-// SPDX-FileCopyrightText: (c) 2024-2025 Shawn Silverman <shawn@pobox.com>
+// SPDX-FileCopyrightText: (c) 2024-2026 Shawn Silverman <shawn@pobox.com>
 // SPDX-License-Identifier: AGPL-3.0-or-later
 
 // driver_select.h chooses a driver header to include.
@@ -35,6 +35,10 @@
 #elif defined(ARDUINO_TEENSY41)
 #include "qnethernet/drivers/driver_teensy41.h"
 #define QNETHERNET_INTERNAL_DRIVER_TEENSY41
+#elif defined(QNETHERNET_DRIVER_HOST) || \
+      (defined(__linux__) && !defined(ARDUINO))
+#include "qnethernet/drivers/driver_host.h"
+#define QNETHERNET_INTERNAL_DRIVER_HOST
 #else
 #include "qnethernet/drivers/driver_unsupported.h"
 #define QNETHERNET_INTERNAL_DRIVER_UNSUPPORTED
@@ -0,0 +1,742 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// driver_host.cpp contains the host-native simulated Ethernet interface
+// implementation. Frames are exchanged with other attached netifs over an
+// in-memory virtual wire. See driver_host_wire.h.
+// This file is part of the QNEthernet library.
+
+#include "qnethernet/lwip_driver.h"
+
+#if defined(QNETHERNET_INTERNAL_DRIVER_HOST)
+
+#include "qnethernet/drivers/driver_host_wire.h"
+
+// C++ includes
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "lwip/err.h"
+#include "lwip/etharp.h"
+#include "lwip/pbuf.h"
+#include "lwip/stats.h"
+#include "qnethernet/platforms/pgmspace.h"
+
+extern "C" {
+uint32_t qnethernet_hal_millis();
+uint32_t qnethernet_hal_micros();
+void qnethernet_hal_get_system_mac_address(uint8_t mac[ETH_HWADDR_LEN]);
+}  // extern "C"
+
+namespace qindesign {
+namespace network {
+
+// --------------------------------------------------------------------------
+//  Types
+// --------------------------------------------------------------------------
+
+namespace {
+
+enum class EnetInitStates {
+  kStart,        // Unknown hardware
+  kInitialized,  // Everything has been initialized
+};
+
+// A frame in flight on the wire.
+struct WireFrame {
+  std::vector<uint8_t> data;
+  uint32_t dueTime;  // When the frame arrives, in microseconds
+};
+
+// One port on the wire.
+struct WirePort {
+  struct netif* netif;  // NULL for the library's own interface
+  std::deque<WireFrame> rxQueue;
+  uint32_t txBusyUntil = 0;  // When the port's transmitter becomes free
+  uint32_t lastTxStart = 0;  // When the port's last frame started transmitting
+};
+
+// A transmitted frame's timestamp.
+struct TxTimestamp {
+  uint32_t frame = 0;  // Frame ID
+  uint32_t start = 0;  // When the frame started transmitting, in microseconds
+};
+
+}  // namespace
+
+// --------------------------------------------------------------------------
+//  Internal Variables
+// --------------------------------------------------------------------------
+
+// Preamble (8) + FCS (4) + inter-frame gap (12)
+static constexpr size_t kFrameOverhead = 8 + 4 + 12;
+
+static constexpr uint32_t kRxRateInterval = 100;  // In milliseconds
+
+#if !QNETHERNET_ENABLE_PROMISCUOUS_MODE
+static constexpr uint8_t kBroadcastMAC[ETH_HWADDR_LEN]{
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+#endif  // !QNETHERNET_ENABLE_PROMISCUOUS_MODE
+
+static host::WireConfig s_wireConfig;
+static host::WireStats s_wireStats;
+static bool s_wireLink = true;
+
+// All the ports. The library's own interface, when initialized, is the port
+// having a NULL netif.
+static std::vector<WirePort> s_ports;
+
+static EnetInitStates s_initState = EnetInitStates::kStart;
+static uint8_t s_mac[ETH_HWADDR_LEN]{0};
+static bool s_hasMAC = false;
+
+#if !QNETHERNET_ENABLE_PROMISCUOUS_MODE
+// Allowed multicast MAC addresses
+static std::vector<std::vector<uint8_t>> s_allowedMACs;
+#endif  // !QNETHERNET_ENABLE_PROMISCUOUS_MODE
+
+static bool s_manualLinkState = false;  // True for sticky
+
+// Receive settings. There's no receive interrupt on the wire, so "polled"
+// only changes which mode is reported; the port is checked on every loop.
+static RxSettings s_rxSettings;
+static bool s_rxPolling        = false;  // Polled instead of interrupt-driven
+static uint32_t s_rxRateStart  = 0;      // Start of the current rate interval
+static uint32_t s_rxRateFrames = 0;      // Frames in the current rate interval
+
+// Timestamps, in microseconds on the wire, extended to 64 bits
+static constexpr size_t kTxTimestampHistory = 16;
+static uint32_t s_lastMicros = 0;
+static uint64_t s_micros64   = 0;
+static bool s_hasRxTimestamp = false;
+static uint32_t s_rxTimestamp = 0;  // Arrival time of the last received frame
+static uint32_t s_txFrameCount = 0;
+static TxTimestamp s_txTimestamps[kTxTimestampHistory];
+
+// --------------------------------------------------------------------------
+//  Internal Functions
+// --------------------------------------------------------------------------
+
+// Returns whether time 'a' is at or after time 'b', accounting for wraparound.
+static inline bool is_at_or_after(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) >= 0;
+}
+
+// Converts a wire time, in microseconds, to a 64-bit timestamp,
+// in nanoseconds. The time must be within about 35 minutes of now.
+static uint64_t to_timestamp(const uint32_t t) {
+  const uint32_t now = qnethernet_hal_micros();
+  s_micros64 += now - s_lastMicros;
+  s_lastMicros = now;
+  const int32_t diff = static_cast<int32_t>(t - now);
+  return (s_micros64 + static_cast<uint64_t>(static_cast<int64_t>(diff))) *
+         1000;
+}
+
+// Records the start time of the library's most recently transmitted frame.
+static void record_tx_timestamp(const WirePort& port) {
+  ++s_txFrameCount;
+  TxTimestamp& ts = s_txTimestamps[s_txFrameCount % kTxTimestampHistory];
+  ts.frame = s_txFrameCount;
+  ts.start = port.lastTxStart;
+}
+
+// Measures the RX frame rate and, if adaptive polling is enabled, switches
+// between polled and interrupt-driven receive.
+static void update_rx_rate() {
+  if (s_rxSettings.pollRate == 0) {
+    return;
+  }
+
+  const uint32_t elapsed = qnethernet_hal_millis() - s_rxRateStart;
+  if (elapsed < kRxRateInterval) {
+    return;
+  }
+
+  const uint64_t rate = (uint64_t{s_rxRateFrames} * 1000) / elapsed;
+  if (!s_rxPolling) {
+    if (rate >= s_rxSettings.pollRate) {
+      s_rxPolling = true;
+    }
+  } else if (rate < s_rxSettings.pollRate / 2) {
+    s_rxPolling = false;
+  }
+
+  s_rxRateStart += elapsed;
+  s_rxRateFrames = 0;
+}
+
+// Finds the port for the given netif. Use NULL for the library's interface.
+// This returns NULL if not found.
+static WirePort* find_port(const struct netif* const netif) {
+  for (WirePort& port : s_ports) {
+    if (port.netif == netif) {
+      return &port;
+    }
+  }
+  return nullptr;
+}
+
+// Puts a frame on the wire from the given port. All other ports receive
+// a copy. The frame is padded to the minimum frame length. This returns whether
+// the port is attached.
+static bool wire_send(const struct netif* const from,
+                      const void* const frame, const size_t len) {
+  WirePort* const src = find_port(from);
+  if (src == nullptr) {
+    return false;
+  }
+
+  const uint32_t now = qnethernet_hal_micros();
+  const size_t frameLen = std::max(len, static_cast<size_t>(MIN_FRAME_LEN));
+
+  // Calculate the arrival time, serializing behind any frame still being
+  // transmitted by this port
+  uint32_t start = now;
+  if (!is_at_or_after(now, src->txBusyUntil)) {
+    start = src->txBusyUntil;
+  }
+  uint32_t txTime = 0;
+  if (s_wireConfig.bitsPerSecond != 0) {
+    txTime = static_cast<uint32_t>(
+        (uint64_t{frameLen + kFrameOverhead} * 8 * 1000000) /
+        s_wireConfig.bitsPerSecond);
+  }
+  src->lastTxStart = start;
+  src->txBusyUntil = start + txTime;
+  const uint32_t dueTime = src->txBusyUntil + s_wireConfig.latencyMicros;
+
+  s_wireStats.framesSent++;
+  s_wireStats.bytesSent += static_cast<uint32_t>(frameLen);
+
+  if (!s_wireLink) {
+    return true;
+  }
+
+  for (WirePort& port : s_ports) {
+    if (&port == src) {
+      continue;
+    }
+    if (port.rxQueue.size() >= s_wireConfig.queueDepth) {
+      s_wireStats.framesDropped++;
+      continue;
+    }
+    port.rxQueue.emplace_back();
+    WireFrame& f = port.rxQueue.back();
+    f.data.resize(frameLen);  // Zero-fills any padding
+    (void)std::memcpy(f.data.data(), frame, len);
+    f.dueTime = dueTime;
+    s_wireStats.maxQueueLen = std::max(s_wireStats.maxQueueLen,
+                                       port.rxQueue.size());
+  }
+
+  return true;
+}
+
+// Puts a pbuf on the wire from the given port. This skips any ETH_PAD_SIZE
+// bytes at the start.
+static err_t wire_send_pbuf(const struct netif* const from,
+                            struct pbuf* const p) {
+  const size_t len = p->tot_len - ETH_PAD_SIZE;
+  if (len > MAX_FRAME_LEN) {
+    LINK_STATS_INC(link.drop);
+    LINK_STATS_INC(link.lenerr);
+    return ERR_BUF;
+  }
+
+  uint8_t buf[MAX_FRAME_LEN];
+  if (pbuf_copy_partial(p, buf, static_cast<u16_t>(len), ETH_PAD_SIZE) !=
+      len) {
+    LINK_STATS_INC(link.drop);
+    LINK_STATS_INC(link.err);
+    return ERR_BUF;
+  }
+  if (!wire_send(from, buf, len)) {
+    return ERR_IF;
+  }
+
+  LINK_STATS_INC(link.xmit);
+
+  return ERR_OK;
+}
+
+// Removes and returns the next frame that has arrived at the given port.
+// This returns false if there is no such frame.
+static bool wire_receive(WirePort& port, WireFrame& frame) {
+  if (port.rxQueue.empty()) {
+    return false;
+  }
+  if (!is_at_or_after(qnethernet_hal_micros(), port.rxQueue.front().dueTime)) {
+    return false;
+  }
+  frame = std::move(port.rxQueue.front());
+  port.rxQueue.pop_front();
+  return true;
+}
+
+// Creates a pbuf from the given frame data, adding ETH_PAD_SIZE bytes to the
+// front. This returns NULL if there's no memory.
+static struct pbuf* make_pbuf(const std::vector<uint8_t>& data) {
+  struct pbuf* const p =
+      pbuf_alloc(PBUF_RAW, static_cast<u16_t>(data.size() + ETH_PAD_SIZE),
+                 PBUF_POOL);
+  if (p == nullptr) {
+    LINK_STATS_INC(link.drop);
+    LINK_STATS_INC(link.memerr);
+    return nullptr;
+  }
+  (void)pbuf_take_at(p, data.data(), static_cast<u16_t>(data.size()),
+                     ETH_PAD_SIZE);
+  LINK_STATS_INC(link.recv);
+  return p;
+}
+
+// Determines whether the library's interface accepts frames sent to the given
+// destination MAC address.
+static bool is_mac_accepted(const uint8_t* const dst) {
+#if QNETHERNET_ENABLE_PROMISCUOUS_MODE
+  (void)dst;
+  return true;
+#else
+  if (std::memcmp(dst, s_mac, ETH_HWADDR_LEN) == 0 ||
+      std::memcmp(dst, kBroadcastMAC, ETH_HWADDR_LEN) == 0) {
+    return true;
+  }
+  for (const auto& mac : s_allowedMACs) {
+    if (std::memcmp(dst, mac.data(), ETH_HWADDR_LEN) == 0) {
+      return true;
+    }
+  }
+  return false;
+#endif  // QNETHERNET_ENABLE_PROMISCUOUS_MODE
+}
+
+// Delivers all arrived frames to the attached external netifs.
+static void deliver_to_netifs() {
+  // Use indices because input may cause ports to be attached or detached
+  for (size_t i = 0; i < s_ports.size(); ++i) {
+    struct netif* const netif = s_ports[i].netif;
+    if (netif == nullptr) {
+      continue;
+    }
+
+    WireFrame frame;
+    while ((i < s_ports.size()) && (s_ports[i].netif == netif) &&
+           wire_receive(s_ports[i], frame)) {
+      if (netif->input == nullptr) {
+        continue;
+      }
+      struct pbuf* const p = make_pbuf(frame.data);
+      if (p == nullptr) {
+        continue;
+      }
+      s_wireStats.framesDelivered++;
+      if (netif->input(p, netif) != ERR_OK) {
+        (void)pbuf_free(p);
+      }
+    }
+  }
+}
+
+// Link output function for externally attached netifs.
+static err_t netif_link_output(struct netif* const netif,
+                               struct pbuf* const p) {
+  if (p == nullptr) {
+    return ERR_ARG;
+  }
+  return wire_send_pbuf(netif, p);
+}
+
+// Brings the given netif's link up or down to match the wire.
+static void check_link_status(struct netif* const netif,
+                              const bool manualSticky) {
+  if (netif_is_link_up(netif) != s_wireLink) {
+    if (s_wireLink) {
+      netif_set_link_up(netif);
+    } else {
+      if (!manualSticky) {
+        netif_set_link_down(netif);
+      }
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+//  Driver Interface
+// --------------------------------------------------------------------------
+
+namespace driver {
+
+FLASHMEM void get_capabilities(DriverCapabilities* const dc) {
+  dc->isMACSettable                = true;
+  dc->isLinkStateDetectable        = true;
+  dc->isLinkSpeedDetectable        = true;
+  dc->isLinkSpeedSettable          = false;
+  dc->isLinkFullDuplexDetectable   = true;
+  dc->isLinkFullDuplexSettable     = false;
+  dc->isAutoNegotiationSettable    = false;
+  dc->isLinkCrossoverDetectable    = false;
+  dc->isAutoNegotiationRestartable = false;
+  dc->isPHYResettable              = false;
+  dc->isFrameTimestampable         = true;
+}
+
+bool is_unknown() {
+  return s_initState == EnetInitStates::kStart;
+}
+
+void get_system_mac(uint8_t mac[ETH_HWADDR_LEN]) {
+  qnethernet_hal_get_system_mac_address(mac);
+}
+
+bool get_mac(uint8_t mac[ETH_HWADDR_LEN]) {
+  if (!s_hasMAC) {
+    get_system_mac(s_mac);
+    s_hasMAC = true;
+  }
+  (void)std::memcpy(mac, s_mac, ETH_HWADDR_LEN);
+  return true;
+}
+
+bool set_mac(const uint8_t mac[ETH_HWADDR_LEN]) {
+  (void)std::memcpy(s_mac, mac, ETH_HWADDR_LEN);
+  s_hasMAC = true;
+  return true;
+}
+
+bool has_hardware() {
+  return true;
+}
+
+void set_chip_select_pin(const int pin) {
+  (void)pin;
+}
+
+bool set_config(const DriverConfig* const config) {
+  return config->isDefault();
+}
+
+size_t get_region_size(const DriverConfig* const config) {
+  (void)config;
+  return 0;
+}
+
+FLASHMEM bool init() {
+  if (s_initState == EnetInitStates::kInitialized) {
+    return true;
+  }
+
+  if (!s_hasMAC) {
+    get_system_mac(s_mac);
+    s_hasMAC = true;
+  }
+
+  s_ports.emplace_back();
+  s_ports.back().netif = nullptr;
+
+  s_rxPolling    = false;
+  s_rxRateStart  = qnethernet_hal_millis();
+  s_rxRateFrames = 0;
+
+  s_initState = EnetInitStates::kInitialized;
+  return true;
+}
+
+FLASHMEM void deinit() {
+  if (s_initState != EnetInitStates::kInitialized) {
+    return;
+  }
+
+  s_ports.erase(std::remove_if(s_ports.begin(), s_ports.end(),
+                               [](const WirePort& port) {
+                                 return port.netif == nullptr;
+                               }),
+                s_ports.end());
+#if !QNETHERNET_ENABLE_PROMISCUOUS_MODE
+  s_allowedMACs.clear();
+#endif  // !QNETHERNET_ENABLE_PROMISCUOUS_MODE
+
+  s_initState = EnetInitStates::kStart;
+}
+
+struct pbuf* proc_input(struct netif* const netif, const int counter) {
+  (void)netif;
+
+  if (s_initState != EnetInitStates::kInitialized) {
+    return nullptr;
+  }
+
+  // Give the other netifs their input once per loop
+  if (counter == 0) {
+    deliver_to_netifs();
+    update_rx_rate();
+  }
+
+  WirePort* const port = find_port(nullptr);
+  if (port == nullptr) {
+    return nullptr;
+  }
+
+  // Don't process more than one queue's worth of frames per loop so that
+  // two chatty interfaces can't starve the rest of the program
+  if (static_cast<size_t>(counter) >= s_wireConfig.queueDepth) {
+    return nullptr;
+  }
+
+  WireFrame frame;
+  while (wire_receive(*port, frame)) {
+    if (!is_mac_accepted(frame.data.data())) {
+      s_wireStats.framesFiltered++;
+      continue;
+    }
+    s_wireStats.framesDelivered++;
+    ++s_rxRateFrames;
+    s_hasRxTimestamp = true;
+    s_rxTimestamp    = frame.dueTime;
+    return make_pbuf(frame.data);
+  }
+  s_hasRxTimestamp = false;
+  return nullptr;
+}
+
+void rx_pending() {
+  // The wire's queue is checked on every call
+}
+
+void poll(struct netif* const netif) {
+  check_link_status(netif, s_manualLinkState);
+  for (const WirePort& port : s_ports) {
+    if (port.netif != nullptr) {
+      check_link_status(port.netif, false);
+    }
+  }
+}
+
+bool set_rx_settings(const RxSettings* const settings) {
+  // Interrupt coalescing isn't supported
+  if ((settings->coalesceFrames != 0) && (settings->coalesceMicros != 0)) {
+    return false;
+  }
+
+  s_rxSettings = *settings;
+  if (s_rxSettings.pollRate == 0) {
+    s_rxPolling = false;
+  }
+  s_rxRateStart  = qnethernet_hal_millis();
+  s_rxRateFrames = 0;
+  return true;
+}
+
+void get_link_info(LinkInfo* const li) {
+  li->speed = (s_wireConfig.bitsPerSecond == 0)
+                  ? 100
+                  : static_cast<int>(s_wireConfig.bitsPerSecond / 1000000);
+  li->fullNotHalfDuplex = true;
+  li->isAutoNegotiation = false;
+  li->isCrossover       = false;
+}
+
+bool set_link(const LinkSettings* const ls) {
+  (void)ls;
+
+  return false;
+}
+
+err_t output(struct pbuf* const p) {
+  if (s_initState != EnetInitStates::kInitialized) {
+    return ERR_IF;
+  }
+  const err_t err = wire_send_pbuf(nullptr, p);
+  if (err == ERR_OK) {
+    record_tx_timestamp(*find_port(nullptr));
+  }
+  return err;
+}
+
+#if QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+bool output_frame(const void* const frame, const size_t len) {
+  if (s_initState != EnetInitStates::kInitialized) {
+    return false;
+  }
+  if (!wire_send(nullptr, frame, len)) {
+    return false;
+  }
+  LINK_STATS_INC(link.xmit);
+  record_tx_timestamp(*find_port(nullptr));
+  return true;
+}
+#endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+
+// --------------------------------------------------------------------------
+//  Timestamps
+// --------------------------------------------------------------------------
+
+// Received frames are timestamped with their arrival time and transmitted
+// frames with the time they started transmitting.
+
+bool get_rx_timestamp(uint64_t* const timestamp) {
+  if (!s_hasRxTimestamp) {
+    return false;
+  }
+  *timestamp = to_timestamp(s_rxTimestamp);
+  return true;
+}
+
+uint32_t get_tx_frame_count() {
+  return s_txFrameCount;
+}
+
+bool get_tx_timestamp(const uint32_t frame, uint64_t* const timestamp) {
+  const TxTimestamp& ts = s_txTimestamps[frame % kTxTimestampHistory];
+  if ((frame == 0) || (ts.frame != frame)) {
+    return false;
+  }
+  if (!is_at_or_after(qnethernet_hal_micros(), ts.start)) {  // Not sent yet
+    return false;
+  }
+  *timestamp = to_timestamp(ts.start);
+  return true;
+}
+
+// --------------------------------------------------------------------------
+//  MAC Address Filtering
+// --------------------------------------------------------------------------
+
+#if !QNETHERNET_ENABLE_PROMISCUOUS_MODE
+
+bool set_incoming_mac_address_allowed(const uint8_t mac[ETH_HWADDR_LEN],
+                                      const bool allow) {
+  if (mac == nullptr) {
+    return false;
+  }
+
+  const auto it = std::find_if(
+      s_allowedMACs.begin(), s_allowedMACs.end(),
+      [mac](const std::vector<uint8_t>& m) {
+        return std::memcmp(m.data(), mac, ETH_HWADDR_LEN) == 0;
+      });
+  if (allow) {
+    if (it == s_allowedMACs.end()) {
+      s_allowedMACs.emplace_back(mac, mac + ETH_HWADDR_LEN);
+    }
+  } else {
+    if (it != s_allowedMACs.end()) {
+      s_allowedMACs.erase(it);
+    }
+  }
+  return true;
+}
+
+#endif  // !QNETHERNET_ENABLE_PROMISCUOUS_MODE
+
+// --------------------------------------------------------------------------
+//  Notifications from Upper Layers
+// --------------------------------------------------------------------------
+
+void notify_manual_link_state(const bool flag) {
+  s_manualLinkState = flag;
+}
+
+// --------------------------------------------------------------------------
+//  Link Functions
+// --------------------------------------------------------------------------
+
+void restart_auto_negotiation() {
+}
+
+void reset_phy() {
+}
+
+}  // namespace driver
+
+// --------------------------------------------------------------------------
+//  Virtual Wire Interface
+// --------------------------------------------------------------------------
+
+namespace host {
+
+void set_wire_config(const WireConfig& config) {
+  s_wireConfig = config;
+}
+
+WireConfig get_wire_config() {
+  return s_wireConfig;
+}
+
+void set_wire_link(const bool flag) {
+  s_wireLink = flag;
+}
+
+bool is_wire_link() {
+  return s_wireLink;
+}
+
+WireStats get_wire_stats() {
+  return s_wireStats;
+}
+
+void reset_wire_stats() {
+  s_wireStats = WireStats{};
+}
+
+bool is_rx_polling() {
+  return s_rxPolling;
+}
+
+void flush_wire() {
+  for (WirePort& port : s_ports) {
+    port.rxQueue.clear();
+  }
+}
+
+bool attach_netif(struct netif* const netif) {
+  if ((netif == nullptr) || (find_port(netif) != nullptr)) {
+    return false;
+  }
+
+  netif->linkoutput = netif_link_output;
+#if LWIP_IPV4
+  netif->output     = etharp_output;
+#endif  // LWIP_IPV4
+  netif->mtu        = MTU;
+  netif->flags = 0
+                 | NETIF_FLAG_BROADCAST
+#if LWIP_IPV4
+                 | NETIF_FLAG_ETHARP
+#endif  // LWIP_IPV4
+                 | NETIF_FLAG_ETHERNET
+#if LWIP_IGMP
+                 | NETIF_FLAG_IGMP
+#endif  // LWIP_IGMP
+                 ;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+
+  s_ports.emplace_back();
+  s_ports.back().netif = netif;
+  return true;
+}
+
+err_t netif_init(struct netif* const netif) {
+  return attach_netif(netif) ? ERR_OK : ERR_IF;
+}
+
+void detach_netif(struct netif* const netif) {
+  if (netif == nullptr) {
+    return;
+  }
+  s_ports.erase(std::remove_if(s_ports.begin(), s_ports.end(),
+                               [netif](const WirePort& port) {
+                                 return port.netif == netif;
+                               }),
+                s_ports.end());
+}
+
+}  // namespace host
+
+}  // namespace network
+}  // namespace qindesign
+
+#endif  // QNETHERNET_INTERNAL_DRIVER_HOST
@@ -0,0 +1,10 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// driver_host.h defines things for the host-native simulated driver.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+#define MTU           1500
+#define MAX_FRAME_LEN 1518  /* Does not include the 4-byte FCS (frame check sequence) */
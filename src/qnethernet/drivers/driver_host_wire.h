@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// driver_host_wire.h defines the interface to the host driver's in-memory
+// virtual wire. This is only available when the host driver is selected.
+//
+// The wire behaves like a full-duplex switch with a configurable per-port
+// bandwidth, one-way latency, and per-port receive queue depth. The library's
+// own interface is attached to the wire when Ethernet is started. Additional
+// netifs can be attached as peers so that a program or test can exchange frames
+// with the library's interface from within the same process. All frames are
+// delivered, via each netif's 'input' function, from inside Ethernet.loop().
+//
+// Peer netifs don't need to be added to lwIP. Since the default configuration
+// uses LWIP_SINGLE_NETIF, a peer will usually just be a struct netif whose
+// 'input' function is set by the program and whose 'linkoutput' function is
+// used to send frames.
+//
+// None of this is thread-safe; it is meant to be used from the same thread
+// that calls Ethernet.loop().
+//
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+#include "qnethernet/lwip_driver.h"
+
+#if defined(QNETHERNET_INTERNAL_DRIVER_HOST)
+
+// C++ includes
+#include <cstddef>
+#include <cstdint>
+
+#include "lwip/err.h"
+#include "lwip/netif.h"
+#include "qnethernet/compat/c++11_compat.h"
+
+namespace qindesign {
+namespace network {
+namespace host {
+
+// Virtual wire configuration. The defaults describe an ideal wire: unlimited
+// bandwidth and zero latency.
+struct WireConfig {
+  // Per-port transmit bandwidth, in bits per second. Zero means unlimited.
+  // Each frame is charged for its length plus 24 bytes of preamble, FCS, and
+  // inter-frame gap.
+  uint32_t bitsPerSecond = 0;
+
+  // One-way propagation latency, in microseconds.
+  uint32_t latencyMicros = 0;
+
+  // Maximum number of frames that can be queued at each receiving port. Frames
+  // that arrive when a queue is full are dropped.
+  size_t queueDepth = 64;
+};
+
+// Wire statistics. All counts are cumulative since the last reset.
+struct WireStats {
+  uint32_t framesSent      = 0;  // Frames put on the wire
+  uint32_t bytesSent       = 0;  // Bytes put on the wire, excluding overhead
+  uint32_t framesDelivered = 0;  // Frames handed to a receiving netif
+  uint32_t framesDropped   = 0;  // Frames dropped because a queue was full
+  uint32_t framesFiltered  = 0;  // Frames rejected by MAC address filtering
+  size_t   maxQueueLen     = 0;  // The largest receive queue length seen
+};
+
+// Sets the wire configuration. This affects frames sent after this call.
+void set_wire_config(const WireConfig& config);
+
+// Returns the current wire configuration.
+ATTRIBUTE_NODISCARD
+WireConfig get_wire_config();
+
+// Sets whether the "cable" is plugged in. All attached interfaces, including
+// the library's own, see a link change on their next poll. This is true
+// by default.
+void set_wire_link(bool flag);
+
+// Returns whether the "cable" is plugged in.
+ATTRIBUTE_NODISCARD
+bool is_wire_link();
+
+// Returns a copy of the wire statistics.
+ATTRIBUTE_NODISCARD
+WireStats get_wire_stats();
+
+// Resets the wire statistics.
+void reset_wire_stats();
+
+// Returns whether the library's interface has switched to polled receive
+// because the receive rate reached the 'pollRate' receive setting.
+ATTRIBUTE_NODISCARD
+bool is_rx_polling();
+
+// Discards all frames queued on the wire, for all ports.
+void flush_wire();
+
+// Attaches a peer netif to the wire. This sets the netif's MTU, flags, and link
+// output function, and sets 'output' to etharp_output if IPv4 is enabled. The
+// hardware address and 'input' function must be set by the caller. If lwIP is
+// configured for more than one netif, this can be called from the init
+// function given to netif_add(), or use netif_init() below.
+//
+// This returns whether the netif was attached. It will return false if the
+// netif is NULL or already attached.
+ATTRIBUTE_NODISCARD
+bool attach_netif(struct netif* netif);
+
+// A netif init function, suitable for netif_add(), that calls attach_netif().
+// The hardware address must be set before calling netif_add().
+err_t netif_init(struct netif* netif);
+
+// Detaches a netif from the wire and discards its queued frames. If the netif
+// was added to lwIP, this must be called before netif_remove().
+void detach_netif(struct netif* netif);
+
+}  // namespace host
+}  // namespace network
+}  // namespace qindesign
+
+#endif  // QNETHERNET_INTERNAL_DRIVER_HOST
@@ -12,6 +12,7 @@
 
 // C++ includes
 #include <atomic>
+#include <cstdlib>
 #include <cstring>
 
 #include <core_pins.h>
@@ -171,9 +172,23 @@ static constexpr uint32_t kRMIIMux = 3;
     // SION:0 MUX_MODE:0011
     // ALT3
 
-// Sizes
-static constexpr size_t kRxSize = 5;
-static constexpr size_t kTxSize = 5;
+// Sizes; the defaults are used with the built-in buffers
+static constexpr size_t kDefaultRxSize = 5;
+static constexpr size_t kDefaultTxSize = 5;
+
+// Maximum ring sizes. The descriptor rings always go into RAM1 because it isn't
+// cached, so they're sized for the maximum. Only the buffers are configurable.
+static constexpr size_t kMaxRxSize = 32;
+static constexpr size_t kMaxTxSize = 32;
+
+#if QNETHERNET_ENABLE_ZERO_COPY_RX
+// Number of spare RX buffers, per RX descriptor, that can be swapped into the
+// ring while received buffers are held by the stack. Having more than the ring
+// size lets a full ring's worth of frames be in use while the ring is refilled.
+static constexpr size_t kRxSparesPerBD = 2;
+#else
+static constexpr size_t kRxSparesPerBD = 0;
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_RX
 
 // Buffer size for transferring to and from the Ethernet MAC. The frame size is
 // either 1518 or 1522, assuming a 1500-byte payload, depending on whether VLAN
@@ -193,15 +208,25 @@ static constexpr size_t kBufSize =
 
 // static constexpr int kIRQPriority = 64
 
+// Interval over which the RX frame rate is measured for adaptive polling
+static constexpr uint32_t kRxRateInterval = 100;  // In milliseconds
+
+// IEEE 1588 timer; it counts nanoseconds and wraps every second
+static constexpr uint32_t kNanosPerSecond = 1'000'000'000;
+static constexpr uint32_t kTimerClockHz   = 25'000'000;  // ts_clk
+
 // Size checks
-static_assert((kRxSize >= 1) && (kRxSize >= 1), "Rx and Tx sizes must be >= 1");
+static_assert((kDefaultRxSize >= 1) && (kDefaultTxSize >= 1),
+              "Rx and Tx sizes must be >= 1");
+static_assert((kDefaultRxSize <= kMaxRxSize) && (kDefaultTxSize <= kMaxTxSize),
+              "Rx and Tx sizes must be <= the maximums");
 
-#if !QNETHERNET_BUFFERS_IN_RAM1
 ATTRIBUTE_NODISCARD ATTRIBUTE_ALWAYS_INLINE
 static inline uint32_t multipleOf32(uint32_t x) {
   return (x + 31u) & ~31u;
 }
 
+#if !QNETHERNET_BUFFERS_IN_RAM1
 #define BUFFER_DMAMEM DMAMEM
 #else
 #define BUFFER_DMAMEM
@@ -278,6 +303,16 @@ constexpr uint16_t kProtocolChecksum = 0x1000;  // Insert protocol specific chec
 constexpr uint16_t kIpHeaderChecksum = 0x0800;  // Insert IP header checksum; all BDs
 }  // namespace tx_bd_extend1
 
+// TX buffer descriptor flags for all frames.
+constexpr uint16_t kTxFlags = tx_bd_extend1::kInterrupt |
+                              tx_bd_extend1::kTimestamp;
+
+// TX buffer descriptor flags for frames from the stack, whose checksums are
+// offloaded to the MAC.
+constexpr uint16_t kTxChecksumFlags = kTxFlags                         |
+                                      tx_bd_extend1::kProtocolChecksum |
+                                      tx_bd_extend1::kIpHeaderChecksum;
+
 }  // namespace
 
 struct ATTRIBUTE_PACKED BufferDescriptor {
@@ -301,6 +336,15 @@ struct ATTRIBUTE_PACKED BufferDescriptor {
   uint16_t unused4;
 };
 
+#if QNETHERNET_ENABLE_ZERO_COPY_RX
+// A custom pbuf that refers directly to an RX buffer. The pbuf_custom must be
+// the first member so that the pbuf pointer can be converted back.
+struct RxPbuf {
+  struct pbuf_custom p;
+  uint8_t* buf;
+};
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_RX
+
 enum class InitStates {
   kStart,           // Unknown hardware
   kNoHardware,      // No PHY
@@ -313,14 +357,73 @@ enum class InitStates {
 //  Internal Variables
 // --------------------------------------------------------------------------
 
-// Ethernet buffers
-alignas(64) static BufferDescriptor s_rxRing[kRxSize];
-alignas(64) static BufferDescriptor s_txRing[kTxSize];
-alignas(64) static uint8_t s_rxBufs[kRxSize * kBufSize] BUFFER_DMAMEM;
-alignas(64) static uint8_t s_txBufs[kTxSize * kBufSize] BUFFER_DMAMEM;
+// Returns the number of RX buffers needed for the given ring size.
+ATTRIBUTE_NODISCARD
+static constexpr size_t rx_buf_count(const size_t rxSize) {
+  return rxSize * (1 + kRxSparesPerBD);
+}
+
+// Returns the size of the memory needed for the buffers and their bookkeeping,
+// for the given ring sizes. The bookkeeping follows the buffers.
+ATTRIBUTE_NODISCARD
+static constexpr size_t buffers_size(const size_t rxSize, const size_t txSize) {
+  return (rx_buf_count(rxSize) + txSize) * kBufSize
+#if QNETHERNET_ENABLE_ZERO_COPY_RX
+         + rx_buf_count(rxSize) * sizeof(RxPbuf)
+         + rxSize * kRxSparesPerBD * sizeof(uint8_t*)
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_RX
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+         + txSize * sizeof(struct pbuf*)
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
+         ;
+}
+
+// Ethernet descriptor rings and built-in buffers
+alignas(64) static BufferDescriptor s_rxRing[kMaxRxSize];
+alignas(64) static BufferDescriptor s_txRing[kMaxTxSize];
+alignas(64) static uint8_t s_builtInBufs[
+    buffers_size(kDefaultRxSize, kDefaultTxSize)] BUFFER_DMAMEM;
 static volatile BufferDescriptor* s_pRxBD = &s_rxRing[0];
 static volatile BufferDescriptor* s_pTxBD = &s_txRing[0];
 
+// Buffer configuration and the buffers in use, assigned by alloc_buffers()
+static DriverConfig s_config;
+static bool s_buffersAllocated = false;
+static bool s_buffersCached = false;  // Whether cache maintenance is needed
+static size_t s_rxSize = kDefaultRxSize;
+static size_t s_txSize = kDefaultTxSize;
+static uint8_t* s_rxBufs = nullptr;
+static uint8_t* s_txBufs = nullptr;
+
+#if QNETHERNET_ENABLE_ZERO_COPY_RX
+// Zero-copy RX buffer bookkeeping, only accessed outside the ISR
+static RxPbuf* s_rxPbufs = nullptr;  // One per buffer, indexed by buffer
+static uint8_t** s_rxSpareBufs = nullptr;  // Stack of free spares
+static size_t s_rxSpareCount = 0;
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_RX
+
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+// Frames held until transmission completes, stored at each frame's last BD
+static struct pbuf** s_txPbufs = nullptr;
+static volatile BufferDescriptor* s_pTxDirtyBD = &s_txRing[0];  // Oldest in-flight
+static size_t s_txInFlight = 0;
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
+
+// Receive processing state
+static RxSettings s_rxSettings;
+static bool s_rxPolling        = false;  // Polled instead of interrupt-driven
+static uint32_t s_rxRateStart  = 0;      // Start of the current rate interval
+static uint32_t s_rxRateFrames = 0;      // Frames in the current rate interval
+
+// Timestamps
+static volatile uint32_t s_timerSeconds = 0;  // Incremented on timer wrap
+static volatile uint32_t s_timerWrapCycles = 0;  // Cycle count at last wrap
+static bool s_hasRxTimestamp = false;
+static uint32_t s_rxTimerValue = 0;  // Last frame from proc_input(), unextended
+static uint32_t s_txFrameCount = 0;
+static uint32_t s_txFrameIds[kMaxTxSize]{0};  // Frame ID, at last BD
+static uint64_t s_txSendTimes[kMaxTxSize]{0};  // Timer estimate when sent
+
 // Misc. internal state
 static std::atomic_flag s_rxNotAvail = ATOMIC_FLAG_INIT;
 static InitStates s_initState = InitStates::kStart;
@@ -663,9 +766,204 @@ FLASHMEM static void init_phy() {
   s_initState = InitStates::kPHYInitialized;
 }
 
+// Copies a received frame into a newly-allocated pbuf. This returns NULL if
+// there was an allocation error.
+ATTRIBUTE_NODISCARD
+static struct pbuf* copy_rx_buf(volatile BufferDescriptor* const pBD) {
+  struct pbuf* const p = pbuf_alloc(PBUF_RAW, pBD->length, PBUF_POOL);
+  if (p != nullptr) {
+    if (s_buffersCached) {
+      arm_dcache_delete(pBD->buffer, multipleOf32(p->tot_len));
+    }
+    const err_t err = pbuf_take(p, pBD->buffer, p->tot_len);
+    if (err != ERR_OK) {
+      LWIP_PLATFORM_ASSERT("Expected space for pbuf fill");
+    }
+  } else {
+    LINK_STATS_INC(link.drop);
+    LINK_STATS_INC(link.memerr);
+  }
+  return p;
+}
+
+#if QNETHERNET_ENABLE_ZERO_COPY_RX
+
+// Returns a zero-copy RX buffer to the spare pool when the stack is done with
+// its pbuf.
+static void rx_pbuf_free(struct pbuf* const p) {
+  const RxPbuf* const rp = reinterpret_cast<const RxPbuf*>(p);
+  s_rxSpareBufs[s_rxSpareCount++] = rp->buf;
+}
+
+// Initializes the zero-copy RX buffers. This is only called once, when the
+// buffers are allocated, because some of them may still be held by the stack
+// when the driver is re-initialized.
+FLASHMEM static void init_rx_pool() {
+  for (size_t i = 0; i < rx_buf_count(s_rxSize); ++i) {
+    s_rxPbufs[i].p.custom_free_function = &rx_pbuf_free;
+    s_rxPbufs[i].buf = &s_rxBufs[i * kBufSize];
+  }
+  s_rxSpareCount = s_rxSize * kRxSparesPerBD;
+  for (size_t i = 0; i < s_rxSpareCount; ++i) {
+    s_rxSpareBufs[i] = &s_rxBufs[(s_rxSize + i) * kBufSize];
+  }
+  for (size_t i = 0; i < s_rxSize; ++i) {
+    s_rxRing[i].buffer = &s_rxBufs[i * kBufSize];
+  }
+}
+
+// Hands a received buffer up the stack as a custom pbuf and swaps a spare
+// buffer into the descriptor. This returns NULL if there are no spare buffers,
+// in which case the caller should copy the data instead.
+ATTRIBUTE_NODISCARD
+static struct pbuf* swap_rx_buf(volatile BufferDescriptor* const pBD) {
+  if (s_rxSpareCount == 0) {
+    return nullptr;
+  }
+
+  uint8_t* const buf = static_cast<uint8_t*>(pBD->buffer);
+  RxPbuf* const rp =
+      &s_rxPbufs[static_cast<size_t>(buf - s_rxBufs) / kBufSize];
+  const uint16_t len = pBD->length;
+
+  if (s_buffersCached) {
+    arm_dcache_delete(buf, multipleOf32(len));
+  }
+  struct pbuf* const p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &rp->p,
+                                             buf, uint16_t{kBufSize});
+  if (p == nullptr) {
+    return nullptr;
+  }
+
+  uint8_t* const spare = s_rxSpareBufs[--s_rxSpareCount];
+  if (s_buffersCached) {
+    // The stack may have modified the spare's contents, so discard any dirty
+    // cache lines before the DMA writes to it
+    arm_dcache_delete(spare, kBufSize);
+  }
+  pBD->buffer = spare;
+
+  return p;
+}
+
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_RX
+
+// Returns whether the given memory is cached. RAM1 (DTCM) isn't cached.
+ATTRIBUTE_NODISCARD
+static bool is_cached(const void* const p) {
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(p);
+  return (addr < 0x20000000u) || (0x20080000u <= addr);
+}
+
+// Returns the ring sizes for the given configuration, substituting defaults
+// for zeros. This returns false if either size is out of range.
+ATTRIBUTE_NODISCARD
+static bool get_ring_sizes(const DriverConfig& config, size_t* const rxSize,
+                           size_t* const txSize) {
+  *rxSize = (config.rxRingSize == 0) ? kDefaultRxSize : config.rxRingSize;
+  *txSize = (config.txRingSize == 0) ? kDefaultTxSize : config.txRingSize;
+  return (*rxSize <= kMaxRxSize) && (*txSize <= kMaxTxSize);
+}
+
+// Allocates the buffers and their bookkeeping according to the configuration.
+// This only does anything the first time it's called, and returns whether
+// the buffers are allocated.
+FLASHMEM static bool alloc_buffers() {
+  if (s_buffersAllocated) {
+    return true;
+  }
+
+  // The configuration has already been validated
+  (void)get_ring_sizes(s_config, &s_rxSize, &s_txSize);
+
+  void* mem;
+  switch (s_config.bufferPlacement) {
+    case DriverBufferPlacement::kHeap:
+      mem = std::malloc(buffers_size(s_rxSize, s_txSize) + 63);
+      if (mem == nullptr) {
+        return false;
+      }
+      break;
+    case DriverBufferPlacement::kRegion:
+      mem = s_config.region;
+      break;
+    default:
+      mem = s_builtInBufs;
+      break;
+  }
+
+  // Align to 64 bytes and carve out the buffers and bookkeeping
+  uint8_t* pMem = reinterpret_cast<uint8_t*>(
+      (reinterpret_cast<uintptr_t>(mem) + 63) & ~uintptr_t{63});
+  s_buffersCached = is_cached(pMem);
+  s_rxBufs = pMem;
+  pMem += rx_buf_count(s_rxSize) * kBufSize;
+  s_txBufs = pMem;
+  pMem += s_txSize * kBufSize;
+#if QNETHERNET_ENABLE_ZERO_COPY_RX
+  s_rxPbufs = reinterpret_cast<RxPbuf*>(pMem);
+  pMem += rx_buf_count(s_rxSize) * sizeof(RxPbuf);
+  s_rxSpareBufs = reinterpret_cast<uint8_t**>(pMem);
+  pMem += s_rxSize * kRxSparesPerBD * sizeof(uint8_t*);
+  init_rx_pool();
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_RX
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+  s_txPbufs = reinterpret_cast<struct pbuf**>(pMem);
+  for (size_t i = 0; i < s_txSize; ++i) {
+    s_txPbufs[i] = nullptr;
+  }
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
+
+  s_buffersAllocated = true;
+  return true;
+}
+
+// Estimates the IEEE 1588 timer, in nanoseconds, for use as a reference by
+// extend_timer_value(). This counts CPU cycles since the last wrap instead of
+// capturing the timer, which would have to busy-wait. The estimate only has to
+// be well within half a second.
+ATTRIBUTE_NODISCARD
+static uint64_t timer_ref() {
+  uint32_t sec;
+  uint32_t cycles;
+  bool wrapPending;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    sec         = s_timerSeconds;
+    cycles      = ARM_DWT_CYCCNT - s_timerWrapCycles;
+    wrapPending = (ENET::EIR::TS_TIMER != 0);
+  }
+
+  // Account for a wrap that hasn't been handled by the ISR yet
+  if (wrapPending) {
+    return uint64_t{sec + 1} * kNanosPerSecond;
+  }
+
+  uint64_t ns = (uint64_t{cycles} * kNanosPerSecond) / F_CPU_ACTUAL;
+  if (ns >= kNanosPerSecond) {
+    ns = kNanosPerSecond - 1;
+  }
+  return uint64_t{sec} * kNanosPerSecond + ns;
+}
+
+// Extends a timer value, from a buffer descriptor, to a full timestamp. The
+// reference time, from timer_ref(), must be within half a second of when the
+// value was captured.
+ATTRIBUTE_NODISCARD
+static uint64_t extend_timer_value(const uint32_t ns, const uint64_t ref) {
+  const uint64_t t = ref - (ref % kNanosPerSecond) + ns;
+  if ((t > ref + kNanosPerSecond/2) && (t >= kNanosPerSecond)) {
+    return t - kNanosPerSecond;
+  }
+  if (t + kNanosPerSecond/2 < ref) {
+    return t + kNanosPerSecond;
+  }
+  return t;
+}
+
 // Low-level input function that transforms a received frame into an lwIP pbuf.
 // This returns a newly-allocated pbuf, or NULL if there was a frame error or
-// allocation error.
+// allocation error. If zero-copy RX is enabled, the descriptor's buffer is
+// handed up the stack when a spare is available, otherwise the data is copied.
 ATTRIBUTE_NODISCARD
 static struct pbuf* low_level_input(volatile BufferDescriptor* const pBD) {
   const uint16_t err_mask = rx_bd_status::kTrunc    |
@@ -701,21 +999,19 @@ static struct pbuf* low_level_input(volatile BufferDescriptor* const pBD) {
 #endif  // LINK_STATS
   } else {
     LINK_STATS_INC(link.recv);
-    p = pbuf_alloc(PBUF_RAW, pBD->length, PBUF_POOL);
-    if (p != nullptr) {
-#if !QNETHERNET_BUFFERS_IN_RAM1
-      arm_dcache_delete(pBD->buffer, multipleOf32(p->tot_len));
-#endif  // !QNETHERNET_BUFFERS_IN_RAM1
-      const err_t err = pbuf_take(p, pBD->buffer, p->tot_len);
-      if (err != ERR_OK) {
-        LWIP_PLATFORM_ASSERT("Expected space for pbuf fill");
-      }
-    } else {
-      LINK_STATS_INC(link.drop);
-      LINK_STATS_INC(link.memerr);
+    s_rxTimerValue = pBD->timestamp;  // Extended only if asked for
+#if QNETHERNET_ENABLE_ZERO_COPY_RX
+    p = swap_rx_buf(pBD);
+    if (p == nullptr) {  // No spares, so fall back to copying
+      p = copy_rx_buf(pBD);
     }
+#else
+    p = copy_rx_buf(pBD);
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_RX
   }
 
+  s_hasRxTimestamp = (p != nullptr);
+
   // Set rx bd empty
   pBD->status = (pBD->status & rx_bd_status::kWrap) | rx_bd_status::kEmpty;
 
@@ -724,24 +1020,77 @@ static struct pbuf* low_level_input(volatile BufferDescriptor* const pBD) {
   return p;
 }
 
+// Assigns the next frame ID to a frame whose last BD is the given one.
+static void record_tx_frame(volatile BufferDescriptor* const pLastBD) {
+  const size_t index = static_cast<size_t>(pLastBD - s_txRing);
+  s_txFrameIds[index]  = ++s_txFrameCount;
+  s_txSendTimes[index] = timer_ref();
+}
+
+// Returns the TX buffer descriptor following the given one.
+ATTRIBUTE_NODISCARD
+static inline volatile BufferDescriptor* txbd_next(
+    volatile BufferDescriptor* const pBD) {
+  if ((pBD->control & tx_bd_control::kWrap) != 0) {
+    return &s_txRing[0];
+  }
+  return pBD + 1;
+}
+
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+// Releases completed TX buffer descriptors and any frames they hold.
+static void reclaim_txbds() {
+  while (s_txInFlight > 0) {
+    volatile BufferDescriptor* const pBD = s_pTxDirtyBD;
+    if ((pBD->control & tx_bd_control::kReady) != 0) {
+      break;
+    }
+
+    struct pbuf** const pp = &s_txPbufs[pBD - s_txRing];
+    if (*pp != nullptr) {
+      (void)pbuf_free(*pp);
+      *pp = nullptr;
+    }
+
+    s_pTxDirtyBD = txbd_next(pBD);
+    --s_txInFlight;
+  }
+}
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
+
 // Acquires a buffer descriptor. Meant to be used with update_bufdesc().
-// This waits until there is a TX buffer available.
+// This waits until there is a TX buffer available. If zero-copy TX is enabled
+// then this instead returns NULL if there isn't one.
 ATTRIBUTE_NODISCARD
 static inline volatile BufferDescriptor* get_bufdesc() {
   volatile BufferDescriptor* const pBD = s_pTxBD;
 
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+  reclaim_txbds();
+  if (s_txInFlight >= s_txSize) {
+    return nullptr;
+  }
+
+  // The buffer may have been pointed at a pbuf segment
+  pBD->buffer = &s_txBufs[static_cast<size_t>(pBD - s_txRing) * kBufSize];
+#else
   while ((pBD->control & tx_bd_control::kReady) != 0) {
     // Wait until a free buffer is available
     // TODO: Limit count?
   }
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
 
   return pBD;
 }
 
-// Updates a buffer descriptor. Meant to be used with get_bufdesc().
+// Updates a buffer descriptor. Meant to be used with get_bufdesc(). If
+// 'insertChecksums' is true then the MAC inserts the IP header and protocol
+// checksums. This should be false for raw frames so that they're sent as-is.
 static inline void update_bufdesc(volatile BufferDescriptor* const pBD,
-                                  const uint16_t len) {
+                                  const uint16_t len,
+                                  const bool insertChecksums) {
   pBD->length  = len;
+  pBD->extend1 = insertChecksums ? kTxChecksumFlags : kTxFlags;
   pBD->control = (pBD->control & tx_bd_control::kWrap) |
                  tx_bd_control::kTxCrc                 |
                  tx_bd_control::kLast                  |
@@ -749,14 +1098,77 @@ static inline void update_bufdesc(volatile BufferDescriptor* const pBD,
 
   ENET::TDAR::TDAR = 1;
 
-  if ((pBD->control & tx_bd_control::kWrap) != 0) {
-    s_pTxBD = &s_txRing[0];
-  } else {
-    ++s_pTxBD;
+  record_tx_frame(pBD);
+  s_pTxBD = txbd_next(pBD);
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+  ++s_txInFlight;
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
+
+  LINK_STATS_INC(link.xmit);
+}
+
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+// Maps each non-empty pbuf segment onto its own TX buffer descriptor and holds
+// a reference to the frame until the MAC is done with it. 'count' is the number
+// of non-empty segments. This returns ERR_WOULDBLOCK if there aren't enough
+// free descriptors.
+ATTRIBUTE_NODISCARD
+static err_t output_segments(struct pbuf* const p, const size_t count) {
+  reclaim_txbds();
+  if (s_txSize - s_txInFlight < count) {
+    LINK_STATS_INC(link.memerr);
+    LINK_STATS_INC(link.drop);
+    return ERR_WOULDBLOCK;
+  }
+
+  volatile BufferDescriptor* const pFirstBD = s_pTxBD;
+  volatile BufferDescriptor* pBD = pFirstBD;
+  volatile BufferDescriptor* pLastBD = pFirstBD;
+  uint16_t firstControl = 0;
+  size_t remaining = count;
+  for (struct pbuf* q = p; q != nullptr; q = q->next) {
+    if (q->len == 0) {
+      continue;
+    }
+
+    // The segment may share cache lines with other data, so only clean
+    arm_dcache_flush(q->payload, q->len);
+
+    uint16_t control = static_cast<uint16_t>(
+        (pBD->control & tx_bd_control::kWrap) | tx_bd_control::kTxCrc);
+    if (--remaining == 0) {
+      control |= tx_bd_control::kLast;
+    }
+    pBD->buffer  = q->payload;
+    pBD->length  = q->len;
+    pBD->extend1 = kTxChecksumFlags;
+    s_txFrameIds[pBD - s_txRing] = 0;  // Only the last BD holds the frame ID
+    if (pBD == pFirstBD) {
+      firstControl = control;
+    } else {
+      pBD->control = control | tx_bd_control::kReady;
+    }
+
+    pLastBD = pBD;
+    pBD = txbd_next(pBD);
   }
 
+  pbuf_ref(p);
+  s_txPbufs[pLastBD - s_txRing] = p;
+  s_txInFlight += count;
+  s_pTxBD = pBD;
+
+  // Make the first descriptor ready last so that the MAC doesn't start on a
+  // partial frame
+  pFirstBD->control = firstControl | tx_bd_control::kReady;
+  ENET::TDAR::TDAR = 1;
+
+  record_tx_frame(pLastBD);
+
   LINK_STATS_INC(link.xmit);
+  return ERR_OK;
 }
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
 
 // Finds the next non-empty BD.
 ATTRIBUTE_NODISCARD
@@ -782,12 +1194,86 @@ static inline volatile BufferDescriptor* rxbd_next() {
   return pBD;
 }
 
+extern "C" {
+extern volatile uint32_t F_BUS_ACTUAL;  // The IPG clock, which clocks the ENET
+}  // extern "C"
+
+// Applies the RX interrupt coalescing settings. Coalescing is first disabled so
+// that any new thresholds take effect.
+static void apply_rx_coalescing() {
+  ENET::group->RXIC[0] = 0;
+  if ((s_rxSettings.coalesceFrames == 0) ||
+      (s_rxSettings.coalesceMicros == 0)) {
+    return;
+  }
+
+  // The timer counts in units of 64 ENET system clock cycles
+  uint64_t ticks = (uint64_t{s_rxSettings.coalesceMicros} * F_BUS_ACTUAL) /
+                   (64u * 1000000u);
+  if (ticks == 0) {
+    ticks = 1;
+  } else if (ticks > UINT16_MAX) {
+    ticks = UINT16_MAX;
+  }
+  ENET::group->RXIC[0] = ENET::RXIC::ICEN(1) |
+                         ENET::RXIC::ICCS(1) |  // ENET system clock
+                         ENET::RXIC::ICFT(s_rxSettings.coalesceFrames) |
+                         ENET::RXIC::ICTT(static_cast<uint32_t>(ticks));
+}
+
+// Switches between polled and interrupt-driven receive. When switching back to
+// interrupts, this forces a ring check in case a frame arrived in between.
+static void set_rx_polling(const bool flag) {
+  s_rxPolling = flag;
+  if (s_initState != InitStates::kInitialized) {
+    return;
+  }
+
+  if (flag) {
+    ENET::EIMR::RXF = 0;
+  } else {
+    ENET::EIR::RXF = 1;
+    ENET::EIMR::RXF = 1;
+    std::atomic_flag_clear(&s_rxNotAvail);
+  }
+}
+
+// Measures the RX frame rate and, if adaptive polling is enabled, switches
+// between polled and interrupt-driven receive.
+static void update_rx_rate() {
+  if (s_rxSettings.pollRate == 0) {
+    return;
+  }
+
+  const uint32_t elapsed = millis() - s_rxRateStart;
+  if (elapsed < kRxRateInterval) {
+    return;
+  }
+
+  const uint64_t rate = (uint64_t{s_rxRateFrames} * 1000) / elapsed;
+  if (!s_rxPolling) {
+    if (rate >= s_rxSettings.pollRate) {
+      set_rx_polling(true);
+    }
+  } else if (rate < s_rxSettings.pollRate / 2) {
+    set_rx_polling(false);
+  }
+
+  s_rxRateStart += elapsed;
+  s_rxRateFrames = 0;
+}
+
 // The Ethernet ISR.
 static void enet_isr() {
   if (ENET::EIR::RXF != 0) {
     ENET::EIR::RXF = 1;
     std::atomic_flag_clear(&s_rxNotAvail);
   }
+  if (ENET::EIR::TS_TIMER != 0) {
+    ENET::EIR::TS_TIMER = 1;
+    s_timerSeconds    = s_timerSeconds + 1;
+    s_timerWrapCycles = ARM_DWT_CYCCNT;
+  }
 }
 
 // Checks the link status and returns zero if complete and a state value if
@@ -865,6 +1351,10 @@ FLASHMEM void get_capabilities(DriverCapabilities* const dc) {
   dc->isLinkCrossoverDetectable    = true;
   dc->isAutoNegotiationRestartable = true;
   dc->isPHYResettable              = true;
+  dc->isRxCoalescingSettable       = true;
+  dc->isTxChecksumOffloadable      = true;
+  dc->isRxChecksumOffloadable      = true;
+  dc->isFrameTimestampable         = true;
 }
 
 bool is_unknown() {
@@ -936,6 +1426,48 @@ void set_chip_select_pin(const int pin) {
   (void)pin;
 }
 
+bool set_config(const DriverConfig* const config) {
+  if (s_buffersAllocated) {
+    return false;
+  }
+
+  size_t rxSize;
+  size_t txSize;
+  if (!get_ring_sizes(*config, &rxSize, &txSize)) {
+    return false;
+  }
+
+  switch (config->bufferPlacement) {
+    case DriverBufferPlacement::kBuiltIn:
+      if ((rxSize > kDefaultRxSize) || (txSize > kDefaultTxSize)) {
+        return false;
+      }
+      break;
+    case DriverBufferPlacement::kHeap:
+      break;
+    case DriverBufferPlacement::kRegion:
+      if ((config->region == nullptr) ||
+          (config->regionSize < get_region_size(config))) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
+
+  s_config = *config;
+  return true;
+}
+
+size_t get_region_size(const DriverConfig* const config) {
+  size_t rxSize;
+  size_t txSize;
+  if (!get_ring_sizes(*config, &rxSize, &txSize)) {
+    return 0;
+  }
+  return buffers_size(rxSize, txSize) + 63;  // Include alignment slack
+}
+
 // Initializes the PHY and Ethernet interface. This sets the init state and
 // returns whether the initialization was successful.
 FLASHMEM bool init() {
@@ -948,36 +1480,50 @@ FLASHMEM bool init() {
     return false;
   }
 
+  if (!alloc_buffers()) {
+    return false;
+  }
+
   // Configure pins
   // TODO: What should these actually be? Why pull-ups? Note that the reference code uses pull-ups.
   // Note: The original code left RXD0, RXEN, and RXER with PULLDOWN
   configure_rmii_pins();
 
+#if QNETHERNET_ENABLE_ZERO_COPY_RX
+  // Preserve the current RX buffer assignments
+  uint8_t* rxBufs[kMaxRxSize];
+  for (size_t i = 0; i < s_rxSize; ++i) {
+    rxBufs[i] = static_cast<uint8_t*>(s_rxRing[i].buffer);
+  }
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_RX
+
   (void)std::memset(s_rxRing, 0, sizeof(s_rxRing));
   (void)std::memset(s_txRing, 0, sizeof(s_txRing));
   s_pRxBD = &s_rxRing[0];
   s_pTxBD = &s_txRing[0];
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+  s_pTxDirtyBD = &s_txRing[0];
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
 
-  for (size_t i = 0; i < kRxSize; ++i) {
+  for (size_t i = 0; i < s_rxSize; ++i) {
+#if QNETHERNET_ENABLE_ZERO_COPY_RX
+    s_rxRing[i].buffer  = rxBufs[i];
+#else
     s_rxRing[i].buffer  = &s_rxBufs[i * kBufSize];
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_RX
     s_rxRing[i].status  = rx_bd_status::kEmpty;
     s_rxRing[i].extend1 = rx_bd_extend1::kInterrupt;
   }
   // The last buffer descriptor should be set with the wrap flag
-  s_rxRing[kRxSize - 1].status |= rx_bd_status::kWrap;
+  s_rxRing[s_rxSize - 1].status |= rx_bd_status::kWrap;
 
-  for (size_t i = 0; i < kTxSize; ++i) {
+  for (size_t i = 0; i < s_txSize; ++i) {
     s_txRing[i].buffer  = &s_txBufs[i * kBufSize];
     s_txRing[i].control = tx_bd_control::kTxCrc;
-    s_txRing[i].extend1 = 0
-                          | tx_bd_extend1::kInterrupt
-#if !QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
-                          | tx_bd_extend1::kProtocolChecksum
-                          | tx_bd_extend1::kIpHeaderChecksum
-#endif  // !QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
-                          ;
+    s_txRing[i].extend1 = kTxFlags;  // See update_bufdesc()
+    s_txFrameIds[i]     = 0;
   }
-  s_txRing[kTxSize - 1].control |= tx_bd_control::kWrap;
+  s_txRing[s_txSize - 1].control |= tx_bd_control::kWrap;
 
   ENET::group->EIMR = 0;  // This also deasserts all interrupts
 
@@ -1004,15 +1550,10 @@ FLASHMEM bool init() {
                      | ENET::TCR::FDEN(1)       // Enable full-duplex
                      ;
 
+  // Checksum insertion is also requested per frame; see update_bufdesc()
   ENET::group->TACC = 0
-#if (CHECKSUM_GEN_UDP == 0) || \
-    (CHECKSUM_GEN_TCP == 0) || \
-    (CHECKSUM_GEN_ICMP == 0)
                       | ENET::TACC::PROCHK(1)  // Insert protocol checksum
-#endif  // not(Generate all checksums)
-#if CHECKSUM_GEN_IP == 0
                       | ENET::TACC::IPCHK(1)   // Insert IP header checksum
-#endif  // CHECKSUM_GEN_IP == 0
 #if ETH_PAD_SIZE == 2
                       | ENET::TACC::SHIFT16(1)
 #endif  // ETH_PAD_SIZE == 2
@@ -1023,27 +1564,32 @@ FLASHMEM bool init() {
                       | ENET::RACC::SHIFT16(1)
 #endif  // ETH_PAD_SIZE == 2
                       | ENET::RACC::LINEDIS(1)  // Discard bad frames
-#if (CHECKSUM_CHECK_UDP == 0) && \
-    (CHECKSUM_CHECK_TCP == 0) && \
-    (CHECKSUM_CHECK_ICMP == 0)
                       | ENET::RACC::PRODIS(1)   // Discard frames with incorrect protocol checksum
                                                 // Requires RSFL == 0
-#endif  // not(Check any checksums)
-#if CHECKSUM_CHECK_IP == 0
                       | ENET::RACC::IPDIS(1)    // Discard frames with incorrect IPv4 header checksum
                                                 // Requires RSFL == 0
-#endif  // CHECKSUM_CHECK_IP == 0
                       | ENET::RACC::PADREM(1)
                       ;
 
   ENET::TFWR::STRFWD = 1;
   ENET::RSFL::RX_SECTION_FULL = 0;
 
+  // IEEE 1588 timer, for frame timestamps; the seconds are counted in the ISR
+  ENET::group->ATCR  = ENET::ATCR::kWOO | ENET::ATCR::RESTART(1);
+  ENET::group->ATINC = ENET::ATINC::INC(kNanosPerSecond / kTimerClockHz);
+  ENET::group->ATPER = kNanosPerSecond;
+  ENET::group->ATCOR = 0;
+  s_timerSeconds    = 0;
+  s_timerWrapCycles = ARM_DWT_CYCCNT;
+  ENET::group->ATCR  = ENET::ATCR::kWOO |
+                       ENET::ATCR::PEREN(1) |  // Interrupt on wrap
+                       ENET::ATCR::EN(1);
+
   ENET::group->RDSR = reinterpret_cast<uint32_t>(s_rxRing);
   ENET::group->TDSR = reinterpret_cast<uint32_t>(s_txRing);
   ENET::group->MRBR = kBufSize;
 
-  ENET::group->RXIC[0] = 0;
+  apply_rx_coalescing();
   ENET::group->TXIC[0] = 0;
   // ENET::PALR::PADDR1 = (uint32_t{mac[0]} << 24) | (uint32_t{mac[1]} << 16) |
   //                      (uint32_t{mac[2]} <<  8) | (uint32_t{mac[3]} <<  0);
@@ -1059,7 +1605,11 @@ FLASHMEM bool init() {
   ENET::GAUR::GADDR1 = 0;
   ENET::GALR::GADDR2 = 0;
 
+  s_rxPolling    = false;
+  s_rxRateStart  = millis();
+  s_rxRateFrames = 0;
   ENET::EIMR::RXF = 1;
+  ENET::EIMR::TS_TIMER = 1;
   s_prevENETVector = SCB::VTOR::getVector(NVIC::IRQ::kENET);
   SCB::VTOR::setVector(NVIC::IRQ::kENET, &enet_isr);
   NVIC::IRQ::enable(NVIC::IRQ::kENET);
@@ -1117,6 +1667,17 @@ FLASHMEM void deinit() {
     //       so nothing will be pending
     ENET::group->ECR = ENET::ECR::kWOO;
 
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+    // Release any frames still held by the TX ring
+    for (size_t i = 0; i < s_txSize; ++i) {
+      if (s_txPbufs[i] != nullptr) {
+        (void)pbuf_free(s_txPbufs[i]);
+        s_txPbufs[i] = nullptr;
+      }
+    }
+    s_txInFlight = 0;
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
+
     s_initState = InitStates::kPHYInitialized;
   }
 
@@ -1137,11 +1698,19 @@ struct pbuf* proc_input(struct netif* const netif, const int counter) {
     s_checkLinkStatusState = check_link_status(netif, s_checkLinkStatusState);
   }
 
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+  if (counter == 0) {
+    reclaim_txbds();
+  }
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
+
   if (counter == 0) {
-    if (std::atomic_flag_test_and_set(&s_rxNotAvail)) {
+    update_rx_rate();
+    if (!s_rxPolling && std::atomic_flag_test_and_set(&s_rxNotAvail)) {
       return nullptr;
     }
-  } else if (counter >= int{kRxSize} * 2) {
+  } else if (counter >= static_cast<int>(s_rxSize) * 2) {
+    rx_pending();
     return nullptr;
   }
 
@@ -1150,11 +1719,36 @@ struct pbuf* proc_input(struct netif* const netif, const int counter) {
   if (pBD == nullptr) {
     return nullptr;
   }
+  ++s_rxRateFrames;
   return low_level_input(pBD);
 }
 
+void rx_pending() {
+  // Make the next proc_input() check the ring without waiting for an interrupt
+  std::atomic_flag_clear(&s_rxNotAvail);
+}
+
 void poll(struct netif* const netif) {
   s_checkLinkStatusState = check_link_status(netif, s_checkLinkStatusState);
+
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+  reclaim_txbds();
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
+}
+
+bool set_rx_settings(const RxSettings* const settings) {
+  s_rxSettings = *settings;
+  if (s_initState != InitStates::kInitialized) {
+    return true;
+  }
+
+  apply_rx_coalescing();
+  if (s_rxPolling && (s_rxSettings.pollRate == 0)) {
+    set_rx_polling(false);
+  }
+  s_rxRateStart  = millis();
+  s_rxRateFrames = 0;
+  return true;
 }
 
 void get_link_info(LinkInfo* const li) {
@@ -1204,25 +1798,45 @@ bool set_link(const LinkSettings* const ls) {
 // Outputs data from the MAC.
 err_t output(struct pbuf* const p) {
   // Note: The pbuf already contains the padding (ETH_PAD_SIZE)
+
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+  // Reference the segments directly unless any of them might change after
+  // returning or there are more of them than descriptors
+  size_t count = 0;
+  bool canRef = true;
+  for (struct pbuf* q = p; q != nullptr; q = q->next) {
+    if (q->len != 0) {
+      ++count;
+      if (PBUF_NEEDS_COPY(q)) {
+        canRef = false;
+      }
+    }
+  }
+  if (canRef && (count != 0) && (count <= s_txSize)) {
+    return output_segments(p, count);
+  }
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
+
   volatile BufferDescriptor* const pBD = get_bufdesc();
 
-  // No need to check for NULL:
-  // if (pBD == nullptr) {
-  //   LINK_STATS_INC(link.memerr);
-  //   LINK_STATS_INC(link.drop);
-  //   return ERR_WOULDBLOCK;  // Could also use ERR_MEM, but this lets things like
-  //                           // UDP senders know to retry
-  // }
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+  if (pBD == nullptr) {
+    LINK_STATS_INC(link.memerr);
+    LINK_STATS_INC(link.drop);
+    return ERR_WOULDBLOCK;  // Could also use ERR_MEM, but this lets things like
+                            // UDP senders know to retry
+  }
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
   const uint16_t copied = pbuf_copy_partial(p, pBD->buffer, p->tot_len, 0);
   if (copied != p->tot_len) {
     LINK_STATS_INC(link.err);
     LINK_STATS_INC(link.drop);
     return ERR_BUF;
   }
-#if !QNETHERNET_BUFFERS_IN_RAM1
-  arm_dcache_flush_delete(pBD->buffer, multipleOf32(copied));
-#endif  // !QNETHERNET_BUFFERS_IN_RAM1
-  update_bufdesc(pBD, copied);
+  if (s_buffersCached) {
+    arm_dcache_flush_delete(pBD->buffer, multipleOf32(copied));
+  }
+  update_bufdesc(pBD, copied, true);
   return ERR_OK;
 }
 
@@ -1237,22 +1851,57 @@ bool output_frame(const void* const frame, const size_t len) {
 
   volatile BufferDescriptor* const pBD = get_bufdesc();
 
-  // No need to check for NULL:
-  // if (pBD == nullptr) {
-  //   return false;
-  // }
+#if QNETHERNET_ENABLE_ZERO_COPY_TX
+  if (pBD == nullptr) {
+    return false;
+  }
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_TX
 
   (void)std::memcpy(static_cast<uint8_t*>(pBD->buffer) + ETH_PAD_SIZE, frame,
                     len);
-#if !QNETHERNET_BUFFERS_IN_RAM1
-  arm_dcache_flush_delete(pBD->buffer, multipleOf32(len + ETH_PAD_SIZE));
-#endif  // !QNETHERNET_BUFFERS_IN_RAM1
-  update_bufdesc(pBD, static_cast<uint16_t>(len + ETH_PAD_SIZE));
+  if (s_buffersCached) {
+    arm_dcache_flush_delete(pBD->buffer, multipleOf32(len + ETH_PAD_SIZE));
+  }
+  update_bufdesc(pBD, static_cast<uint16_t>(len + ETH_PAD_SIZE), false);
 
   return true;
 }
 #endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
 
+// --------------------------------------------------------------------------
+//  Timestamps
+// --------------------------------------------------------------------------
+
+bool get_rx_timestamp(uint64_t* const timestamp) {
+  if (!s_hasRxTimestamp) {
+    return false;
+  }
+  *timestamp = extend_timer_value(s_rxTimerValue, timer_ref());
+  return true;
+}
+
+uint32_t get_tx_frame_count() {
+  return s_txFrameCount;
+}
+
+bool get_tx_timestamp(const uint32_t frame, uint64_t* const timestamp) {
+  if ((frame == 0) || (s_initState != InitStates::kInitialized)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < s_txSize; ++i) {
+    if (s_txFrameIds[i] != frame) {
+      continue;
+    }
+    if ((s_txRing[i].control & tx_bd_control::kReady) != 0) {
+      return false;  // Not sent yet
+    }
+    *timestamp = extend_timer_value(s_txRing[i].timestamp, s_txSendTimes[i]);
+    return true;
+  }
+  return false;
+}
+
 // --------------------------------------------------------------------------
 //  MAC Address Filtering
 // --------------------------------------------------------------------------
@@ -15,16 +15,10 @@
 #define ETH_PAD_SIZE 2  /* 0 */
 
 // Checksum options
-#if !QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
-#define CHECKSUM_GEN_IP      0  /* 1 */
-#define CHECKSUM_GEN_UDP     0  /* 1 */
-#define CHECKSUM_GEN_TCP     0  /* 1 */
-#define CHECKSUM_GEN_ICMP    0  /* 1 */
-// #define CHECKSUM_GEN_ICMP6   1
-#endif  // !QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+// The checksum offloads are controlled per netif at runtime; see the
+// checksum-related driver capabilities
 
-#define CHECKSUM_CHECK_IP    0  /* 1 */
-#define CHECKSUM_CHECK_UDP   0  /* 1 */
-#define CHECKSUM_CHECK_TCP   0  /* 1 */
-#define CHECKSUM_CHECK_ICMP  0  /* 1 */
-// #define CHECKSUM_CHECK_ICMP6 1
+// pbuf options
+#if QNETHERNET_ENABLE_ZERO_COPY_RX
+#define LWIP_SUPPORT_CUSTOM_PBUF 1  /* ((IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF) || (LWIP_IPV6 && LWIP_IPV6_FRAG)) */
+#endif  // QNETHERNET_ENABLE_ZERO_COPY_RX
@@ -755,6 +755,15 @@ FLASHMEM void set_chip_select_pin(const int pin) {
   }
 }
 
+bool set_config(const DriverConfig* const config) {
+  return config->isDefault();
+}
+
+size_t get_region_size(const DriverConfig* const config) {
+  (void)config;
+  return 0;
+}
+
 FLASHMEM bool init() {
   if (s_initState == EnetInitStates::kInitialized) {
     return true;
@@ -937,11 +946,20 @@ struct pbuf* proc_input(struct netif* const netif, const int counter) {
   return p;
 }
 
+void rx_pending() {
+  // The chip's buffer is read on every call
+}
+
 void poll(struct netif* const netif) {
   SPITransaction spiTransaction;
   check_link_status(netif);
 }
 
+bool set_rx_settings(const RxSettings* const settings) {
+  // Interrupt coalescing isn't supported
+  return (settings->coalesceFrames == 0) || (settings->coalesceMicros == 0);
+}
+
 void get_link_info(LinkInfo* const li) {
   *li = s_linkInfo;
 }
@@ -1056,6 +1074,27 @@ bool output_frame(const void* const frame, const size_t len) {
 }
 #endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
 
+// --------------------------------------------------------------------------
+//  Timestamps
+// --------------------------------------------------------------------------
+
+bool get_rx_timestamp(uint64_t* const timestamp) {
+  (void)timestamp;
+
+  return false;
+}
+
+uint32_t get_tx_frame_count() {
+  return 0;
+}
+
+bool get_tx_timestamp(const uint32_t frame, uint64_t* const timestamp) {
+  (void)frame;
+  (void)timestamp;
+
+  return false;
+}
+
 // --------------------------------------------------------------------------
 //  MAC Address Filtering
 // --------------------------------------------------------------------------
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// ChunkPool.cpp implements the receive chunk pool.
+// This file is part of the QNEthernet library.
+
+#include "qnethernet/internal/ChunkPool.h"
+
+#if LWIP_TCP
+
+// C++ includes
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+
+namespace qindesign {
+namespace network {
+namespace internal {
+
+ChunkPool& ChunkPool::instance() {
+  static ChunkPool instance;
+  return instance;
+}
+
+ChunkPool::~ChunkPool() {
+  std::free(mem_);
+}
+
+bool ChunkPool::init(const size_t chunkSize, const size_t chunkCount) {
+  if (stats_.inUse != 0) {
+    errno = EBUSY;
+    return false;
+  }
+  if ((chunkCount != 0) &&
+      ((chunkSize == 0) ||
+       (chunkCount > std::numeric_limits<size_t>::max() /
+                         (sizeof(Chunk) + chunkSize)))) {
+    errno = EINVAL;
+    return false;
+  }
+
+  std::free(mem_);
+  mem_ = nullptr;
+  free_ = nullptr;
+  stats_ = Stats{};
+
+  if (chunkCount == 0) {
+    return true;
+  }
+
+  // The headers go first so that they're aligned
+  mem_ = std::malloc(chunkCount * (sizeof(Chunk) + chunkSize));
+  if (mem_ == nullptr) {
+    errno = ENOMEM;
+    return false;
+  }
+  const auto chunks = static_cast<Chunk*>(mem_);
+  uint8_t* data = reinterpret_cast<uint8_t*>(&chunks[chunkCount]);
+  for (size_t i = 0; i < chunkCount; ++i) {
+    chunks[i].next = free_;
+    chunks[i].data = data;
+    free_ = &chunks[i];
+    data += chunkSize;
+  }
+  stats_.chunkSize = chunkSize;
+  stats_.chunkCount = chunkCount;
+  return true;
+}
+
+ChunkPool::Chunk* ChunkPool::acquire() {
+  Chunk* const c = free_;
+  if (c == nullptr) {
+    return nullptr;
+  }
+  free_ = c->next;
+  c->next = nullptr;
+  c->start = 0;
+  c->end = 0;
+  if (++stats_.inUse > stats_.highWatermark) {
+    stats_.highWatermark = stats_.inUse;
+  }
+  return c;
+}
+
+void ChunkPool::release(Chunk* c) {
+  while (c != nullptr) {
+    Chunk* const next = c->next;
+    c->next = free_;
+    free_ = c;
+    --stats_.inUse;
+    c = next;
+  }
+}
+
+void ChunkPool::resetStats() {
+  stats_.highWatermark = stats_.inUse;
+  stats_.exhausted = 0;
+}
+
+}  // namespace internal
+}  // namespace network
+}  // namespace qindesign
+
+#endif  // LWIP_TCP
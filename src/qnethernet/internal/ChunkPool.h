@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// ChunkPool.h defines a pool of fixed-size buffers that TCP connections borrow
+// for received data.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP
+
+// C++ includes
+#include <cstddef>
+#include <cstdint>
+
+#include "qnethernet/compat/c++11_compat.h"
+
+namespace qindesign {
+namespace network {
+namespace internal {
+
+// ChunkPool is a shared pool of fixed-size chunks. Connections borrow chunks
+// only while they have unread data and return them as the data is read.
+class ChunkPool final {
+ public:
+  // A chunk of data. Unread data is in [start, end).
+  struct Chunk final {
+    Chunk* next;
+    uint8_t* data;
+    size_t start;
+    size_t end;
+  };
+
+  // Pool statistics.
+  struct Stats final {
+    size_t chunkSize     = 0;  // Size of each chunk
+    size_t chunkCount    = 0;  // Total number of chunks
+    size_t inUse         = 0;  // Chunks currently borrowed
+    size_t highWatermark = 0;  // Max. chunks borrowed at once
+    uint32_t exhausted   = 0;  // Times data didn't fit in the free chunks
+  };
+
+  // Accesses the singleton instance.
+  static ChunkPool& instance();
+
+  // Sizes the pool. A count of zero disables it. Any previous memory is freed.
+  //
+  // This returns false and sets errno if any chunks are in use (EBUSY), if
+  // either value is invalid (EINVAL), or if the memory can't be
+  // allocated (ENOMEM).
+  ATTRIBUTE_NODISCARD
+  bool init(size_t chunkSize, size_t chunkCount);
+
+  // Returns whether the pool has any chunks.
+  bool isEnabled() const {
+    return stats_.chunkCount != 0;
+  }
+
+  size_t chunkSize() const {
+    return stats_.chunkSize;
+  }
+
+  // Returns the number of free bytes in the pool.
+  size_t freeBytes() const {
+    return (stats_.chunkCount - stats_.inUse) * stats_.chunkSize;
+  }
+
+  // Borrows a chunk, returning NULL if there are none left.
+  ATTRIBUTE_NODISCARD
+  Chunk* acquire();
+
+  // Returns a chunk, and any chunks linked after it, to the pool.
+  void release(Chunk* c);
+
+  // Counts data that didn't fit in the free chunks.
+  void countExhausted() {
+    ++stats_.exhausted;
+  }
+
+  const Stats& stats() const {
+    return stats_;
+  }
+
+  // Resets the high watermark to the current use and the exhausted count
+  // to zero.
+  void resetStats();
+
+ private:
+  ChunkPool() = default;
+  ~ChunkPool();
+
+  void* mem_   = nullptr;
+  Chunk* free_ = nullptr;
+  Stats stats_;
+};
+
+}  // namespace internal
+}  // namespace network
+}  // namespace qindesign
+
+#endif  // LWIP_TCP
@@ -11,7 +11,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
-#include <utility>
+#include <cstdint>
 #include <vector>
 
 #include "qnethernet/compat/c++11_compat.h"
@@ -83,21 +83,19 @@ class CircularBuffer {
     // buf_.shrink_to_fit();
   }
 
-  // Pops the oldest element. If this is empty then a new T{} is returned. The
-  // caller may want to std::move() the returned element.
+  // Pops the oldest element and returns a reference to it. The element stays
+  // in its slot, so that any storage it owns can be reused by a later put(),
+  // and the reference is only valid until then. The caller may want to swap
+  // the element out. It is expected that this isn't empty, but if it is, this
+  // will assert.
   ATTRIBUTE_NODISCARD
-  T get() {
-    if (empty()) {
-      return T{};
-    }
+  T& get() {
+    assert(!empty());
 
     const size_t oldTail = tail_;
     tail_ = (tail_ + 1) % capacity();
     --size_;
-
-    // We're moving out so probably don't need to clear the old value
-    // It's just left in an unspecified state
-    return std::move(buf_[oldTail]);
+    return buf_[oldTail];
   }
 
   // Stores and returns a reference to a latest element. If the buffer is full
@@ -149,6 +147,17 @@ class CircularBuffer {
   size_t tail_ = 0;
 };
 
+// Prepares a reused queue slot's byte storage for new data of the given size.
+// The slot's existing allocation is kept unless it's more than twice the size
+// needed, in which case it's released first. This keeps one large packet from
+// pinning memory in a slot that's since been used for small ones.
+inline void reserveSlotStorage(std::vector<uint8_t>& v, const size_t size) {
+  if (v.capacity() > 2 * size) {
+    std::vector<uint8_t>{}.swap(v);
+  }
+  v.reserve(size);
+}
+
 }  // namespace internal
 }  // namespace network
 }  // namespace qindesign
@@ -11,11 +11,16 @@
 #if LWIP_TCP
 
 // C++ includes
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <vector>
 
 #include "lwip/err.h"
 #include "qnethernet/internal/ConnectionState.h"
+#include "qnethernet/internal/FixedPool.h"
+#include "qnethernet/internal/IntrusiveList.h"
 
 namespace qindesign {
 namespace network {
@@ -24,7 +29,17 @@ namespace internal {
 // ConnectionHolder is effectively a connection proxy, useful because
 // connections need to be managed by both a server and client. This is the
 // argument passed to the lwIP callbacks.
-struct ConnectionHolder final {
+struct ConnectionHolder final
+    : public std::enable_shared_from_this<ConnectionHolder> {
+  // Asynchronous events, dispatched from Ethernet.loop().
+  enum Events : uint8_t {
+    kAcceptEvent    = 0x01,
+    kConnectedEvent = 0x02,
+    kDataEvent      = 0x04,
+    kWritableEvent  = 0x08,
+    kClosedEvent    = 0x10,
+  };
+
   err_t lastError = ERR_OK;
   /*volatile*/ bool connected = false;
   std::unique_ptr<ConnectionState> state;
@@ -38,8 +53,32 @@ struct ConnectionHolder final {
   /*volatile*/ size_t remainingPos = 0;
   std::vector<uint8_t> remaining;
   // `remainingPos` should never be past the end of `remaining`
+
+  // The listening port, for accepted connections
+  uint16_t listenPort = 0;
+
+  // Events are only queued for callbacks that are set
+  uint8_t events = 0;  // Pending events
+  std::function<void()> onConnected;
+  std::function<void()> onData;
+  std::function<void()> onWritable;
+  std::function<void()> onClosed;
+
+  // ConnectionManager bookkeeping
+  size_t index = 0;  // Position in the list of all connections
+  ListLink<ConnectionHolder> portLink;     // Accepted on the same port
+  ListLink<ConnectionHolder> pendingLink;  // Not yet accepted
+  ListLink<ConnectionHolder> readyLink;    // Might have unread data
 };
 
+// Holders come from this pool, along with their shared_ptr control blocks.
+// A control block made by std::allocate_shared() is the object plus a vtable
+// pointer and two reference counts. PoolAllocator won't compile if a library's
+// blocks are bigger than this.
+using ConnectionHolderPool =
+    FixedPool<sizeof(ConnectionHolder) + sizeof(void*) + 2 * sizeof(long),
+              alignof(ConnectionHolder), MEMP_NUM_TCP_PCB>;
+
 }  // namespace internal
 }  // namespace network
 }  // namespace qindesign
@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <cerrno>
 #include <limits>
+#include <utility>
 
 #include "QNEthernet.h"
 #include "lwip/err.h"
@@ -53,6 +54,27 @@ ConnectionManager& ConnectionManager::instance() {
   return instance;
 }
 
+// Creates a holder, and its control block, from ConnectionHolderPool.
+ATTRIBUTE_NODISCARD
+static std::shared_ptr<ConnectionHolder> makeHolder() {
+  return std::allocate_shared<ConnectionHolder>(
+      PoolAllocator<ConnectionHolder, ConnectionHolderPool>{});
+}
+
+// Gets the local port from the given tcp_pcb.
+ATTRIBUTE_NODISCARD
+static uint16_t getLocalPort(struct altcp_pcb* pcb) {
+#if LWIP_ALTCP
+  return altcp_get_port(pcb, 1);
+#else
+  uint16_t port;
+  const err_t err = altcp_get_tcp_addrinfo(pcb, 1, nullptr, &port);
+  LWIP_ASSERT("Expected valid port", err == ERR_OK);
+  (void)err;
+  return port;
+#endif  // LWIP_ALTCP
+}
+
 // Connection state callback.
 err_t ConnectionManager::connectedFunc(void* const arg,
                                        struct altcp_pcb* const tpcb,
@@ -66,7 +88,17 @@ err_t ConnectionManager::connectedFunc(void* const arg,
   holder->lastError = err;
   holder->connected = (err == ERR_OK);
 
-  if (err != ERR_OK) {
+  if (err == ERR_OK) {
+    if (holder->onConnected != nullptr) {
+      instance().postEvent(holder, ConnectionHolder::kConnectedEvent);
+    }
+  } else {
+    if (holder->onClosed != nullptr) {
+      instance().postEvent(holder, ConnectionHolder::kClosedEvent);
+    }
+    if (holder->state != nullptr) {
+      holder->state->pcbFreed = true;
+    }
     holder->state = nullptr;
 
     if (err != ERR_CLSD) {
@@ -79,28 +111,16 @@ err_t ConnectionManager::connectedFunc(void* const arg,
   return ERR_OK;
 }
 
-// Check if there's data available in the buffer.
-ATTRIBUTE_NODISCARD
-static inline bool isAvailable(const std::unique_ptr<ConnectionState>& state) {
-  return (/*(0 <= state->bufPos) &&*/ (state->bufPos < state->buf.size()));
-}
-
 // Copy any remaining data from the state to the "remaining" buffer. This first
 // clears the 'remaining' buffer.
 //
 // This assumes holder->state != NULL.
 static void maybeCopyRemaining(ConnectionHolder* const holder) {
-  std::vector<uint8_t>& v = holder->remaining;
-  const auto& state = holder->state;
-
   // Reset the 'remaining' buffer
-  v.clear();
+  holder->remaining.clear();
   holder->remainingPos = 0;
 
-  if (isAvailable(state)) {
-    (void)v.insert(v.cend(), state->buf.cbegin() + state->bufPos,
-                   state->buf.cend());
-  }
+  holder->state->moveTo(holder->remaining);
 }
 
 // Error callback.
@@ -118,10 +138,42 @@ void ConnectionManager::errFunc(void* const arg, const err_t err) {
     // Copy any buffered data
     maybeCopyRemaining(holder);
 
+    if (holder->onClosed != nullptr) {
+      instance().postEvent(holder, ConnectionHolder::kClosedEvent);
+    }
+
+    // lwIP has already freed the PCB
+    holder->state->pcbFreed = true;
     holder->state = nullptr;
   }
 }
 
+// Sent data acknowledgement callback.
+err_t ConnectionManager::sentFunc(void* const arg, struct altcp_pcb* const tpcb,
+                                  const u16_t len) {
+  (void)tpcb;
+  (void)len;
+
+  if (arg == nullptr) {
+    return ERR_OK;
+  }
+
+  const auto holder = static_cast<ConnectionHolder*>(arg);
+  if (holder->state != nullptr) {
+    holder->state->ackWrites();
+    if (!holder->state->queuedWrites.empty()) {
+      // Corked data was written before anything was queued
+      if (holder->state->corkBuf.empty() || holder->state->sendCorked(true)) {
+        holder->state->sendQueued();
+      }
+    }
+    if (holder->onWritable != nullptr) {
+      instance().postEvent(holder, ConnectionHolder::kWritableEvent);
+    }
+  }
+  return ERR_OK;
+}
+
 // Data reception callback.
 err_t ConnectionManager::recvFunc(void* const arg, struct altcp_pcb* const tpcb,
                                   struct pbuf* const p, const err_t err) {
@@ -161,6 +213,9 @@ err_t ConnectionManager::recvFunc(void* const arg, struct altcp_pcb* const tpcb,
       (void)pbuf_free(p);
     }
 
+    if (holder->onClosed != nullptr) {
+      instance().postEvent(holder, ConnectionHolder::kClosedEvent);
+    }
     holder->state = nullptr;
 
     if (err != ERR_CLSD) {
@@ -179,37 +234,16 @@ err_t ConnectionManager::recvFunc(void* const arg, struct altcp_pcb* const tpcb,
   holder->connected = true;
 
   if (state != nullptr) {
-    std::vector<uint8_t>& v = state->buf;
-
-    // Check that we can store all the data
-    const size_t rem = v.capacity() - v.size() + state->bufPos;
-    if (rem < p->tot_len) {
-      // Note: Don't need to free the pbuf here because not returning
-      //       ERR_OK or ERR_ABRT
-      // Do not free or acknowledge the pbuf; lwIP retains and retries it.
-      return ERR_MEM;
-    }
-
-    // If there isn't enough space at the end, move all the data in the buffer
-    // to the top
-    if (v.capacity() - v.size() < p->tot_len) {
-      const size_t n = v.size() - state->bufPos;
-      if (n > 0) {
-        // TODO: Use a ring buffer for performance?
-        (void)std::copy_n(v.cbegin() + state->bufPos, n, v.begin());
-        v.resize(n);
-      } else {
-        v.clear();
+    const err_t result = state->receive(p);
+    if (result == ERR_OK) {
+      if (holder->listenPort != 0) {
+        instance().markReady(holder);
+      }
+      if (holder->onData != nullptr) {
+        instance().postEvent(holder, ConnectionHolder::kDataEvent);
       }
-      state->bufPos = 0;
-    }
-
-    // Copy all the data from the pbuf
-    while (pNext != nullptr) {
-      const auto data = static_cast<const uint8_t*>(pNext->payload);
-      (void)v.insert(v.cend(), &data[0], &data[pNext->len]);
-      pNext = pNext->next;
     }
+    return result;
   }
 
   altcp_recved(tpcb, p->tot_len);
@@ -240,32 +274,107 @@ err_t ConnectionManager::acceptFunc(void* const arg,
 
   // Create and add the connection
 
-  auto holder = std::make_shared<ConnectionHolder>();
+  auto holder = makeHolder();
   holder->lastError = err;
   holder->connected = true;
   // The following sets the ConnectionHolder* as the PCB's arg
   holder->state = compat::make_unique<ConnectionState>(newpcb, holder.get());
   holder->accepted = false;
+  holder->listenPort = getLocalPort(newpcb);
   altcp_err(newpcb, &errFunc);
   altcp_recv(newpcb, &recvFunc);
+  altcp_sent(newpcb, &sentFunc);
   m->addConnection(holder);
 
+  const PortConnections* const pc = m->findPort(holder->listenPort);
+  if ((pc != nullptr) && (pc->acceptFunc != nullptr)) {
+    m->postEvent(holder.get(), ConnectionHolder::kAcceptEvent);
+  }
+
   return ERR_OK;
 }
 
 void ConnectionManager::addConnection(
     const std::shared_ptr<ConnectionHolder>& holder) {
+  holder->index = connections_.size();
   connections_.push_back(holder);
-  holder->state->removeFunc = [this, holder](ConnectionState* state) {
+  if (holder->listenPort != 0) {
+    PortConnections& pc = getPort(holder->listenPort);
+    pc.all.pushBack(holder.get());
+    pc.pending.pushBack(holder.get());
+  }
+  holder->state->removeArg = holder.get();
+  holder->state->removeFunc = [](ConnectionState* const state,
+                                 void* const arg) {
     (void)state;
+    instance().removeConnection(static_cast<ConnectionHolder*>(arg));
+  };
+}
 
-    // Remove the connection from the list
-    const auto it =
-        std::find(connections_.cbegin(), connections_.cend(), holder);
-    if (it != connections_.cend()) {
-      (void)connections_.erase(it);
+void ConnectionManager::removeConnection(ConnectionHolder* const holder) {
+  const size_t index = holder->index;
+  if ((index >= connections_.size()) ||
+      (connections_[index].get() != holder)) {
+    return;
+  }
+
+  if (holder->listenPort != 0) {
+    PortConnections* const pc = findPort(holder->listenPort);
+    if (pc != nullptr) {
+      pc->all.remove(holder);
+      pc->pending.remove(holder);
+      pc->ready.remove(holder);
+      maybeRemovePort(holder->listenPort);
     }
-  };
+  }
+
+  // Move the last one into the hole so nothing else shifts
+  if (index != connections_.size() - 1) {
+    connections_[index] = std::move(connections_.back());
+    connections_[index]->index = index;
+  }
+  connections_.pop_back();
+}
+
+ConnectionManager::PortConnections* ConnectionManager::findPort(
+    const uint16_t port) {
+  for (PortConnections& pc : ports_) {
+    if (pc.port == port) {
+      return &pc;
+    }
+  }
+  return nullptr;
+}
+
+ConnectionManager::PortConnections& ConnectionManager::getPort(
+    const uint16_t port) {
+  PortConnections* const pc = findPort(port);
+  if (pc != nullptr) {
+    return *pc;
+  }
+  ports_.emplace_back();
+  ports_.back().port = port;
+  return ports_.back();
+}
+
+void ConnectionManager::maybeRemovePort(const uint16_t port) {
+  const auto it = std::find_if(
+      ports_.begin(), ports_.end(),
+      [port](const PortConnections& elem) { return elem.port == port; });
+  if ((it != ports_.end()) && it->all.empty() &&
+      (it->acceptFunc == nullptr)) {
+    (void)ports_.erase(it);
+  }
+}
+
+void ConnectionManager::markReady(ConnectionHolder* const holder) {
+  if (decltype(PortConnections::ready)::isLinked(holder)) {
+    return;
+  }
+  PortConnections* const pc = findPort(holder->listenPort);
+  if (pc != nullptr) {
+    pc->ready.pushBack(holder);
+  }
 }
 
 ATTRIBUTE_NODISCARD
@@ -315,12 +424,13 @@ std::shared_ptr<ConnectionHolder> ConnectionManager::connect(
   }
 
   // Connect listeners
-  auto holder = std::make_shared<ConnectionHolder>();
+  auto holder = makeHolder();
   // The following sets the ConnectionHolder* as the PCB's arg
   holder->state = compat::make_unique<ConnectionState>(pcb, holder.get());
   holder->accepted = true;
   altcp_err(pcb, &errFunc);
   altcp_recv(pcb, &recvFunc);
+  altcp_sent(pcb, &sentFunc);
 
   // Try to connect
   err = altcp_connect(pcb, ipaddr, port, &connectedFunc);
@@ -392,20 +502,6 @@ optional<uint16_t> ConnectionManager::listen(const uint16_t port,
   return {true, actualPort};
 }
 
-// Gets the local port from the given tcp_pcb.
-ATTRIBUTE_NODISCARD
-static uint16_t getLocalPort(struct altcp_pcb* pcb) {
-#if LWIP_ALTCP
-  return altcp_get_port(pcb, 1);
-#else
-  uint16_t port;
-  const err_t err = altcp_get_tcp_addrinfo(pcb, 1, nullptr, &port);
-  LWIP_ASSERT("Expected valid port", err == ERR_OK);
-  (void)err;
-  return port;
-#endif  // LWIP_ALTCP
-}
-
 bool ConnectionManager::isListening(const uint16_t port) const {
   const auto it =
       std::find_if(listeners_.cbegin(), listeners_.cend(),
@@ -431,55 +527,57 @@ bool ConnectionManager::stopListening(const uint16_t port) {
     altcp_abort(pcb);
     // Note: Don't set errno because we're returning true here
   }
+  setAcceptFunc(port, nullptr);
   return true;
 }
 
 std::shared_ptr<ConnectionHolder> ConnectionManager::findUnacknowledged(
-    const uint16_t port) const {
-  const auto it = std::find_if(
-      connections_.cbegin(), connections_.cend(),
-      // Note: No 'auto' type for parameters in C++11
-      [port](const std::shared_ptr<ConnectionHolder>& elem) {
-        const auto& state = elem->state;
-        return (state != nullptr) && !elem->accepted &&
-               (getLocalPort(state->pcb) == port);
-      });
-  if (it != connections_.cend()) {
-    return *it;
+    const uint16_t port) {
+  PortConnections* const pc = findPort(port);
+  if (pc == nullptr) {
+    return nullptr;
+  }
+  while (!pc->pending.empty()) {
+    ConnectionHolder* const holder = pc->pending.front();
+    if (!holder->accepted && (holder->state != nullptr)) {
+      return holder->shared_from_this();
+    }
+    pc->pending.remove(holder);
   }
   return nullptr;
 }
 
-// TODO: Should we implement some kind of fairness?
 std::shared_ptr<ConnectionHolder> ConnectionManager::findAvailable(
-    const uint16_t port) const {
-  const auto it = std::find_if(
-      connections_.cbegin(), connections_.cend(),
-      // Note: No 'auto' type for parameters in C++11
-      [port](const std::shared_ptr<ConnectionHolder>& elem) {
-        const auto& state = elem->state;
-        return (state != nullptr) &&
-               (getLocalPort(state->pcb) == port) &&
-               isAvailable(state);
-      });
-  if (it != connections_.cend()) {
-    return *it;
+    const uint16_t port) {
+  PortConnections* const pc = findPort(port);
+  if (pc == nullptr) {
+    return nullptr;
+  }
+  while (!pc->ready.empty()) {
+    ConnectionHolder* const holder = pc->ready.front();
+    const auto& state = holder->state;
+    if ((state != nullptr) && state->isAvailable()) {
+      // The next call starts with a different connection
+      pc->ready.moveToBack(holder);
+      return holder->shared_from_this();
+    }
+    pc->ready.remove(holder);
   }
   return nullptr;
 }
 
 bool ConnectionManager::remove(
     const std::shared_ptr<ConnectionHolder>& holder) {
-  const auto it = std::find(connections_.cbegin(), connections_.cend(), holder);
-  if (it != connections_.cend()) {
-    const auto& state = (*it)->state;
-    if (state != nullptr) {
-      state->removeFunc = nullptr;
-    }
-    (void)connections_.erase(it);
-    return true;
+  const size_t index = holder->index;
+  if ((index >= connections_.size()) || (connections_[index] != holder)) {
+    return false;
   }
-  return false;
+  const auto& state = holder->state;
+  if (state != nullptr) {
+    state->removeFunc = nullptr;
+  }
+  removeConnection(holder.get());
+  return true;
 }
 
 size_t ConnectionManager::write(const uint16_t port, const uint8_t b) {
@@ -490,9 +588,13 @@ size_t ConnectionManager::write(const uint16_t port,
                                 const void* const b, const size_t len) {
   const auto size16 = static_cast<uint16_t>(
       std::min(len, size_t{std::numeric_limits<uint16_t>::max()}));
-  iterateConnections([port, b, size16](struct altcp_pcb* pcb) {
-    if (getLocalPort(pcb) != port) {
-      return;
+  iteratePort(port, [b, size16](ConnectionHolder* holder) {
+    struct altcp_pcb* const pcb = holder->state->pcb;
+    if (!holder->state->queuedWrites.empty()) {
+      return;  // Don't jump ahead of queued data
+    }
+    if (!holder->state->corkBuf.empty() && !holder->state->sendCorked(true)) {
+      return;  // Don't jump ahead of corked data
     }
     if (altcp_sndbuf(pcb) < size16) {
       if (altcp_output(pcb) != ERR_OK) {
@@ -513,13 +615,13 @@ size_t ConnectionManager::write(const uint16_t port,
 }
 
 void ConnectionManager::flush(const uint16_t port) {
-  iterateConnections([port](struct altcp_pcb* pcb) {
-    if (getLocalPort(pcb) != port) {
-      return;
+  iteratePort(port, [](ConnectionHolder* holder) {
+    if (!holder->state->corkBuf.empty()) {
+      (void)holder->state->sendCorked(true);
     }
     // TODO: Is ignoring the return the correct thing to do?
     // Note: Writing to a single connection ignores the error
-    (void)altcp_output(pcb);
+    (void)altcp_output(holder->state->pcb);
     // May invalidate connections_ iterators:
     // Ethernet.loop();
   });
@@ -529,11 +631,14 @@ void ConnectionManager::flush(const uint16_t port) {
 int ConnectionManager::availableForWrite(const uint16_t port) {
   uint16_t min = std::numeric_limits<uint16_t>::max();
   bool found = false;
-  iterateConnections([port, &min, &found](struct altcp_pcb* pcb) {
-    if (getLocalPort(pcb) != port) {
-      return;
+  iteratePort(port, [&min, &found](ConnectionHolder* holder) {
+    const size_t corked = holder->state->corkBuf.size();
+    const uint16_t sndBufSize = altcp_sndbuf(holder->state->pcb);
+    if (holder->state->queuedWrites.empty() && (sndBufSize > corked)) {
+      min = std::min(min, static_cast<uint16_t>(sndBufSize - corked));
+    } else {
+      min = 0;
     }
-    min = std::min(min, altcp_sndbuf(pcb));
     found = true;
   });
   if (!found) {
@@ -542,6 +647,36 @@ int ConnectionManager::availableForWrite(const uint16_t port) {
   return min;
 }
 
+std::vector<std::shared_ptr<ConnectionHolder>> ConnectionManager::connections(
+    const uint16_t port) {
+  std::vector<std::shared_ptr<ConnectionHolder>> list;
+  const PortConnections* const pc = findPort(port);
+  if (pc == nullptr) {
+    return list;
+  }
+  list.reserve(pc->all.size());
+  for (ConnectionHolder* holder = pc->all.front(); holder != nullptr;
+       holder = decltype(pc->all)::next(holder)) {
+    list.push_back(holder->shared_from_this());
+  }
+  return list;
+}
+
+void ConnectionManager::iteratePort(
+    const uint16_t port,
+    const std::function<void(ConnectionHolder* holder)>& f) {
+  PortConnections* const pc = findPort(port);
+  if (pc == nullptr) {
+    return;
+  }
+  for (ConnectionHolder* holder = pc->all.front(); holder != nullptr;
+       holder = decltype(pc->all)::next(holder)) {
+    if (holder->state != nullptr) {
+      f(holder);
+    }
+  }
+}
+
 void ConnectionManager::abortAll() {
   iterateConnections([](struct altcp_pcb* pcb) { altcp_abort(pcb); });
 }
@@ -591,6 +726,103 @@ void ConnectionManager::iterateListeners(
                       f);
 }
 
+// --------------------------------------------------------------------------
+//  Asynchronous Events
+// --------------------------------------------------------------------------
+
+void ConnectionManager::setAcceptFunc(
+    const uint16_t port,
+    std::function<void(const std::shared_ptr<ConnectionHolder>& holder)> f) {
+  if (f == nullptr) {
+    PortConnections* const pc = findPort(port);
+    if (pc != nullptr) {
+      pc->acceptFunc = nullptr;
+      maybeRemovePort(port);
+    }
+  } else {
+    getPort(port).acceptFunc = std::move(f);
+  }
+}
+
+void ConnectionManager::postEvent(ConnectionHolder* const holder,
+                                  const uint8_t event) {
+  if (holder->events == 0) {
+    eventQueue_.push_back(holder->shared_from_this());
+  }
+  holder->events |= event;
+}
+
+// Returns whether the connection has any data to read.
+ATTRIBUTE_NODISCARD
+static bool hasData(const ConnectionHolder& holder) {
+  if (holder.state != nullptr) {
+    return holder.state->isAvailable();
+  }
+  return (holder.remainingPos < holder.remaining.size());
+}
+
+void ConnectionManager::dispatchEvents() {
+  if (dispatching_ || eventQueue_.empty()) {
+    return;
+  }
+  dispatching_ = true;
+
+  // Events posted by the callbacks are dispatched next time
+  dispatchQueue_.swap(eventQueue_);
+  for (const auto& holder : dispatchQueue_) {
+    uint8_t events = holder->events;
+    holder->events = 0;
+
+    if ((events & ConnectionHolder::kAcceptEvent) != 0) {
+      const PortConnections* const pc = findPort(holder->listenPort);
+      if ((pc != nullptr) && (pc->acceptFunc != nullptr)) {
+        // Copy the function in case the callback changes it
+        const auto f = pc->acceptFunc;
+        f(holder);
+
+        // Catch up on anything that happened before the callbacks were set
+        if ((holder->onData != nullptr) && hasData(*holder)) {
+          events |= ConnectionHolder::kDataEvent;
+        }
+        if (holder->state == nullptr) {
+          events |= ConnectionHolder::kClosedEvent;
+        }
+      }
+    }
+
+    // Copy each function in case the callback changes it
+    if (((events & ConnectionHolder::kConnectedEvent) != 0) &&
+        (holder->onConnected != nullptr)) {
+      const auto f = holder->onConnected;
+      f();
+    }
+    if (((events & ConnectionHolder::kDataEvent) != 0) &&
+        (holder->onData != nullptr)) {
+      const auto f = holder->onData;
+      f();
+    }
+    if (((events & ConnectionHolder::kWritableEvent) != 0) &&
+        (holder->state != nullptr) && (holder->onWritable != nullptr)) {
+      const auto f = holder->onWritable;
+      f();
+    }
+    if (((events & ConnectionHolder::kClosedEvent) != 0) &&
+        (holder->onClosed != nullptr)) {
+      // This is the last event, so release the callbacks and anything they
+      // might be holding on to
+      const auto f = std::move(holder->onClosed);
+      holder->onClosed = nullptr;
+      holder->onConnected = nullptr;
+      holder->onData = nullptr;
+      holder->onWritable = nullptr;
+      f();
+    }
+  }
+  dispatchQueue_.clear();
+
+  dispatching_ = false;
+}
+
 }  // namespace internal
 }  // namespace network
 }  // namespace qindesign
@@ -21,6 +21,7 @@
 #include "lwip/ip_addr.h"
 #include "qnethernet/compat/c++11_compat.h"
 #include "qnethernet/internal/ConnectionHolder.h"
+#include "qnethernet/internal/IntrusiveList.h"
 #include "qnethernet/internal/optional.h"
 
 namespace qindesign {
@@ -52,14 +53,16 @@ class ConnectionManager final {
   ATTRIBUTE_NODISCARD
   bool stopListening(uint16_t port);
 
-  // Finds a connection whose local port is the specified port, and which has
-  // not yet been acknowledged by accept().
+  // Finds the oldest connection accepted on the specified listening port that
+  // has not yet been acknowledged by accept().
   ATTRIBUTE_NODISCARD
-  std::shared_ptr<ConnectionHolder> findUnacknowledged(uint16_t port) const;
+  std::shared_ptr<ConnectionHolder> findUnacknowledged(uint16_t port);
 
-  // Finds a connection on the given port that has data available.
+  // Finds a connection on the given listening port that has data available.
+  // The connections are served round-robin so that a busy connection can't
+  // starve the others.
   ATTRIBUTE_NODISCARD
-  std::shared_ptr<ConnectionHolder> findAvailable(uint16_t port) const;
+  std::shared_ptr<ConnectionHolder> findAvailable(uint16_t port);
 
   // Removes the given connection and returns whether the connection existed in
   // the list and was removed.
@@ -75,6 +78,12 @@ class ConnectionManager final {
   ATTRIBUTE_NODISCARD
   int availableForWrite(uint16_t port);  // Finds the minimum, or zero for none
 
+  // Returns the connections accepted on the given listening port, oldest first.
+  // The returned list is a copy, so it's safe to close connections while
+  // using it.
+  ATTRIBUTE_NODISCARD
+  std::vector<std::shared_ptr<ConnectionHolder>> connections(uint16_t port);
+
   // Aborts all connections. The motivation is outlined in the "On connections
   // that hang around after cable disconnect" section of the Readme.
   //
@@ -91,6 +100,18 @@ class ConnectionManager final {
   // listen() or stopListening().
   void iterateListeners(const std::function<void(struct altcp_pcb* pcb)>& f);
 
+  // Sets the function that dispatchEvents() calls for each new connection
+  // accepted on the given port. An empty function removes it. The function is
+  // also removed when the port stops listening.
+  void setAcceptFunc(
+      uint16_t port,
+      std::function<void(const std::shared_ptr<ConnectionHolder>& holder)> f);
+
+  // Calls the event callbacks for all connections having pending events. This
+  // is called from Ethernet.loop() and does nothing if it's already running,
+  // for example, if a callback calls Ethernet.loop().
+  void dispatchEvents();
+
  private:
   ConnectionManager() = default;
 
@@ -98,15 +119,64 @@ class ConnectionManager final {
   static void errFunc(void* arg, err_t err);
   static err_t recvFunc(void* arg, struct altcp_pcb* tpcb, struct pbuf* p,
                         err_t err);
+  static err_t sentFunc(void* arg, struct altcp_pcb* tpcb, u16_t len);
   static err_t acceptFunc(void* arg, struct altcp_pcb* newpcb, err_t err);
 
+  // Connections accepted on one listening port. Closed and accepted
+  // connections are removed lazily from the 'pending' and 'ready' lists.
+  struct PortConnections final {
+    uint16_t port = 0;
+    IntrusiveList<ConnectionHolder, &ConnectionHolder::portLink> all;
+    IntrusiveList<ConnectionHolder, &ConnectionHolder::pendingLink> pending;
+    IntrusiveList<ConnectionHolder, &ConnectionHolder::readyLink> ready;
+    std::function<void(const std::shared_ptr<ConnectionHolder>& holder)>
+        acceptFunc;
+  };
+
   // Adds a created connection to the list. It is expected that the object is
   // already set up.
   void addConnection(const std::shared_ptr<ConnectionHolder>& holder);
 
+  // Removes a connection from all the lists.
+  void removeConnection(ConnectionHolder* holder);
+
+  // Finds the connections for a listening port, returning NULL if there's no
+  // entry for the port.
+  ATTRIBUTE_NODISCARD
+  PortConnections* findPort(uint16_t port);
+
+  // Finds the connections for a listening port, adding an entry if needed.
+  ATTRIBUTE_NODISCARD
+  PortConnections& getPort(uint16_t port);
+
+  // Removes the entry for a port if it has no connections and no
+  // accept function.
+  void maybeRemovePort(uint16_t port);
+
+  // Adds an accepted connection to its port's ready list.
+  void markReady(ConnectionHolder* holder);
+
+  // Calls the specified function for each connection accepted on the given
+  // listening port that still has its state. This doesn't take a snapshot, so
+  // the function must not add or remove connections.
+  void iteratePort(uint16_t port,
+                   const std::function<void(ConnectionHolder* holder)>& f);
+
+  // Queues an event for the connection. This keeps the holder alive until the
+  // event is dispatched, so call this before clearing the connection state.
+  void postEvent(ConnectionHolder* holder, uint8_t event);
+
   std::vector<std::shared_ptr<ConnectionHolder>> connections_;
   std::vector<struct altcp_pcb*> listeners_;
 
+  // There are few listening ports, so these are searched linearly
+  std::vector<PortConnections> ports_;
+
+  // Asynchronous events
+  std::vector<std::shared_ptr<ConnectionHolder>> eventQueue_;
+  std::vector<std::shared_ptr<ConnectionHolder>> dispatchQueue_;
+  bool dispatching_ = false;
+
   // Pre-allocate these to avoid std::vector allocations
   // Use 3/2 the max. counts because I still need to prove that the list sizes
   // don't exceed the maximums
@@ -0,0 +1,778 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// ConnectionState.cpp implements the connection's receive buffering.
+// This file is part of the QNEthernet library.
+
+#include "qnethernet/internal/ConnectionState.h"
+
+#if LWIP_TCP
+
+// C++ includes
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#include "lwip/sys.h"
+#include "lwip/tcp.h"
+#if LWIP_ALTCP
+#include "lwip/priv/altcp_priv.h"
+#endif  // LWIP_ALTCP
+#include "qnethernet/lwip_hooks.h"
+#include "qnethernet_opts.h"
+
+namespace qindesign {
+namespace network {
+namespace internal {
+
+// The most data a connection buffers, by copying, before refusing more.
+static constexpr size_t kMaxBuffered = TCP_WND;
+
+// The window every connection starts with.
+static constexpr size_t kInitialWindow =
+    (QNETHERNET_TCP_WND_INITIAL < TCP_WND) ? QNETHERNET_TCP_WND_INITIAL
+                                           : TCP_WND;
+
+// Receive window tuning, shared by all connections
+static size_t windowBudget_ = QNETHERNET_TCP_WND_BUDGET;
+static size_t windowTotal_  = 0;
+static IntrusiveList<ConnectionState, &ConnectionState::windowLink> windows;
+
+// Connections having corked data
+static IntrusiveList<ConnectionState, &ConnectionState::corkLink> corkedList;
+
+// Connections having queued shared data and nothing in flight
+static IntrusiveList<ConnectionState, &ConnectionState::stalledLink>
+    stalledList;
+
+// Returns whether sequence number 'a' is at or after 'b'.
+static inline bool seqGEQ(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) >= 0;
+}
+
+// Removes the acknowledged writes from the front of the list and then calls
+// their callbacks. They're removed first so that the callbacks can make
+// more writes.
+static void ackPendingWrites(
+    std::vector<ConnectionState::PendingWrite>& writes,
+    const uint32_t lastAck) {
+  size_t n = 0;
+  while ((n < writes.size()) && seqGEQ(lastAck, writes[n].endSeq)) {
+    ++n;
+  }
+  if (n == 0) {
+    return;
+  }
+  std::vector<ConnectionState::PendingWrite> done{
+      std::make_move_iterator(writes.begin()),
+      std::make_move_iterator(writes.begin() + n)};
+  (void)writes.erase(writes.begin(), writes.begin() + n);
+  for (const auto& w : done) {
+    if (w.cb != nullptr) {
+      w.cb(true);
+    }
+  }
+}
+
+// Calls all the callbacks with false.
+static void failPendingWrites(
+    std::vector<ConnectionState::PendingWrite>& writes) {
+  std::vector<ConnectionState::PendingWrite> done{std::move(writes)};
+  writes.clear();
+  for (const auto& w : done) {
+    if (w.cb != nullptr) {
+      w.cb(false);
+    }
+  }
+}
+
+#if !LWIP_ALTCP
+// Callbacks for a PCB that outlived its connection state while it still had
+// unacknowledged writes. The arg is the list of writes.
+
+static err_t orphanSentFunc(void* const arg, struct tcp_pcb* const tpcb,
+                            const u16_t len) {
+  (void)len;
+
+  const auto writes =
+      static_cast<std::vector<ConnectionState::PendingWrite>*>(arg);
+  ackPendingWrites(*writes, tpcb->lastack);
+  if (writes->empty()) {
+    tcp_arg(tpcb, nullptr);
+    tcp_sent(tpcb, nullptr);
+    tcp_err(tpcb, nullptr);
+    delete writes;
+  }
+  return ERR_OK;
+}
+
+static void orphanErrFunc(void* const arg, const err_t err) {
+  (void)err;
+
+  const auto writes =
+      static_cast<std::vector<ConnectionState::PendingWrite>*>(arg);
+  failPendingWrites(*writes);
+  delete writes;
+}
+#endif  // !LWIP_ALTCP
+
+ConnectionState::~ConnectionState() noexcept {
+  // Ensure callbacks are no longer called with this as the argument
+  if (!pcbFreed) {
+    altcp_arg(pcb, nullptr);
+  }
+
+  windows.remove(this);
+  windowTotal_ -= rcvWnd;
+  corkedList.remove(this);
+  stalledList.remove(this);
+
+  ChunkPool::instance().release(chunkHead);
+
+  if (!pcbFreed) {
+#if QNETHERNET_ENABLE_TCP_COUNTERS
+    // The PCB may outlive this object
+    tcp_ext_arg_set(tcpPcb(), tcp_counters_id(), nullptr);
+#endif  // QNETHERNET_ENABLE_TCP_COUNTERS
+    releaseWindow();
+    ackWrites();
+  }
+  if (!pendingWrites.empty()) {
+#if !LWIP_ALTCP
+    const enum tcp_state s = pcbFreed ? CLOSED : pcb->state;
+    if ((s == ESTABLISHED) || (s == FIN_WAIT_1) || (s == CLOSE_WAIT) ||
+        (s == CLOSING) || (s == LAST_ACK)) {
+      // The PCB may still be sending the data, so let it finish
+      const auto writes =
+          new std::vector<PendingWrite>{std::move(pendingWrites)};
+      tcp_arg(pcb, writes);
+      tcp_recv(pcb, nullptr);
+      tcp_sent(pcb, &orphanSentFunc);
+      tcp_err(pcb, &orphanErrFunc);
+    } else {
+      failPendingWrites(pendingWrites);
+    }
+#else
+    // Data written through altcp was copied
+    failPendingWrites(pendingWrites);
+#endif  // !LWIP_ALTCP
+  }
+
+  if (removeFunc != nullptr) {
+    removeFunc(this, removeArg);
+  }
+}
+
+void* ConnectionState::operator new(const size_t size) {
+  if (size > ConnectionStatePool::kSize) {
+    return ConnectionStatePool::instance().allocateOverflow(size);
+  }
+  return ConnectionStatePool::instance().allocate();
+}
+
+void ConnectionState::operator delete(void* const p) {
+  // This also frees blocks that came from the heap
+  ConnectionStatePool::instance().deallocate(p);
+}
+
+void ConnectionState::setWindowBudget(const size_t budget) {
+  windowBudget_ = budget;
+}
+
+size_t ConnectionState::windowBudget() {
+  return windowBudget_;
+}
+
+size_t ConnectionState::windowTotal() {
+  return windowTotal_;
+}
+
+void ConnectionState::startWindow() {
+  rcvWnd = kInitialWindow;
+  windowTotal_ += rcvWnd;
+  lastReceive = sys_now();
+  windows.pushBack(this);
+}
+
+void ConnectionState::startCounters() {
+#if QNETHERNET_ENABLE_TCP_COUNTERS
+  tcp_ext_arg_set(tcpPcb(), tcp_counters_id(), &counters);
+#endif  // QNETHERNET_ENABLE_TCP_COUNTERS
+}
+
+// Gives window back to the stack. altcp_recved() takes 16-bit lengths.
+static void giveBack(struct altcp_pcb* const pcb, size_t n) {
+  while (n > 0) {
+    const auto len = static_cast<uint16_t>(
+        std::min(n, size_t{std::numeric_limits<uint16_t>::max()}));
+    altcp_recved(pcb, len);
+    n -= len;
+  }
+}
+
+void ConnectionState::recved(size_t n) {
+  const size_t maxWnd = TCP_WND_MAX(tcpPcb());
+  const size_t target = (maxWnd > rcvWnd) ? maxWnd - rcvWnd : 0;
+  if (withheld < target) {
+    const size_t hold = std::min(n, target - withheld);
+    withheld += hold;
+    n -= hold;
+  }
+  giveBack(pcb, n);
+}
+
+void ConnectionState::releaseWindow() {
+  // Queued pbufs are only acknowledged as they're read
+  if (pbufs != nullptr) {
+    withheld += pbufs->tot_len;
+    pbufs = nullptr;
+  }
+
+  // Data the stack is still holding because it was refused belongs to the
+  // stack, so it's left alone; closing then resets the connection
+
+  giveBack(pcb, withheld);
+  withheld = 0;
+}
+
+bool ConnectionState::closeResets() const {
+  const struct tcp_pcb* const tpcb = tcpPcb();
+  if ((tpcb->state != ESTABLISHED) && (tpcb->state != CLOSE_WAIT)) {
+    return false;
+  }
+  return (tpcb->refused_data != nullptr) ||
+         (tpcb->rcv_wnd != TCP_WND_MAX(tpcb));
+}
+
+void ConnectionState::setWindow(const size_t wnd) {
+  windowTotal_ = windowTotal_ - rcvWnd + wnd;
+  const bool grew = (wnd > rcvWnd);
+  rcvWnd = wnd;
+  roundBytes = 0;
+
+  // A smaller window takes effect as more data is withheld
+  if (grew) {
+    const size_t maxWnd = TCP_WND_MAX(tcpPcb());
+    const size_t target = (maxWnd > rcvWnd) ? maxWnd - rcvWnd : 0;
+    if (withheld > target) {
+      giveBack(pcb, withheld - target);
+      withheld = target;
+    }
+  }
+}
+
+void ConnectionState::shrinkIdle(const ConnectionState* const except) {
+  const uint32_t now = sys_now();
+  for (ConnectionState* s = windows.front(); s != nullptr;
+       s = decltype(windows)::next(s)) {
+    if ((s != except) && (s->rcvWnd > kInitialWindow) &&
+        (now - s->lastReceive >= QNETHERNET_TCP_WND_IDLE_TIMEOUT)) {
+      s->setWindow(kInitialWindow);
+    }
+  }
+}
+
+void ConnectionState::tuneWindow(const size_t n, const size_t unread) {
+  const uint32_t now = sys_now();
+  if (now - lastReceive >= QNETHERNET_TCP_WND_IDLE_TIMEOUT) {
+    // Start over after being idle
+    if (rcvWnd > kInitialWindow) {
+      setWindow(kInitialWindow);
+    }
+    roundBytes = 0;
+  }
+  lastReceive = now;
+
+  roundBytes += n;
+  if (roundBytes < rcvWnd) {
+    return;
+  }
+  roundBytes = 0;
+
+  // Don't grow if the application isn't keeping up, because then the window
+  // isn't what's limiting the transfer
+  if (unread > rcvWnd / 2) {
+    return;
+  }
+
+  const size_t maxWnd = std::min(size_t{TCP_WND_MAX(tcpPcb())}, kMaxBuffered);
+  if (rcvWnd >= maxWnd) {
+    return;
+  }
+  size_t grow = std::min(rcvWnd, maxWnd - rcvWnd);
+  if (windowTotal_ + grow > windowBudget_) {
+    shrinkIdle(this);
+    grow = (windowTotal_ < windowBudget_)
+               ? std::min(grow, windowBudget_ - windowTotal_)
+               : 0;
+  }
+  if (grow > 0) {
+    setWindow(rcvWnd + grow);
+  }
+}
+
+void ConnectionState::maybeReleaseBuf() {
+  if ((bufPos >= buf.size()) && (buf.capacity() != 0)) {
+    std::vector<uint8_t>{}.swap(buf);
+    bufPos = 0;
+  }
+}
+
+void ConnectionState::setZeroCopyReceive(const bool flag) {
+  zeroCopyReceive = flag;
+  if (flag) {
+    maybeReleaseBuf();
+  }
+}
+
+struct tcp_pcb* ConnectionState::tcpPcb() const {
+#if LWIP_ALTCP
+  struct altcp_pcb* innermost = pcb;
+  while (innermost->inner_conn != nullptr) {
+    innermost = innermost->inner_conn;
+  }
+  return static_cast<struct tcp_pcb*>(innermost->state);
+#else
+  return pcb;
+#endif  // LWIP_ALTCP
+}
+
+void ConnectionState::addPendingWrite(std::function<void(bool acked)> cb) {
+  pendingWrites.push_back(PendingWrite{tcpPcb()->snd_lbb, std::move(cb)});
+}
+
+void ConnectionState::ackWrites() {
+  if (!pendingWrites.empty()) {
+    ackPendingWrites(pendingWrites, tcpPcb()->lastack);
+  }
+}
+
+size_t ConnectionState::writeShared(const SharedData& data, size_t pos) {
+  const size_t start = pos;
+  while (pos < data->size()) {
+    // The send buffer size is 16 bits
+    const auto len = static_cast<uint16_t>(
+        std::min(data->size() - pos, size_t{altcp_sndbuf(pcb)}));
+    if (len == 0) {
+      break;
+    }
+#if LWIP_ALTCP
+    // Layered connections may not finish with the data in order, so copy it
+    const uint8_t flags = TCP_WRITE_FLAG_COPY;
+#else
+    const uint8_t flags = 0;
+#endif  // LWIP_ALTCP
+    if (altcp_write(pcb, data->data() + pos, len, flags) != ERR_OK) {
+      break;
+    }
+#if !LWIP_ALTCP
+    // Hold a reference until the stack is done with the data
+    addPendingWrite([data](const bool acked) { (void)acked; });
+#endif  // !LWIP_ALTCP
+    pos += len;
+  }
+  return pos - start;
+}
+
+void ConnectionState::queueShared(const SharedData& data, const size_t pos) {
+  queuedWrites.push_back(QueuedWrite{data, pos});
+  queuedBytes += data->size() - pos;
+  watchQueued();
+}
+
+void ConnectionState::sendQueued() {
+  size_t n = 0;
+  while (n < queuedWrites.size()) {
+    QueuedWrite& q = queuedWrites[n];
+    const size_t written = writeShared(q.data, q.pos);
+    q.pos += written;
+    queuedBytes -= written;
+    if (q.pos < q.data->size()) {
+      break;
+    }
+    ++n;
+  }
+  if (n > 0) {
+    (void)queuedWrites.erase(queuedWrites.begin(), queuedWrites.begin() + n);
+  }
+  watchQueued();
+}
+
+void ConnectionState::watchQueued() {
+  // If the stack refused a write (eg. ERR_MEM) and has nothing unacknowledged,
+  // there won't be a 'sent' callback to send the rest
+  const struct tcp_pcb* const tpcb = tcpPcb();
+  if (!queuedWrites.empty() && (tpcb->snd_lbb == tpcb->lastack)) {
+    if (!decltype(stalledList)::isLinked(this)) {
+      stalledList.pushBack(this);
+    }
+  } else {
+    stalledList.remove(this);
+  }
+}
+
+void ConnectionState::retryQueued() {
+  ConnectionState* s = stalledList.front();
+  while (s != nullptr) {
+    // Sending can remove the connection from the list
+    ConnectionState* const next = decltype(stalledList)::next(s);
+    if (s->corkBuf.empty() || s->sendCorked(true)) {
+      const size_t queued = s->queuedBytes;
+      s->sendQueued();
+      if (s->queuedBytes != queued) {
+        // TODO: Is ignoring the return the correct thing to do?
+        (void)altcp_output(s->pcb);
+      }
+    }
+    s = next;
+  }
+}
+
+void ConnectionState::setCorked(const bool flag) {
+  corked = flag;
+  if (!flag) {
+    (void)sendCorked(true);
+  }
+}
+
+size_t ConnectionState::cork(const uint8_t* buf, size_t size) {
+  size_t total = 0;
+  while (size > 0) {
+    const size_t sndBufSize = altcp_sndbuf(pcb);
+    const size_t room =
+        (sndBufSize > corkBuf.size()) ? sndBufSize - corkBuf.size() : 0;
+    const size_t n = std::min(size, room);
+    if (n == 0) {
+      break;
+    }
+    if (corkBuf.empty()) {
+      corkTime = sys_now();
+      if (!decltype(corkedList)::isLinked(this)) {
+        corkedList.pushBack(this);
+      }
+    }
+    (void)corkBuf.insert(corkBuf.cend(), &buf[0], &buf[n]);
+    buf += n;
+    size -= n;
+    total += n;
+    if (corkBuf.size() >= altcp_mss(pcb)) {
+      (void)sendCorked(false);
+    }
+  }
+  return total;
+}
+
+bool ConnectionState::sendCorked(const bool all) {
+  const size_t mss = std::max(size_t{altcp_mss(pcb)}, size_t{1});
+  size_t pos = 0;
+  while (pos < corkBuf.size()) {
+    size_t n = std::min(corkBuf.size() - pos, size_t{altcp_sndbuf(pcb)});
+    if (!all) {
+      if (n < mss) {
+        break;
+      }
+      n = mss;
+    }
+    n = std::min(n, size_t{std::numeric_limits<uint16_t>::max()});
+    if ((n == 0) ||
+        (altcp_write(pcb, &corkBuf[pos], static_cast<uint16_t>(n),
+                     TCP_WRITE_FLAG_COPY) != ERR_OK)) {
+      break;
+    }
+    pos += n;
+  }
+  if (pos > 0) {
+    (void)corkBuf.erase(corkBuf.cbegin(), corkBuf.cbegin() + pos);
+
+    // Held data shouldn't then also wait for Nagle's algorithm
+    const bool nagle = all && !altcp_nagle_disabled(pcb);
+    if (nagle) {
+      altcp_nagle_disable(pcb);
+    }
+    // TODO: Is ignoring the return the correct thing to do?
+    (void)altcp_output(pcb);
+    if (nagle) {
+      altcp_nagle_enable(pcb);
+    }
+  }
+  if (corkBuf.empty()) {
+    corkedList.remove(this);
+    return true;
+  }
+  return false;
+}
+
+void ConnectionState::pushCorked() {
+  const uint32_t now = sys_now();
+  ConnectionState* s = corkedList.front();
+  while (s != nullptr) {
+    // Sending can remove the connection from the list
+    ConnectionState* const next = decltype(corkedList)::next(s);
+    if (!s->corked || (now - s->corkTime >= s->corkTimeout)) {
+      (void)s->sendCorked(true);
+      s->corkTime = now;  // Wait again if not everything was sent
+    }
+    s = next;
+  }
+}
+
+err_t ConnectionState::queuePbuf(struct pbuf* const p) {
+  if (pbufs == nullptr) {
+    maybeReleaseBuf();
+    pbufs.reset(p);
+  } else {
+    // A pbuf chain's length is limited to 16 bits
+    if (pbufs->tot_len > std::numeric_limits<uint16_t>::max() - p->tot_len) {
+      return ERR_MEM;
+    }
+    pbuf_cat(pbufs.get(), p);
+  }
+  return ERR_OK;
+}
+
+err_t ConnectionState::receive(struct pbuf* const p) {
+  const size_t unread = available();
+  const size_t len = p->tot_len;
+  const err_t err = store(p);
+  if (err == ERR_OK) {
+    tuneWindow(len, unread);
+  }
+  return err;
+}
+
+err_t ConnectionState::store(struct pbuf* const p) {
+  // Zero-copy mode queues the pbuf itself and acknowledges the data as it's
+  // read. Data also goes to the queue if it's not empty, so that it stays
+  // in order after the mode is turned off.
+  if (zeroCopyReceive || (pbufs != nullptr)) {
+    return queuePbuf(p);
+  }
+
+  if (ChunkPool::instance().isEnabled()) {
+    if (!receiveIntoChunks(p)) {
+      // Hold onto the stack's buffer instead of refusing the data, because
+      // lwIP may merge queued segments into more than the pool can ever hold.
+      // The window stays closed by this amount until it's read.
+      return queuePbuf(p);
+    }
+  } else {
+    if (chunkHead != nullptr) {
+      // Chunks are only returned when drained, so this shouldn't happen
+      return ERR_MEM;
+    }
+
+    std::vector<uint8_t>& v = buf;
+
+    // Check that we can store all the data
+    const size_t unread = v.size() - bufPos;
+    if (unread + p->tot_len > kMaxBuffered) {
+      return ERR_MEM;
+    }
+
+    // If there isn't enough space at the end, move all the data in the buffer
+    // to the top
+    if (v.capacity() - v.size() < p->tot_len) {
+      const size_t n = v.size() - bufPos;
+      if (n > 0) {
+        // TODO: Use a ring buffer for performance?
+        (void)std::copy_n(v.cbegin() + bufPos, n, v.begin());
+        v.resize(n);
+      } else {
+        v.clear();
+      }
+      bufPos = 0;
+
+      // The buffer grows with the window
+      if (v.capacity() < n + p->tot_len) {
+        v.reserve(std::min(std::max(n + p->tot_len, rcvWnd), kMaxBuffered));
+      }
+    }
+
+    // Copy all the data from the pbuf
+    const struct pbuf* pNext = p;
+    while (pNext != nullptr) {
+      const auto data = static_cast<const uint8_t*>(pNext->payload);
+      (void)v.insert(v.cend(), &data[0], &data[pNext->len]);
+      pNext = pNext->next;
+    }
+  }
+
+  recved(p->tot_len);
+  (void)pbuf_free(p);
+  return ERR_OK;
+}
+
+bool ConnectionState::receiveIntoChunks(const struct pbuf* const p) {
+  ChunkPool& pool = ChunkPool::instance();
+
+  // Each connection is still limited to a window's worth
+  if (chunkBytes + p->tot_len > kMaxBuffered) {
+    return false;
+  }
+
+  // Check that there are enough chunks
+  const size_t tailRoom =
+      (chunkTail == nullptr) ? 0 : pool.chunkSize() - chunkTail->end;
+  if (tailRoom + pool.freeBytes() < p->tot_len) {
+    pool.countExhausted();
+    return false;
+  }
+
+  const struct pbuf* pNext = p;
+  while (pNext != nullptr) {
+    auto data = static_cast<const uint8_t*>(pNext->payload);
+    size_t len = pNext->len;
+    while (len > 0) {
+      if ((chunkTail == nullptr) || (chunkTail->end >= pool.chunkSize())) {
+        ChunkPool::Chunk* const c = pool.acquire();  // Checked above
+        if (chunkTail == nullptr) {
+          chunkHead = c;
+        } else {
+          chunkTail->next = c;
+        }
+        chunkTail = c;
+      }
+      const size_t n = std::min(len, pool.chunkSize() - chunkTail->end);
+      (void)std::copy_n(data, n, &chunkTail->data[chunkTail->end]);
+      chunkTail->end += n;
+      data += n;
+      len -= n;
+    }
+    pNext = pNext->next;
+  }
+  chunkBytes += p->tot_len;
+
+  return true;
+}
+
+size_t ConnectionState::available() const {
+  size_t n = buf.size() - bufPos + chunkBytes;
+  if (pbufs != nullptr) {
+    n += pbufs->tot_len;
+  }
+  return n;
+}
+
+int ConnectionState::peek() const {
+  if (bufPos < buf.size()) {
+    return buf[bufPos];
+  }
+  if (chunkHead != nullptr) {
+    return chunkHead->data[chunkHead->start];
+  }
+  // Skip any zero-length pbufs, for example, from trimmed segments
+  for (const struct pbuf* p = pbufs.get(); p != nullptr; p = p->next) {
+    if (p->len > 0) {
+      return static_cast<const uint8_t*>(p->payload)[0];
+    }
+  }
+  return -1;
+}
+
+size_t ConnectionState::read(uint8_t* const dest, const size_t size) {
+  size_t actualSize = 0;
+  if (bufPos < buf.size()) {
+    actualSize = std::min(size, buf.size() - bufPos);
+    if (dest != nullptr) {
+      (void)std::copy_n(&buf.data()[bufPos], actualSize, dest);
+    }
+    bufPos += actualSize;
+  }
+  if ((actualSize < size) && (chunkHead != nullptr)) {
+    actualSize += readChunks((dest == nullptr) ? nullptr : &dest[actualSize],
+                             size - actualSize);
+  }
+  if ((actualSize < size) && (pbufs != nullptr)) {
+    actualSize += readPbufs((dest == nullptr) ? nullptr : &dest[actualSize],
+                            size - actualSize);
+  }
+  return actualSize;
+}
+
+size_t ConnectionState::readChunks(uint8_t* const dest, const size_t size) {
+  size_t total = 0;
+  while ((total < size) && (chunkHead != nullptr)) {
+    ChunkPool::Chunk* const c = chunkHead;
+    const size_t n = std::min(size - total, c->end - c->start);
+    if (dest != nullptr) {
+      (void)std::copy_n(&c->data[c->start], n, &dest[total]);
+    }
+    c->start += n;
+    total += n;
+    if (c->start >= c->end) {
+      // Return drained chunks right away
+      chunkHead = c->next;
+      if (chunkHead == nullptr) {
+        chunkTail = nullptr;
+      }
+      c->next = nullptr;
+      ChunkPool::instance().release(c);
+    }
+  }
+  chunkBytes -= total;
+  return total;
+}
+
+void ConnectionState::dropEmptyPbufs() {
+  while ((pbufs != nullptr) && (pbufs->len == 0)) {
+    struct pbuf* const p = pbufs.release();
+    pbufs.reset(p->next);
+    p->next = nullptr;
+    (void)pbuf_free(p);
+  }
+}
+
+size_t ConnectionState::readPbufs(uint8_t* const dest, const size_t size) {
+  size_t total = 0;
+  dropEmptyPbufs();
+  while ((total < size) && (pbufs != nullptr)) {
+    const struct pbuf* const p = pbufs.get();
+    const auto n =
+        static_cast<uint16_t>(std::min(size - total, size_t{p->len}));
+    if (dest != nullptr) {
+      (void)std::copy_n(static_cast<const uint8_t*>(p->payload), n,
+                        &dest[total]);
+    }
+    total += n;
+    pbufs.reset(pbuf_free_header(pbufs.release(), n));
+    dropEmptyPbufs();
+  }
+  if (total > 0) {
+    recved(total);
+  }
+  return total;
+}
+
+void ConnectionState::moveTo(std::vector<uint8_t>& v) {
+  if (bufPos < buf.size()) {
+    (void)v.insert(v.cend(), buf.cbegin() + bufPos, buf.cend());
+  }
+  bufPos = buf.size();
+
+  for (const ChunkPool::Chunk* c = chunkHead; c != nullptr; c = c->next) {
+    (void)v.insert(v.cend(), &c->data[c->start], &c->data[c->end]);
+  }
+  ChunkPool::instance().release(chunkHead);
+  chunkHead = nullptr;
+  chunkTail = nullptr;
+  chunkBytes = 0;
+
+  const struct pbuf* pNext = pbufs.get();
+  while (pNext != nullptr) {
+    const auto data = static_cast<const uint8_t*>(pNext->payload);
+    (void)v.insert(v.cend(), &data[0], &data[pNext->len]);
+    pNext = pNext->next;
+  }
+  if (pbufs != nullptr) {
+    // The data was never acknowledged; releaseWindow() gives it back
+    withheld += pbufs->tot_len;
+    pbufs = nullptr;
+  }
+}
+
+}  // namespace internal
+}  // namespace network
+}  // namespace qindesign
+
+#endif  // LWIP_TCP
@@ -11,40 +11,64 @@
 #if LWIP_TCP
 
 // C++ includes
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <vector>
 
 #include "lwip/altcp.h"
+#include "lwip/err.h"
+#include "qnethernet/compat/c++11_compat.h"
+#include "qnethernet/internal/ChunkPool.h"
+#include "qnethernet/internal/FixedPool.h"
+#include "qnethernet/internal/IntrusiveList.h"
+#include "qnethernet/internal/PbufPtr.h"
+#include "qnethernet/internal/TcpCounters.h"
+#include "qnethernet_opts.h"
 
 namespace qindesign {
 namespace network {
 namespace internal {
 
 // ConnectionState holds all the state needed for a connection.
+//
+// Received data is kept in up to three places, read in this order: the copy
+// buffer, chunks borrowed from the shared ChunkPool, and queued pbufs. New data
+// is only ever added to the last non-empty place or to a later one, so that
+// the order is preserved when the modes change.
+//
+// Each connection's receive window is tuned separately. It starts small and
+// doubles each time the remote side fills it while the application keeps up,
+// as long as the total of all the windows stays within a shared budget. A
+// connection that hasn't received anything for a while goes back to the
+// initial window. The stack's window is held to a connection's window by not
+// giving some of the received data back to the stack.
+//
+// A corked connection collects small writes and hands them to the stack only
+// in full segments. Whatever's left is sent when the connection is uncorked or
+// when the cork timeout expires, checked by pushCorked().
 struct ConnectionState final {
-  // Creates a new object and sets `arg` as the pcb's arg. This also reserves
-  // TCP_WND bytes as buffer space.
+  // Data shared by several connections, for example by a broadcast. It's freed
+  // when no connection needs it any more.
+  using SharedData = std::shared_ptr<const std::vector<uint8_t>>;
+
+  // Creates a new object and sets `arg` as the pcb's arg. The buffer space is
+  // reserved when the first data is copied into it.
   ConnectionState(struct altcp_pcb* const tpcb, void* const arg)
       : pcb(tpcb),
-        bufPos(0) {
+        bufPos(0),
+        corkTimeout(QNETHERNET_DEFAULT_TCP_CORK_TIMEOUT) {
     altcp_arg(tpcb, arg);
-#if LWIP_WND_SCALE
-    buf.reserve(TCP_WND >> TCP_RCV_SCALE);
-#else
-    buf.reserve(TCP_WND);
-#endif  // LWIP_WND_SCALE
+    startWindow();
+    startCounters();
   }
 
   // Sets the callback arg to nullptr and then calls the 'remove' function. The
-  // object should be deleted before more 'tcp' functions are called.
-  ~ConnectionState() noexcept {
-    // Ensure callbacks are no longer called with this as the argument
-    altcp_arg(pcb, nullptr);
-
-    if (removeFunc != nullptr) {
-      removeFunc(this);
-    }
-  }
+  // object should be deleted before more 'tcp' functions are called. Any
+  // borrowed chunks are returned to the pool, and any pending writes are
+  // either failed or, if the PCB may still be sending them, handed over to it.
+  ~ConnectionState() noexcept;
 
   // See: https://www.cppreference.com/cpp/language/rule_of_three
   ConnectionState(const ConnectionState&) = delete;
@@ -52,16 +76,233 @@ struct ConnectionState final {
   ConnectionState& operator=(const ConnectionState&) = delete;
   ConnectionState& operator=(ConnectionState&&) = delete;
 
+  // States come from ConnectionStatePool instead of the heap.
+  static void* operator new(size_t size);
+  static void operator delete(void* p);
+
+  // Takes in received data. This returns ERR_OK if the pbuf was consumed and
+  // ERR_MEM if there's no room for it, in which case the pbuf is left alone so
+  // that lwIP retains and retries it.
+  ATTRIBUTE_NODISCARD
+  err_t receive(struct pbuf* p);
+
+  // Returns whether there's any unread data.
+  bool isAvailable() const {
+    return (/*(0 <= bufPos) &&*/ (bufPos < buf.size())) ||
+           (chunkHead != nullptr) || (pbufs != nullptr);
+  }
+
+  // Returns the number of unread bytes.
+  size_t available() const;
+
+  // Returns the next byte, or -1 if there's no data.
+  int peek() const;
+
+  // Reads up to 'size' bytes and returns the number read. A NULL destination
+  // skips the bytes.
+  size_t read(uint8_t* dest, size_t size);
+
+  // Appends all the unread data to the given vector and empties the buffers.
+  // This doesn't acknowledge anything to the stack.
+  void moveTo(std::vector<uint8_t>& v);
+
+  // Sets the total of all the connections' receive windows beyond which none
+  // of them grows. Windows already larger than this aren't shrunk until
+  // they're idle.
+  static void setWindowBudget(size_t budget);
+
+  // Returns the receive window budget.
+  static size_t windowBudget();
+
+  // Returns the total of all the connections' receive windows.
+  static size_t windowTotal();
+
+  // Gives any withheld data back to the stack, along with any unread queued
+  // pbufs, which are freed. Call this before closing the connection because
+  // lwIP resets and frees, instead of closes, a connection whose window isn't
+  // fully open. Data that the stack is holding because it was refused isn't
+  // touched, so a connection that has some is still reset when closed, as
+  // RFC 1122 specifies for unread data.
+  void releaseWindow();
+
+  // Returns whether closing the connection will reset it, and free the PCB,
+  // because the stack is holding refused data or the window isn't fully open.
+  bool closeResets() const;
+
+  // Sets the zero-copy mode and releases the copy buffer if it's empty.
+  void setZeroCopyReceive(bool flag);
+
+  // Returns the innermost TCP PCB. For altcp, the PCBs are nested.
+  struct tcp_pcb* tcpPcb() const;
+
+  // Tracks a write that was just made without copying. The callback is called
+  // with true once the remote side has acknowledged everything written so far,
+  // or with false if the connection is gone first.
+  void addPendingWrite(std::function<void(bool acked)> cb);
+
+  // Calls the callbacks for any acknowledged writes. This is called from the
+  // 'sent' callback.
+  void ackWrites();
+
+  // Writes as much of the shared data, starting at 'pos', as there's room for,
+  // without copying it. The data is kept until it's acknowledged. This returns
+  // the number of bytes handed to the stack.
+  size_t writeShared(const SharedData& data, size_t pos);
+
+  // Queues the shared data, starting at 'pos', to be sent by sendQueued() once
+  // there's room.
+  void queueShared(const SharedData& data, size_t pos);
+
+  // Writes as much of the queued shared data as there's room for. This is
+  // called from the 'sent' callback, and from retryQueued() if the stack
+  // refused a write while nothing was in flight.
+  void sendQueued();
+
+  // Sends queued shared data for every connection whose last attempt was
+  // refused while nothing was in flight, and so won't get a 'sent' callback.
+  // This is called from Ethernet.loop().
+  static void retryQueued();
+
+  // Sets whether writes are corked. Uncorking sends any corked data.
+  void setCorked(bool flag);
+
+  // Adds data to the cork buffer, sending any full segments, and returns the
+  // number of bytes taken. The buffer never holds more than the stack has
+  // room for.
+  size_t cork(const uint8_t* buf, size_t size);
+
+  // Sends the corked data. If 'all' is false then only full segments are sent.
+  // This returns whether the cork buffer is now empty.
+  bool sendCorked(bool all);
+
+  // Sends the corked data of every connection that's uncorked or whose cork
+  // timeout has expired. This is called from Ethernet.loop().
+  static void pushCorked();
+
   struct altcp_pcb* const /*volatile*/ pcb;
 
-  // Incoming data buffer
+  // Incoming data buffer, used when the chunk pool is disabled
   std::vector<uint8_t> buf;
   /*volatile*/ size_t bufPos;
 
-  // Called from the destructor after the callback arg is deleted.
-  std::function<void(ConnectionState*)> removeFunc;
+  // Chunks borrowed from the pool, used when the pool is enabled. If the pool
+  // runs out, data is queued in 'pbufs' instead.
+  ChunkPool::Chunk* chunkHead = nullptr;
+  ChunkPool::Chunk* chunkTail = nullptr;
+  size_t chunkBytes = 0;
+
+  // Zero-copy receive: incoming pbuf chains are queued here instead of being
+  // copied. The data is acknowledged to the stack as it's read.
+  bool zeroCopyReceive = false;
+  PbufPtr pbufs;
+
+  // A write, made without copying, that hasn't been acknowledged yet.
+  struct PendingWrite final {
+    uint32_t endSeq;  // Sequence number just past the data
+    std::function<void(bool acked)> cb;
+  };
+  std::vector<PendingWrite> pendingWrites;
+
+  // Shared data waiting for send space. Nothing else may be written until this
+  // is empty, so that the order is preserved.
+  struct QueuedWrite final {
+    SharedData data;
+    size_t pos;  // Start of the unsent part
+  };
+  std::vector<QueuedWrite> queuedWrites;
+  size_t queuedBytes = 0;
+  ListLink<ConnectionState> stalledLink;  // Waiting for retryQueued()
+
+  // Receive window tuning
+  size_t rcvWnd = 0;          // This connection's window
+  size_t withheld = 0;        // Received bytes not given back to the stack
+  size_t roundBytes = 0;      // Bytes received since the window last changed
+  uint32_t lastReceive = 0;   // Time of the last received data, in ms
+  ListLink<ConnectionState> windowLink;  // All the connections
+
+  // Write coalescing
+  bool corked = false;
+  uint32_t corkTimeout;        // Max. time to hold data, in ms
+  uint32_t corkTime = 0;       // When the oldest corked data was written
+  std::vector<uint8_t> corkBuf;
+  ListLink<ConnectionState> corkLink;  // Connections having corked data
+
+  // Cumulative counters, kept by the lwIP TCP hooks when
+  // QNETHERNET_ENABLE_TCP_COUNTERS is enabled
+  TcpCounters counters;
+
+  // Set when lwIP has freed the PCB, for example from the error callback.
+  // Otherwise, the destructor hands any pending writes over to the PCB, since
+  // it might still be sending the data.
+  bool pcbFreed = false;
+
+  // Called from the destructor, with 'removeArg', after the callback arg
+  // is deleted.
+  void (*removeFunc)(ConnectionState* state, void* arg) = nullptr;
+  void* removeArg = nullptr;
+
+ private:
+  // Releases the copy buffer if there's no unread data in it.
+  void maybeReleaseBuf();
+
+  // Adds this to or removes this from the connections that retryQueued()
+  // checks, depending on whether there's queued data and nothing in flight.
+  void watchQueued();
+
+  // Stores received data. This is receive() without the window tuning.
+  ATTRIBUTE_NODISCARD
+  err_t store(struct pbuf* p);
+
+  // Starts tracking this connection's window. This is called from
+  // the constructor.
+  void startWindow();
+
+  // Attaches the counters to the PCB so that the TCP hooks can find them. This
+  // is called from the constructor.
+  void startCounters();
+
+  // Gives received bytes back to the stack, withholding enough to keep the
+  // stack's window within this connection's window.
+  void recved(size_t n);
+
+  // Counts received data and grows the window if the remote side filled it.
+  // 'unread' is the amount of unread data before this data arrived.
+  void tuneWindow(size_t n, size_t unread);
+
+  // Changes the window and the total. A larger window gives withheld data back
+  // to the stack.
+  void setWindow(size_t wnd);
+
+  // Returns idle connections, other than the given one, to the
+  // initial window.
+  static void shrinkIdle(const ConnectionState* except);
+
+  // Queues the pbuf itself. This returns ERR_OK if the pbuf was consumed and
+  // ERR_MEM if the queue is full.
+  ATTRIBUTE_NODISCARD
+  err_t queuePbuf(struct pbuf* p);
+
+  // Copies the pbuf into the pooled chunks. This returns false if the
+  // connection's share or the pool is full.
+  ATTRIBUTE_NODISCARD
+  bool receiveIntoChunks(const struct pbuf* p);
+
+  // Reads from the chunks, returning emptied ones to the pool.
+  size_t readChunks(uint8_t* dest, size_t size);
+
+  // Frees any zero-length pbufs at the front of the queue. lwIP can leave
+  // these when it trims an overlapping segment.
+  void dropEmptyPbufs();
+
+  // Reads from the queued pbufs and acknowledges the data to the stack.
+  size_t readPbufs(uint8_t* dest, size_t size);
 };
 
+// There's at most one state per TCP PCB.
+using ConnectionStatePool = FixedPool<sizeof(ConnectionState),
+                                      alignof(ConnectionState),
+                                      MEMP_NUM_TCP_PCB>;
+
 }  // namespace internal
 }  // namespace network
 }  // namespace qindesign
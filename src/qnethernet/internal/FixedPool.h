@@ -0,0 +1,160 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// FixedPool.h defines a pool of fixed-size blocks in static storage, and an
+// allocator that uses it, so that frequently-created objects don't fragment
+// the heap.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+// C++ includes
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+
+namespace qindesign {
+namespace network {
+namespace internal {
+
+// FixedPool is a pool of 'Count' blocks, each holding 'Size' bytes aligned to
+// 'Align'. When it runs out, blocks come from the heap instead.
+template <size_t Size, size_t Align, size_t Count>
+class FixedPool final {
+ public:
+  static constexpr size_t kSize  = Size;
+  static constexpr size_t kAlign = Align;
+  static constexpr size_t kCount = Count;
+
+  // Accesses the pool for these parameters.
+  static FixedPool& instance() {
+    static FixedPool pool;
+    return pool;
+  }
+
+  // Returns a block. If the pool is empty then this behaves like
+  // operator new.
+  void* allocate() {
+    Block* const b = free_;
+    if (b == nullptr) {
+      ++overflows_;
+      return ::operator new(Size);
+    }
+    free_ = b->next;
+    ++inUse_;
+    return b;
+  }
+
+  // Allocates 'size' bytes from the heap for something that doesn't fit in
+  // a block. This counts as an overflow.
+  void* allocateOverflow(const size_t size) {
+    ++overflows_;
+    return ::operator new(size);
+  }
+
+  // Returns a block from allocate() or allocateOverflow().
+  void deallocate(void* const p) {
+    if (!owns(p)) {
+      ::operator delete(p);
+      return;
+    }
+    Block* const b = static_cast<Block*>(p);
+    b->next = free_;
+    free_ = b;
+    --inUse_;
+  }
+
+  // Returns the number of blocks in use from the pool.
+  size_t inUse() const {
+    return inUse_;
+  }
+
+  // Returns the number of times the heap was used instead of the pool, either
+  // because the pool was empty or because something didn't fit in a block.
+  uint32_t overflows() const {
+    return overflows_;
+  }
+
+ private:
+  union Block {
+    Block* next;
+    alignas(Align) unsigned char data[Size];
+  };
+
+  FixedPool() {
+    // Hand out the blocks in order
+    for (size_t i = Count; i-- > 0;) {
+      blocks_[i].next = free_;
+      free_ = &blocks_[i];
+    }
+  }
+
+  bool owns(const void* const p) const {
+    const std::less_equal<const void*> le;
+    return le(&blocks_[0], p) && !le(&blocks_[Count], p);
+  }
+
+  Block blocks_[Count];
+  Block* free_ = nullptr;
+  size_t inUse_ = 0;
+  uint32_t overflows_ = 0;
+};
+
+// PoolAllocator allocates single objects from a FixedPool, for example for
+// std::allocate_shared(). Arrays come from the heap and are counted as pool
+// overflows. Objects that don't fit in a block don't compile.
+template <typename T, typename Pool>
+class PoolAllocator final {
+ public:
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = PoolAllocator<U, Pool>;
+  };
+
+  PoolAllocator() = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U, Pool>& other) {
+    (void)other;
+  }
+
+  T* allocate(const size_t n) {
+    static_assert((sizeof(T) <= Pool::kSize) && (alignof(T) <= Pool::kAlign),
+                  "Pool blocks are too small for this type");
+    if (n != 1) {
+      return static_cast<T*>(Pool::instance().allocateOverflow(n * sizeof(T)));
+    }
+    return static_cast<T*>(Pool::instance().allocate());
+  }
+
+  void deallocate(T* const p, const size_t n) {
+    if (n != 1) {
+      ::operator delete(p);
+      return;
+    }
+    Pool::instance().deallocate(p);
+  }
+};
+
+template <typename T, typename U, typename Pool>
+bool operator==(const PoolAllocator<T, Pool>& a,
+                const PoolAllocator<U, Pool>& b) {
+  (void)a;
+  (void)b;
+  return true;
+}
+
+template <typename T, typename U, typename Pool>
+bool operator!=(const PoolAllocator<T, Pool>& a,
+                const PoolAllocator<U, Pool>& b) {
+  (void)a;
+  (void)b;
+  return false;
+}
+
+}  // namespace internal
+}  // namespace network
+}  // namespace qindesign
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// IntrusiveList.h defines a doubly-linked list whose links live inside the
+// elements, so that adding and removing never allocates.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+// C++ includes
+#include <cstddef>
+
+namespace qindesign {
+namespace network {
+namespace internal {
+
+// The links for one list. An element has one of these for each list it can
+// be in.
+template <typename T>
+struct ListLink final {
+  T* prev = nullptr;
+  T* next = nullptr;
+  bool linked = false;
+};
+
+// IntrusiveList is a list of elements that aren't owned by the list. An element
+// must be removed before it's destroyed.
+template <typename T, ListLink<T> T::*Link>
+class IntrusiveList final {
+ public:
+  bool empty() const {
+    return head_ == nullptr;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  T* front() const {
+    return head_;
+  }
+
+  // Returns the element after the given one, or NULL if it's the last.
+  static T* next(const T* const t) {
+    return (t->*Link).next;
+  }
+
+  // Returns whether the element is in a list of this kind.
+  static bool isLinked(const T* const t) {
+    return (t->*Link).linked;
+  }
+
+  // Adds an element to the end. It must not already be in a list of
+  // this kind.
+  void pushBack(T* const t) {
+    ListLink<T>& link = t->*Link;
+    link.prev = tail_;
+    link.next = nullptr;
+    link.linked = true;
+    if (tail_ != nullptr) {
+      (tail_->*Link).next = t;
+    } else {
+      head_ = t;
+    }
+    tail_ = t;
+    ++size_;
+  }
+
+  // Removes an element from this list. This does nothing if it's not linked.
+  void remove(T* const t) {
+    ListLink<T>& link = t->*Link;
+    if (!link.linked) {
+      return;
+    }
+    if (link.prev != nullptr) {
+      (link.prev->*Link).next = link.next;
+    } else {
+      head_ = link.next;
+    }
+    if (link.next != nullptr) {
+      (link.next->*Link).prev = link.prev;
+    } else {
+      tail_ = link.prev;
+    }
+    link.prev = nullptr;
+    link.next = nullptr;
+    link.linked = false;
+    --size_;
+  }
+
+  // Moves an element in this list to the end.
+  void moveToBack(T* const t) {
+    if (t != tail_) {
+      remove(t);
+      pushBack(t);
+    }
+  }
+
+  // Removes all the elements.
+  void clear() {
+    while (head_ != nullptr) {
+      remove(head_);
+    }
+  }
+
+ private:
+  T* head_ = nullptr;
+  T* tail_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace internal
+}  // namespace network
+}  // namespace qindesign
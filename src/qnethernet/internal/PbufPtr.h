@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// PbufPtr.h defines an owning pbuf pointer for internal use. It's used by
+// EthernetUDP and the TCP connection state for holding received data
+// without copying.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+// C++ includes
+#include <memory>
+
+#include "lwip/pbuf.h"
+
+namespace qindesign {
+namespace network {
+namespace internal {
+
+// Frees a pbuf reference.
+struct PbufDeleter final {
+  void operator()(struct pbuf* const p) const {
+    (void)pbuf_free(p);
+  }
+};
+
+// Owns one reference to a pbuf chain.
+using PbufPtr = std::unique_ptr<struct pbuf, PbufDeleter>;
+
+}  // namespace internal
+}  // namespace network
+}  // namespace qindesign
@@ -6,17 +6,22 @@
 // platforms, which is why this is defined here.
 //
 // To use this class:
-// 1. Derive from PrintfChecked in addition to Print, and
-// 2. Put `using qindesign::network::internal::PrintfChecked::printf;` in the
-//    public area of your class.
+// 1. Derive from PrintfChecked<YourClass> in addition to Print, and
+// 2. Put `using qindesign::network::internal::PrintfChecked<YourClass>::printf;`
+//    in the public area of your class.
 //
 // This file is part of the QNEthernet library.
 
 #pragma once
 
 // C++ includes
+#include <climits>
 #include <cstdarg>
+#include <cstdint>
 #include <cstdio>
+#if INTPTR_MAX > INT_MAX
+#include <memory>
+#endif  // INTPTR_MAX > INT_MAX
 
 #include "qnethernet/compat/c++11_compat.h"
 
@@ -24,6 +29,8 @@ namespace qindesign {
 namespace network {
 namespace internal {
 
+// 'Derived' is the class that derives from this one and from Print.
+template <typename Derived>
 class PrintfChecked {
  public:
   PrintfChecked() = default;
@@ -33,10 +40,35 @@ class PrintfChecked {
   int printf(const char* const format, ...) {
     std::va_list args;
     va_start(args, format);
+#if INTPTR_MAX > INT_MAX
+    // A pointer doesn't fit in a file descriptor here (eg. 64-bit hosts), so
+    // format into a buffer and write it instead
+    const int retval = vprintToPrint(format, args);
+#else
     const int retval = ::vdprintf(reinterpret_cast<int>(this), format, args);
+#endif  // INTPTR_MAX > INT_MAX
     va_end(args);
     return retval;
   }
+
+#if INTPTR_MAX > INT_MAX
+ private:
+  int vprintToPrint(const char* const format, std::va_list args) {
+    std::va_list args2;
+    va_copy(args2, args);
+    const int size = std::vsnprintf(nullptr, 0, format, args2);
+    va_end(args2);
+    if (size <= 0) {
+      return size;
+    }
+
+    std::unique_ptr<char[]> buf{new char[size + 1]};
+    (void)std::vsnprintf(buf.get(), size + 1, format, args);
+    return static_cast<int>(static_cast<Derived*>(this)->write(
+        reinterpret_cast<const uint8_t*>(buf.get()),
+        static_cast<size_t>(size)));
+  }
+#endif  // INTPTR_MAX > INT_MAX
 };
 
 }  // namespace internal
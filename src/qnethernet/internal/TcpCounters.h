@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// TcpCounters.h defines the cumulative counters kept for each TCP connection.
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+// C++ includes
+#include <cstdint>
+
+namespace qindesign {
+namespace network {
+namespace internal {
+
+// TcpCounters holds the cumulative counters for one TCP connection. They're
+// updated from the lwIP TCP input and output hooks, which find them through
+// the PCB's ext arg.
+struct TcpCounters final {
+  uint64_t bytesSent          = 0;  // New data sent, not counting retransmits
+  uint64_t bytesReceived      = 0;  // Data received, including duplicates
+  uint64_t bytesRetransmitted = 0;
+  uint32_t segmentsSent       = 0;  // Including retransmits and pure ACKs
+  uint32_t segmentsReceived   = 0;
+  uint32_t retransmits        = 0;  // Segments sent again
+  uint32_t outOfOrder         = 0;  // Segments that arrived ahead of a gap
+  uint32_t zeroWindowsReceived = 0;  // Times the remote side closed its window
+  uint32_t zeroWindowsSent    = 0;  // Times this side closed its window
+
+  // Whether the last window in each direction was zero, so that only the
+  // changes to zero are counted
+  bool remoteWindowClosed = false;
+  bool localWindowClosed  = false;
+
+  // Sequence number just past everything sent so far, for spotting retransmits
+  uint32_t sndMax   = 0;
+  bool sndMaxValid  = false;
+};
+
+}  // namespace internal
+}  // namespace network
+}  // namespace qindesign
@@ -58,10 +58,33 @@ static struct dhcp s_dhcp;
 static struct autoip s_autoip;
 #endif  // LWIP_AUTOIP
 
+// Receive processing
+static int s_rxBudget = 0;  // Max. frames per proc_input(); zero for no budget
+static RxLoopStats s_rxLoopStats;
+
+// Checksum offload state
+static bool s_txChecksumOffload = false;
+static bool s_rxChecksumOffload = false;
+static ChecksumOffloadStats s_checksumStats;
+
+// Timestamps
+static bool s_isInputFrame = false;  // Whether a driver frame is being input
+static uint32_t s_lastTxFrame = 0;  // ID of the last IP or raw frame sent
+
 // --------------------------------------------------------------------------
 //  Internal Functions
 // --------------------------------------------------------------------------
 
+// Returns whether the frame in the given pbuf is an IPv4 or IPv6 frame. The
+// frame is expected to start with any ETH_PAD_SIZE padding.
+ATTRIBUTE_NODISCARD
+static bool is_ip_frame(const struct pbuf* const p) {
+  const uint16_t type =
+      static_cast<uint16_t>((pbuf_get_at(p, ETH_PAD_SIZE + 12) << 8) |
+                            pbuf_get_at(p, ETH_PAD_SIZE + 13));
+  return (type == ETHTYPE_IP) || (type == ETHTYPE_IPV6);
+}
+
 // Outputs the given pbuf to the driver.
 ATTRIBUTE_NODISCARD
 static err_t link_output(struct netif* const netif, struct pbuf* const p) {
@@ -71,7 +94,14 @@ static err_t link_output(struct netif* const netif, struct pbuf* const p) {
     return ERR_ARG;
   }
 
-  return driver::output(p);
+  const err_t err = driver::output(p);
+  if ((err == ERR_OK) && is_ip_frame(p)) {
+    s_lastTxFrame = driver::get_tx_frame_count();
+    if (s_txChecksumOffload) {
+      ++s_checksumStats.txFrames;
+    }
+  }
+  return err;
 }
 
 #if LWIP_IGMP && !QNETHERNET_ENABLE_PROMISCUOUS_MODE
@@ -142,6 +172,29 @@ FLASHMEM static err_t init_netif(struct netif* const netif) {
   netif_set_igmp_mac_filter(netif, &multicast_filter);
 #endif  // LWIP_IGMP && !QNETHERNET_ENABLE_PROMISCUOUS_MODE
 
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+  // Only use software checksums where the driver can't offload them
+  DriverCapabilities dc;
+  driver::get_capabilities(&dc);
+  s_txChecksumOffload = dc.isTxChecksumOffloadable;
+  s_rxChecksumOffload = dc.isRxChecksumOffloadable;
+
+  uint16_t flags = NETIF_CHECKSUM_ENABLE_ALL;
+  if (s_txChecksumOffload) {
+    flags = static_cast<uint16_t>(flags & ~(NETIF_CHECKSUM_GEN_IP  |
+                                            NETIF_CHECKSUM_GEN_UDP |
+                                            NETIF_CHECKSUM_GEN_TCP |
+                                            NETIF_CHECKSUM_GEN_ICMP));
+  }
+  if (s_rxChecksumOffload) {
+    flags = static_cast<uint16_t>(flags & ~(NETIF_CHECKSUM_CHECK_IP  |
+                                            NETIF_CHECKSUM_CHECK_UDP |
+                                            NETIF_CHECKSUM_CHECK_TCP |
+                                            NETIF_CHECKSUM_CHECK_ICMP));
+  }
+  NETIF_SET_CHECKSUM_CTRL(netif, flags);
+#endif  // LWIP_CHECKSUM_CTRL_PER_NETIF
+
   return ERR_OK;
 }
 
@@ -257,18 +310,89 @@ FLASHMEM void deinit() {
 void proc_input() {
   int counter = 0;
   while (true) {
+    if ((s_rxBudget > 0) && (counter >= s_rxBudget)) {
+      ++s_rxLoopStats.budgetHits;
+      driver::rx_pending();
+      break;
+    }
+
     // Note: It is expected that driver::proc_input() will return NULL
     //       at some point
-    struct pbuf* const p = driver::proc_input(&s_netif, counter++);
+    struct pbuf* const p = driver::proc_input(&s_netif, counter);
     if (p == nullptr) {  // Happens on frame error, pbuf allocation error, or loop end
       break;
     }
+    ++counter;
+
+    if (s_rxChecksumOffload && is_ip_frame(p)) {
+      ++s_checksumStats.rxFrames;
+    }
 
     // Process one chunk of input data
+    // The timestamp is only fetched from the driver if someone asks for it
+    s_isInputFrame = true;
     if (s_netif.input(p, &s_netif) != ERR_OK) {
       (void)pbuf_free(p);
     }
+    s_isInputFrame = false;
+  }
+
+  const uint32_t frames = static_cast<uint32_t>(counter);
+  ++s_rxLoopStats.loops;
+  s_rxLoopStats.frames += frames;
+  s_rxLoopStats.lastFrames = frames;
+  if (frames > s_rxLoopStats.maxFrames) {
+    s_rxLoopStats.maxFrames = frames;
+  }
+}
+
+bool set_rx_settings(const RxSettings* const settings) {
+  if (settings == nullptr) {
+    return false;
+  }
+  if (!driver::set_rx_settings(settings)) {
+    return false;
   }
+  s_rxBudget = settings->budget;
+  return true;
+}
+
+void get_rx_loop_stats(RxLoopStats* const stats) {
+  if (stats != nullptr) {
+    *stats = s_rxLoopStats;
+  }
+}
+
+void reset_rx_loop_stats() {
+  s_rxLoopStats = RxLoopStats{};
+}
+
+void get_checksum_offload_stats(ChecksumOffloadStats* const stats) {
+  if (stats != nullptr) {
+    *stats = s_checksumStats;
+  }
+}
+
+void reset_checksum_offload_stats() {
+  s_checksumStats = ChecksumOffloadStats{};
+}
+
+bool get_rx_timestamp(uint64_t* const timestamp) {
+  if (!s_isInputFrame || (timestamp == nullptr)) {
+    return false;
+  }
+  return driver::get_rx_timestamp(timestamp);
+}
+
+uint32_t get_last_tx_frame() {
+  return s_lastTxFrame;
+}
+
+bool get_tx_timestamp(const uint32_t frame, uint64_t* const timestamp) {
+  if ((frame == 0) || (timestamp == nullptr)) {
+    return false;
+  }
+  return driver::get_tx_timestamp(frame, timestamp);
 }
 
 void poll() {
@@ -316,9 +440,17 @@ bool output_frame(const void* const frame, const size_t len) {
         LWIP_PLATFORM_ASSERT("Expected space for pbuf fill");
       }
 
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+      // The frame doesn't pass through the hardware, so check it in software
+      const uint16_t flags = s_netif.chksum_flags;
+      NETIF_SET_CHECKSUM_CTRL(&s_netif, NETIF_CHECKSUM_ENABLE_ALL);
+#endif  // LWIP_CHECKSUM_CTRL_PER_NETIF
       if (s_netif.input(p, &s_netif) != ERR_OK) {
         (void)pbuf_free(p);
       }
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+      NETIF_SET_CHECKSUM_CTRL(&s_netif, flags);
+#endif  // LWIP_CHECKSUM_CTRL_PER_NETIF
     }
     // TODO: Collect stats?
 
@@ -328,7 +460,11 @@ bool output_frame(const void* const frame, const size_t len) {
   }
 #endif  // QNETHERNET_ENABLE_RAW_FRAME_LOOPBACK
 
-  return driver::output_frame(frame, len);
+  if (!driver::output_frame(frame, len)) {
+    return false;
+  }
+  s_lastTxFrame = driver::get_tx_frame_count();
+  return true;
 }
 #endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
 
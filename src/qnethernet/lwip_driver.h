@@ -65,7 +65,9 @@ static_assert(ETH_PAD_SIZE <= UINT16_MAX, "ETH_PAD_SIZE must be <= UINT16_MAX");
 //    MAX_FRAME_LEN. MAX_FRAME_LEN should not include the 4-byte FCS. Don't
 //    forget to use either `#pragma once` or a #define guard.
 // 2. Add lwIP options (see lwip/opt.h) with appropriate values for your driver.
-//    For example, Ethernet padding, checksum generation, and checksum checking.
+//    For example, Ethernet padding. Checksum generation and checking are turned
+//    off per netif at runtime according to the checksum offload capabilities;
+//    see DriverCapabilities.
 // 3. Create driver source and include lwip_driver.h. Implement all the
 //    `driver::x()` functions.
 
@@ -77,6 +79,12 @@ namespace network {
 // --------------------------------------------------------------------------
 
 // Flags that indicate driver capabilities.
+//
+// The checksum offload flags cover the IPv4 header checksum and the TCP, UDP,
+// and ICMP checksums. If TX offload is supported then the driver must insert
+// these for frames sent with output(), and if RX offload is supported then it
+// must drop frames having bad checksums. Software checksums are turned off for
+// the netif for each direction that's offloaded.
 struct DriverCapabilities {
   bool isMACSettable                = false;
   bool isLinkStateDetectable        = false;
@@ -88,6 +96,10 @@ struct DriverCapabilities {
   bool isLinkCrossoverDetectable    = false;
   bool isAutoNegotiationRestartable = false;
   bool isPHYResettable              = false;
+  bool isRxCoalescingSettable       = false;
+  bool isTxChecksumOffloadable      = false;
+  bool isRxChecksumOffloadable      = false;
+  bool isFrameTimestampable         = false;
 };
 
 // Link information. Defaults are:
@@ -115,6 +127,67 @@ struct LinkSettings {
   bool autoNegotiation   = true;
 };
 
+// Receive processing settings. Defaults are:
+// * No interrupt coalescing
+// * No per-loop frame budget, other than any driver limit
+// * No adaptive polling
+//
+// Interrupt coalescing is only enabled when both coalescing thresholds are
+// non-zero. An interrupt is then generated when either is reached.
+//
+// If 'pollRate' is non-zero then the driver switches from interrupt-driven to
+// polled receive when the frame rate reaches 'pollRate' frames per second, and
+// back again when it falls below half that.
+struct RxSettings {
+  uint8_t coalesceFrames  = 0;  // Frame count threshold
+  uint16_t coalesceMicros = 0;  // Timer threshold, from the first frame
+  int budget              = 0;  // Max. frames per loop; zero for no budget
+  uint32_t pollRate       = 0;  // Frames per second; zero to never poll
+};
+
+// Receive loop statistics, counted each time input is processed.
+struct RxLoopStats {
+  uint32_t loops      = 0;  // Number of times input was processed
+  uint32_t frames     = 0;  // Total frames processed
+  uint32_t lastFrames = 0;  // Frames processed the last time
+  uint32_t maxFrames  = 0;  // Max. frames processed in one go
+  uint32_t budgetHits = 0;  // Times processing stopped at the budget
+};
+
+// Checksum offload statistics. These count the IPv4 and IPv6 frames whose
+// checksums were generated or checked by the hardware instead of by software.
+struct ChecksumOffloadStats {
+  uint32_t txFrames = 0;  // Frames sent with hardware checksum generation
+  uint32_t rxFrames = 0;  // Frames received with hardware checksum checking
+};
+
+// Where a driver should put its buffers.
+enum class DriverBufferPlacement {
+  kBuiltIn,  // The driver's built-in buffers
+  kHeap,     // Allocated once from the heap
+  kRegion,   // The caller-supplied region
+};
+
+// Driver buffer configuration. Defaults are:
+// * Driver-default RX and TX ring sizes (zero)
+// * Built-in buffers
+//
+// The region is only used with DriverBufferPlacement::kRegion.
+struct DriverConfig {
+  size_t rxRingSize = 0;  // Zero for the driver default
+  size_t txRingSize = 0;  // Zero for the driver default
+  DriverBufferPlacement bufferPlacement = DriverBufferPlacement::kBuiltIn;
+  void* region      = nullptr;
+  size_t regionSize = 0;
+
+  // Returns whether this is the default configuration.
+  ATTRIBUTE_NODISCARD
+  bool isDefault() const {
+    return (rxRingSize == 0) && (txRingSize == 0) &&
+           (bufferPlacement == DriverBufferPlacement::kBuiltIn);
+  }
+};
+
 // --------------------------------------------------------------------------
 //  Driver Interface
 // --------------------------------------------------------------------------
@@ -162,6 +235,20 @@ bool has_hardware();
 // it has not been initialized.
 void set_chip_select_pin(int pin);
 
+// Sets the buffer configuration to use when the driver allocates its buffers,
+// which happens once, during the first init(). This returns whether the
+// configuration is valid and supported. This will return false if the buffers
+// have already been allocated. Drivers that aren't configurable should only
+// accept the default configuration.
+ATTRIBUTE_NODISCARD
+bool set_config(const DriverConfig* config);
+
+// Returns the size of the caller-supplied region, including any alignment
+// slack, that's needed for the given configuration. This returns zero if the
+// driver doesn't support a region or if the ring sizes are invalid.
+ATTRIBUTE_NODISCARD
+size_t get_region_size(const DriverConfig* config);
+
 // Does low-level initialization. This returns whether the initialization
 // was successful. Most functions depend on the driver being initialized.
 ATTRIBUTE_NODISCARD
@@ -178,9 +265,25 @@ void deinit();
 ATTRIBUTE_NODISCARD
 struct pbuf* proc_input(struct netif* netif, int counter);
 
+// Tells the driver that input processing stopped before proc_input() returned
+// NULL, for example because of the per-loop budget, so frames may still be
+// waiting. The next proc_input() should look for them even if no new receive
+// interrupt arrives.
+void rx_pending();
+
 // Polls anything that needs to be polled, for example, the link status.
 void poll(struct netif* netif);
 
+// Applies the interrupt coalescing and adaptive polling parts of the receive
+// settings, immediately if the driver is initialized, and also on any
+// subsequent init(). The budget is handled by the caller. This returns whether
+// the settings are supported. Drivers that don't support interrupt coalescing
+// should return false if it's requested.
+//
+// See also: get_capabilities(dc)
+ATTRIBUTE_NODISCARD
+bool set_rx_settings(const RxSettings* settings);
+
 // Gets info about the link. The values will only be valid when the link is up.
 //
 // See also: get_capabilities(dc)
@@ -208,6 +311,35 @@ ATTRIBUTE_NODISCARD
 bool output_frame(const void* frame, size_t len);
 #endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
 
+// --------------------------------------------------------------------------
+//  Timestamps
+// --------------------------------------------------------------------------
+
+// Timestamps are in nanoseconds, measured by the driver's own clock.
+
+// Gets the hardware receive timestamp of the frame most recently returned by
+// proc_input() and returns whether one is available. This will return false if
+// the driver can't timestamp frames.
+//
+// See also: get_capabilities(dc)
+ATTRIBUTE_NODISCARD
+bool get_rx_timestamp(uint64_t* timestamp);
+
+// Returns the number of frames accepted by output() and output_frame(). The
+// count just after a frame is accepted is that frame's ID, for use with
+// get_tx_timestamp(). Drivers that can't timestamp frames may return zero.
+ATTRIBUTE_NODISCARD
+uint32_t get_tx_frame_count();
+
+// Gets the hardware transmit timestamp of the frame having the given ID and
+// returns whether it's available. This will return false if the frame hasn't
+// been sent yet, if it's no longer tracked, or if the driver can't
+// timestamp frames.
+//
+// See also: get_tx_frame_count()
+ATTRIBUTE_NODISCARD
+bool get_tx_timestamp(uint32_t frame, uint64_t* timestamp);
+
 // --------------------------------------------------------------------------
 //  MAC Address Filtering
 // --------------------------------------------------------------------------
@@ -328,6 +460,42 @@ void proc_input();
 // Polls the stack (if needed) and Ethernet link status.
 void poll();
 
+// Sets the receive settings. This stores the budget and passes the rest to
+// the driver. This returns whether the driver accepted the settings.
+ATTRIBUTE_NODISCARD
+bool set_rx_settings(const RxSettings* settings);
+
+// Gets the receive loop statistics.
+void get_rx_loop_stats(RxLoopStats* stats);
+
+// Resets the receive loop statistics.
+void reset_rx_loop_stats();
+
+// Gets the checksum offload statistics.
+void get_checksum_offload_stats(ChecksumOffloadStats* stats);
+
+// Resets the checksum offload statistics.
+void reset_checksum_offload_stats();
+
+// Gets the hardware timestamp of the frame currently being processed by the
+// stack and returns whether there is one. This is only meaningful from within
+// receive callbacks. Looped-back frames don't have a timestamp.
+ATTRIBUTE_NODISCARD
+bool get_rx_timestamp(uint64_t* timestamp);
+
+// Returns the ID of the most recent IP or raw frame accepted by the driver, or
+// zero if there hasn't been one. Callers can compare this value from before and
+// after a send to find the ID of the frame that was sent.
+ATTRIBUTE_NODISCARD
+uint32_t get_last_tx_frame();
+
+// Gets the hardware transmit timestamp of the frame having the given ID and
+// returns whether it's available. This returns false for an ID of zero.
+//
+// See also: get_last_tx_frame()
+ATTRIBUTE_NODISCARD
+bool get_tx_timestamp(uint32_t frame, uint64_t* timestamp);
+
 #if QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
 // Outputs a raw ethernet frame. This returns false if frame is NULL or if the
 // length is not in the correct range. The proper range is [14, MAX_FRAME_LEN-4]
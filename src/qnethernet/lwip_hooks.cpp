@@ -6,7 +6,8 @@
 
 #include "lwip_hooks.h"
 
-#if LWIP_TCP && QNETHERNET_ENABLE_SECURE_TCP_ISN
+#if LWIP_TCP && \
+    (QNETHERNET_ENABLE_SECURE_TCP_ISN || QNETHERNET_ENABLE_TCP_SYN_COOKIES)
 
 // C++ includes
 #include <cstddef>
@@ -14,17 +15,29 @@
 
 #include "qnethernet/security/siphash.h"
 
-// Key
-static bool s_haveKey = false;
-static uint8_t s_key[16];  // Filled with entropy on first use
-static uint8_t s_msg[2*sizeof(uint16_t) + 2*sizeof(ip_addr_t)];
-
 // HAL declarations
 extern "C" {
 size_t qnethernet_hal_fill_entropy(void* buf, size_t size);
 uint32_t qnethernet_hal_micros();
 }  // extern "C"
 
+// Fills a SipHash key with entropy.
+static void fillKey(uint8_t (&key)[16]) {
+  const size_t filled = qnethernet_hal_fill_entropy(key, sizeof(key));
+  if (filled != sizeof(key)) {
+    LWIP_PLATFORM_ASSERT("Entropy generation error");
+  }
+}
+
+#endif  // LWIP_TCP && (QNETHERNET_ENABLE_SECURE_TCP_ISN || ...)
+
+#if LWIP_TCP && QNETHERNET_ENABLE_SECURE_TCP_ISN
+
+// Key
+static bool s_haveKey = false;
+static uint8_t s_key[16];  // Filled with entropy on first use
+static uint8_t s_msg[2*sizeof(uint16_t) + 2*sizeof(ip_addr_t)];
+
 // The algorithm used here follows the suggestions of RFC 6528.
 // See:
 // * https://datatracker.ietf.org/doc/html/rfc6528
@@ -39,11 +52,7 @@ uint32_t calc_tcp_isn(const ip_addr_t* const local_ip,
                       const ip_addr_t* const remote_ip,
                       const uint16_t remote_port) {
   if (!s_haveKey) {
-    // Initialize the key
-    const size_t filled = qnethernet_hal_fill_entropy(s_key, sizeof(s_key));
-    if (filled != sizeof(s_key)) {
-      LWIP_PLATFORM_ASSERT("Entropy generation error");
-    }
+    fillKey(s_key);
     s_haveKey = true;
   }
 
@@ -65,3 +74,301 @@ uint32_t calc_tcp_isn(const ip_addr_t* const local_ip,
 }  // extern "C"
 
 #endif  // LWIP_TCP && QNETHERNET_ENABLE_SECURE_TCP_ISN
+
+#if LWIP_TCP && QNETHERNET_ENABLE_TCP_COUNTERS
+
+#include "lwip/def.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/tcp.h"
+#include "qnethernet/internal/TcpCounters.h"
+
+using qindesign::network::internal::TcpCounters;
+
+static uint8_t s_countersId = LWIP_TCP_PCB_NUM_EXT_ARG_ID_INVALID;
+
+// Returns whether sequence number 'a' is before 'b'.
+static inline bool seqLT(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+
+// Returns the counters attached to a connection PCB, or NULL if there are
+// none. Listening PCBs never have counters.
+static TcpCounters* counters(const struct tcp_pcb* const pcb) {
+  if ((pcb == nullptr) || (pcb->state == LISTEN) ||
+      (s_countersId == LWIP_TCP_PCB_NUM_EXT_ARG_ID_INVALID)) {
+    return nullptr;
+  }
+  return static_cast<TcpCounters*>(tcp_ext_arg_get(pcb, s_countersId));
+}
+
+extern "C" {
+
+uint8_t tcp_counters_id() {
+  if (s_countersId == LWIP_TCP_PCB_NUM_EXT_ARG_ID_INVALID) {
+    s_countersId = tcp_ext_arg_alloc_id();
+  }
+  return s_countersId;
+}
+
+// The header fields have already been converted to host order and the header
+// has been removed from the pbuf.
+err_t tcp_count_input(struct tcp_pcb* const pcb,
+                      const struct tcp_hdr* const hdr,
+                      const struct pbuf* const p) {
+  TcpCounters* const c = counters(pcb);
+  if (c == nullptr) {
+    return ERR_OK;
+  }
+
+  ++c->segmentsReceived;
+  c->bytesReceived += p->tot_len;
+  if ((p->tot_len > 0) && seqLT(pcb->rcv_nxt, hdr->seqno)) {
+    ++c->outOfOrder;
+  }
+
+  if ((TCPH_FLAGS(hdr) & (TCP_SYN | TCP_RST)) == 0) {
+    const bool closed = (hdr->wnd == 0);
+    if (closed && !c->remoteWindowClosed) {
+      ++c->zeroWindowsReceived;
+    }
+    c->remoteWindowClosed = closed;
+  }
+
+  return ERR_OK;
+}
+
+// The header fields are in network order and the pbuf starts with the header.
+// A segment that starts before the end of everything sent so far is being
+// sent again.
+uint32_t* tcp_count_output(const struct pbuf* const p,
+                           const struct tcp_hdr* const hdr,
+                           const struct tcp_pcb* const pcb,
+                           uint32_t* const opts) {
+  TcpCounters* const c = counters(pcb);
+  if (c == nullptr) {
+    return opts;
+  }
+
+  ++c->segmentsSent;
+  const auto len =
+      static_cast<uint16_t>(p->tot_len - TCPH_HDRLEN_BYTES(hdr));
+  const uint8_t flags = TCPH_FLAGS(hdr);
+  const uint32_t seqLen = len + (((flags & (TCP_SYN | TCP_FIN)) != 0) ? 1 : 0);
+  if (seqLen > 0) {
+    const uint32_t seqno = lwip_ntohl(hdr->seqno);
+    if (c->sndMaxValid && seqLT(seqno, c->sndMax)) {
+      ++c->retransmits;
+      c->bytesRetransmitted += len;
+    } else {
+      c->bytesSent += len;
+    }
+    if (!c->sndMaxValid || seqLT(c->sndMax, seqno + seqLen)) {
+      c->sndMax = seqno + seqLen;
+      c->sndMaxValid = true;
+    }
+  }
+
+  if ((flags & (TCP_SYN | TCP_RST)) == 0) {
+    const bool closed = (hdr->wnd == 0);
+    if (closed && !c->localWindowClosed) {
+      ++c->zeroWindowsSent;
+    }
+    c->localWindowClosed = closed;
+  }
+
+  return opts;
+}
+
+}  // extern "C"
+
+#endif  // LWIP_TCP && QNETHERNET_ENABLE_TCP_COUNTERS
+
+#if LWIP_TCP && QNETHERNET_ENABLE_TCP_SYN_COOKIES
+
+#include "lwip/sys.h"
+
+// A SYN cookie holds, from the high bit: a 5-bit time count, a 3-bit index
+// into the MSS table, and the low 24 bits of a keyed hash of the connection,
+// the peer's ISN, and the count. This follows the layout described in
+// RFC 4987, section 3.6.
+// See:
+// * https://datatracker.ietf.org/doc/html/rfc4987#section-3.6
+// * https://cr.yp.to/syncookies.html
+static constexpr unsigned kCookieTimeShift = 16;  // 65.536s per count
+static constexpr uint32_t kCookieCountMask = 0x1f;
+static constexpr uint32_t kCookieMaxAge    = 1;   // In counts
+static constexpr uint32_t kCookieHashMask  = 0x00ffffff;
+static constexpr uint16_t kCookieMSS[8]{
+    216, 536, 1024, 1200, 1360, 1400, 1440, 1460,
+};
+
+// Key
+static bool s_haveCookieKey = false;
+static uint8_t s_cookieKey[16];  // Filled with entropy on first use
+
+// Cookies are only checked for a while after one was sent
+static bool s_cookieSent = false;
+static uint32_t s_lastCookieTime = 0;
+
+static uint32_t s_cookiesSent     = 0;
+static uint32_t s_cookiesAccepted = 0;
+static uint32_t s_cookiesRejected = 0;
+static uint32_t s_cookiesFailed   = 0;
+
+// Returns the time count for the given time.
+static inline uint32_t cookieCount(const uint32_t now) {
+  return (now >> kCookieTimeShift) & kCookieCountMask;
+}
+
+// Appends an address's bytes to a message. Only the address bytes are used
+// because the rest of an ip_addr_t isn't always initialized.
+static uint8_t* putAddr(uint8_t* const p, const ip_addr_t* const addr) {
+#if LWIP_IPV6
+  if (IP_IS_V6(addr)) {
+    (void)std::memcpy(p, ip_2_ip6(addr)->addr, sizeof(ip_2_ip6(addr)->addr));
+    return p + sizeof(ip_2_ip6(addr)->addr);
+  }
+#endif  // LWIP_IPV6
+#if LWIP_IPV4
+  (void)std::memcpy(p, &ip_2_ip4(addr)->addr, sizeof(ip_2_ip4(addr)->addr));
+  return p + sizeof(ip_2_ip4(addr)->addr);
+#else
+  return p;
+#endif  // LWIP_IPV4
+}
+
+// Returns the hash part of a cookie.
+static uint32_t cookieHash(const ip_addr_t* const local_ip,
+                           const uint16_t local_port,
+                           const ip_addr_t* const remote_ip,
+                           const uint16_t remote_port,
+                           const uint32_t remote_isn,
+                           const uint32_t count) {
+  if (!s_haveCookieKey) {
+    fillKey(s_cookieKey);
+    s_haveCookieKey = true;
+  }
+
+  uint8_t msg[2*sizeof(uint16_t) + 2*16 + 2*sizeof(uint32_t)];
+  uint8_t* pMsg = msg;
+  (void)std::memcpy(pMsg, &local_port, sizeof(uint16_t));
+  pMsg += sizeof(uint16_t);
+  (void)std::memcpy(pMsg, &remote_port, sizeof(uint16_t));
+  pMsg += sizeof(uint16_t);
+  pMsg = putAddr(pMsg, remote_ip);
+  pMsg = putAddr(pMsg, local_ip);
+  (void)std::memcpy(pMsg, &remote_isn, sizeof(uint32_t));
+  pMsg += sizeof(uint32_t);
+  (void)std::memcpy(pMsg, &count, sizeof(uint32_t));
+  pMsg += sizeof(uint32_t);
+
+  return static_cast<uint32_t>(qindesign::security::siphash(
+             2, 4, s_cookieKey, msg, static_cast<size_t>(pMsg - msg))) &
+         kCookieHashMask;
+}
+
+extern "C" {
+
+uint32_t tcp_syn_cookie_isn(const ip_addr_t* const local_ip,
+                            const uint16_t local_port,
+                            const ip_addr_t* const remote_ip,
+                            const uint16_t remote_port,
+                            const uint32_t remote_isn,
+                            const uint16_t mss) {
+  // Use the largest MSS that isn't larger than the peer's
+  uint32_t index = 0;
+  while ((index + 1 < sizeof(kCookieMSS)/sizeof(kCookieMSS[0])) &&
+         (kCookieMSS[index + 1] <= mss)) {
+    ++index;
+  }
+
+  const uint32_t now = sys_now();
+  const uint32_t count = cookieCount(now);
+  s_cookieSent = true;
+  s_lastCookieTime = now;
+  ++s_cookiesSent;
+
+  return (count << 27) | (index << 24) |
+         cookieHash(local_ip, local_port, remote_ip, remote_port, remote_isn,
+                    count);
+}
+
+uint16_t tcp_syn_cookie_check(const ip_addr_t* const local_ip,
+                              const uint16_t local_port,
+                              const ip_addr_t* const remote_ip,
+                              const uint16_t remote_port,
+                              const uint32_t remote_isn,
+                              const uint32_t cookie) {
+  const uint32_t now = sys_now();
+  if (!s_cookieSent ||
+      (now - s_lastCookieTime > ((kCookieMaxAge + 1) << kCookieTimeShift))) {
+    return 0;
+  }
+
+  const uint32_t count = cookie >> 27;
+  const uint32_t age = (cookieCount(now) - count) & kCookieCountMask;
+  if ((age > kCookieMaxAge) ||
+      (((cookie ^ cookieHash(local_ip, local_port, remote_ip, remote_port,
+                             remote_isn, count)) &
+        kCookieHashMask) != 0)) {
+    ++s_cookiesRejected;
+    return 0;
+  }
+
+  return kCookieMSS[(cookie >> 24) & 0x07];
+}
+
+void tcp_syn_cookie_count(const int created) {
+  if (created) {
+    ++s_cookiesAccepted;
+  } else {
+    ++s_cookiesFailed;
+  }
+}
+
+void tcp_syn_cookie_stats(uint32_t* const sent, uint32_t* const accepted,
+                          uint32_t* const rejected, uint32_t* const failed) {
+  *sent     = s_cookiesSent;
+  *accepted = s_cookiesAccepted;
+  *rejected = s_cookiesRejected;
+  *failed   = s_cookiesFailed;
+}
+
+}  // extern "C"
+
+#endif  // LWIP_TCP && QNETHERNET_ENABLE_TCP_SYN_COOKIES
+
+#if LWIP_TCP && QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+
+#include "lwip/priv/tcp_priv.h"
+
+static uint32_t s_pcbEventCounts[TCP_PCB_EVENT_COUNT]{};
+static uint32_t s_timeWaitTimeout = QNETHERNET_DEFAULT_TCP_TIME_WAIT_TIMEOUT;
+
+extern "C" {
+
+void tcp_count_pcb_event(const enum tcp_pcb_event event) {
+  ++s_pcbEventCounts[event];
+}
+
+uint32_t tcp_pcb_event_count(const enum tcp_pcb_event event) {
+  return s_pcbEventCounts[event];
+}
+
+void tcp_reset_pcb_event_counts() {
+  for (uint32_t& count : s_pcbEventCounts) {
+    count = 0;
+  }
+}
+
+void tcp_set_time_wait_timeout(const uint32_t timeout) {
+  s_timeWaitTimeout = timeout;
+}
+
+uint32_t tcp_time_wait_timeout() {
+  return s_timeWaitTimeout;
+}
+
+}  // extern "C"
+
+#endif  // LWIP_TCP && QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
@@ -39,6 +39,80 @@ uint32_t calc_tcp_isn(const ip_addr_t* local_ip, uint16_t local_port,
 
 #endif  // LWIP_TCP && QNETHERNET_ENABLE_SECURE_TCP_ISN
 
+#if LWIP_TCP && QNETHERNET_ENABLE_TCP_COUNTERS
+
+struct tcp_pcb;
+struct tcp_hdr;
+
+#define LWIP_HOOK_TCP_INPACKET_PCB(pcb, hdr, optlen, opt1len, opt2, p) \
+  tcp_count_input((pcb), (hdr), (p))
+#define LWIP_HOOK_TCP_OUT_ADD_TCPOPTS(p, hdr, pcb, opts) \
+  tcp_count_output((p), (hdr), (pcb), (opts))
+
+// Returns the PCB ext arg ID under which the connection counters are stored.
+uint8_t tcp_counters_id(void);
+
+err_t tcp_count_input(struct tcp_pcb* pcb, const struct tcp_hdr* hdr,
+                      const struct pbuf* p);
+uint32_t* tcp_count_output(const struct pbuf* p, const struct tcp_hdr* hdr,
+                           const struct tcp_pcb* pcb, uint32_t* opts);
+
+#endif  // LWIP_TCP && QNETHERNET_ENABLE_TCP_COUNTERS
+
+#if LWIP_TCP && QNETHERNET_ENABLE_TCP_SYN_COOKIES
+
+// Returns the ISN to use for answering a SYN with a SYN cookie. The cookie
+// encodes the peer's MSS.
+uint32_t tcp_syn_cookie_isn(const ip_addr_t* local_ip, uint16_t local_port,
+                            const ip_addr_t* remote_ip, uint16_t remote_port,
+                            uint32_t remote_isn, uint16_t mss);
+
+// Checks a SYN cookie returned in an ACK and returns the MSS it encodes, or
+// zero if the cookie isn't valid. Cookies are only checked for a while after
+// one was sent.
+uint16_t tcp_syn_cookie_check(const ip_addr_t* local_ip, uint16_t local_port,
+                              const ip_addr_t* remote_ip, uint16_t remote_port,
+                              uint32_t remote_isn, uint32_t cookie);
+
+// Counts the outcome for a valid cookie: whether a connection was created
+// from it or none could be allocated.
+void tcp_syn_cookie_count(int created);
+
+// Gets the number of cookies sent, connections created from returned cookies,
+// invalid cookies returned, and valid cookies for which no connection could
+// be allocated.
+void tcp_syn_cookie_stats(uint32_t* sent, uint32_t* accepted,
+                          uint32_t* rejected, uint32_t* failed);
+
+#endif  // LWIP_TCP && QNETHERNET_ENABLE_TCP_SYN_COOKIES
+
+#if LWIP_TCP && QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+
+// Things counted about TCP PCB allocation.
+enum tcp_pcb_event {
+  TCP_PCB_EVENT_EXHAUSTED,  // There were no free PCBs
+  TCP_PCB_EVENT_RECYCLED,   // The oldest TIME_WAIT PCB was freed to make room
+  TCP_PCB_EVENT_REUSED,     // A SYN took over a TIME_WAIT PCB (RFC 6191)
+  TCP_PCB_EVENT_FAILED,     // A PCB couldn't be allocated
+  TCP_PCB_EVENT_COUNT,
+};
+
+// Counts a PCB allocation event.
+void tcp_count_pcb_event(enum tcp_pcb_event event);
+
+// Returns how many times an event happened.
+uint32_t tcp_pcb_event_count(enum tcp_pcb_event event);
+
+// Sets all the event counts to zero.
+void tcp_reset_pcb_event_counts(void);
+
+// Sets and gets the time, in milliseconds, that a connection stays
+// in TIME_WAIT.
+void tcp_set_time_wait_timeout(uint32_t timeout);
+uint32_t tcp_time_wait_timeout(void);
+
+#endif  // LWIP_TCP && QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
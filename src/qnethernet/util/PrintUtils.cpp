@@ -78,7 +78,12 @@ size_t StdioPrint::write(const uint8_t* const buffer, const size_t size) {
 }
 
 int StdioPrint::availableForWrite() {
+#if defined(__NEWLIB__)
   return stream_->_w;
+#else
+  // Other C libraries don't expose the buffer's free space
+  return 0;
+#endif  // defined(__NEWLIB__)
 }
 
 void StdioPrint::flush() {
@@ -7,6 +7,7 @@
 #pragma once
 
 // C++ includes
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -67,13 +68,13 @@ size_t writeMagic(Print& p, const uint8_t mac[ETH_HWADDR_LEN],
 // --------------------------------------------------------------------------
 
 // PrintBase provides a checked printf function.
-class PrintBase : public Print, public internal::PrintfChecked {
+class PrintBase : public Print, public internal::PrintfChecked<PrintBase> {
  public:
   PrintBase() = default;
 
   // Use the one from here instead of the one from Print because it
   // does checking
-  using internal::PrintfChecked::printf;
+  using internal::PrintfChecked<PrintBase>::printf;
 
   using Print::write;  // Add to the overload set
 
@@ -84,13 +85,14 @@ class PrintBase : public Print, public internal::PrintfChecked {
 };
 
 // StreamBase provides a checked printf function.
-class StreamBase : public Stream, public internal::PrintfChecked {
+class StreamBase : public Stream,
+                   public internal::PrintfChecked<StreamBase> {
  public:
   StreamBase() = default;
 
   // Use the one from here instead of the one from Print because it
   // does checking
-  using internal::PrintfChecked::printf;
+  using internal::PrintfChecked<StreamBase>::printf;
 
   using Print::write;  // Add to the overload set
 
@@ -209,6 +211,103 @@ class PrintDecorator : public PrintBase {
   Print& p_;
 };
 
+// BufferedPrint collects writes in a fixed-size buffer and passes them to
+// another Print object only when the buffer is full or on flush(). This turns
+// many small print() and printf() calls into a few large writes. Writes at
+// least as large as the buffer go straight through once it's been emptied.
+//
+// Any buffered data is written when this object is destroyed, but without
+// calling the other object's flush().
+template <size_t N>
+class BufferedPrint final : public PrintBase {
+  static_assert(N > 0, "Buffer size must be > 0");
+
+ public:
+  explicit BufferedPrint(Print& p) : p_(p) {}
+
+  virtual ~BufferedPrint() {
+    (void)writeBuffer();
+  }
+
+  // Rule of five
+  BufferedPrint(const BufferedPrint&) = delete;
+  BufferedPrint(BufferedPrint&&) = delete;
+  BufferedPrint& operator=(const BufferedPrint&) = delete;
+  BufferedPrint& operator=(BufferedPrint&&) = delete;
+
+  using PrintBase::write;  // Bring void* version of write() into scope
+
+  size_t write(const uint8_t b) override {
+    return write(&b, 1);
+  }
+
+  size_t write(const uint8_t* const buffer, const size_t size) override {
+    size_t written = 0;
+    while (written < size) {
+      if (len_ == N) {
+        if (!writeBuffer()) {
+          break;
+        }
+      }
+      const size_t rem = size - written;
+      if ((len_ == 0) && (rem >= N)) {
+        const size_t n = p_.write(&buffer[written], rem);
+        written += n;
+        if (n == 0) {
+          break;
+        }
+        continue;
+      }
+      const size_t n = std::min(rem, N - len_);
+      std::copy_n(&buffer[written], n, &buf_[len_]);
+      len_ += n;
+      written += n;
+    }
+    return written;
+  }
+
+  int availableForWrite() override {
+    return static_cast<int>(
+        std::min(N - len_, size_t{std::numeric_limits<int>::max()}));
+  }
+
+  // Writes all the buffered data and then flushes the other object.
+  void flush() override {
+    (void)writeBuffer();
+    p_.flush();
+  }
+
+  // Returns the number of buffered bytes.
+  size_t buffered() const {
+    return len_;
+  }
+
+ private:
+  // Writes the buffered data until it's all written or nothing more can be
+  // written, keeping anything unwritten. This returns whether any space was
+  // made, and sets the write error if the other object stopped taking data.
+  bool writeBuffer() {
+    size_t pos = 0;
+    while (pos < len_) {
+      const size_t n = p_.write(&buf_[pos], len_ - pos);
+      if (n == 0) {
+        setWriteError();
+        break;
+      }
+      pos += n;
+    }
+    if (pos > 0) {
+      std::copy(&buf_[pos], &buf_[len_], &buf_[0]);
+      len_ -= pos;
+    }
+    return (pos > 0) || (len_ < N);
+  }
+
+  Print& p_;
+  uint8_t buf_[N];
+  size_t len_ = 0;
+};
+
 // StreamDecorator is a Stream object that decorates another. This is meant to
 // be a base class. This also guarantees calls to printf() are checked.
 class StreamDecorator : public StreamBase {
@@ -0,0 +1,412 @@
+// SPDX-FileCopyrightText: (c) 2026 Shawn Silverman <shawn@pobox.com>
+// SPDX-License-Identifier: AGPL-3.0-or-later
+
+// coroutines.h defines C++20 coroutine awaitables for connections and DNS,
+// along with a minimal scheduler that's driven by Ethernet.loop().
+//
+// This is only available when the compiler supports C++20 coroutines, in which
+// case QNETHERNET_HAS_COROUTINES will be defined to 1.
+//
+// This file is part of the QNEthernet library.
+
+#pragma once
+
+#if (__cplusplus >= 202002L) && defined(__cpp_impl_coroutine) && \
+    __has_include(<coroutine>)
+
+#define QNETHERNET_HAS_COROUTINES 1
+
+// C++ includes
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "QNEthernet.h"
+#include "lwip/sys.h"
+#include "qnethernet/QNDNSClient.h"
+#include "qnethernet/util/ip_tools.h"
+
+namespace qindesign {
+namespace network {
+namespace coro {
+
+// Scheduler resumes suspended coroutines once the thing they're waiting for
+// has happened. Call poll() often, for example from loop(), instead of
+// Ethernet.loop().
+class Scheduler final {
+ public:
+  // Calls Ethernet.loop() and then resumes every coroutine whose condition has
+  // been met. Coroutines that start waiting while this is running are checked
+  // during the next call.
+  static void poll() {
+    Ethernet.loop();
+
+    if (waiters().empty()) {
+      return;
+    }
+
+    // Checking a condition can run Ethernet.loop() and any event callbacks,
+    // which can start new coroutines, so check a list that wait() doesn't
+    // touch and then merge in any new waiters
+    std::vector<Waiter> list;
+    list.swap(waiters());
+    std::vector<std::coroutine_handle<>> ready;
+    ready.swap(readyList());
+    for (size_t i = 0; i < list.size();) {
+      if (list[i].isReady()) {
+        ready.push_back(list[i].handle);
+        list[i] = std::move(list.back());
+        list.pop_back();
+      } else {
+        ++i;
+      }
+    }
+    std::vector<Waiter>& added = waiters();
+    list.insert(list.end(), std::make_move_iterator(added.begin()),
+                std::make_move_iterator(added.end()));
+    added.swap(list);
+
+    // Resuming can add more waiters
+    for (size_t i = 0; i < ready.size(); ++i) {
+      ready[i].resume();
+    }
+    ready.clear();
+    readyList().swap(ready);  // Keep the capacity
+  }
+
+  // Returns the number of suspended coroutines.
+  static size_t waiting() {
+    return waiters().size();
+  }
+
+  // Suspends a coroutine until the condition returns true.
+  static void wait(const std::coroutine_handle<> handle,
+                   std::function<bool()> isReady) {
+    waiters().push_back(Waiter{handle, std::move(isReady)});
+  }
+
+ private:
+  struct Waiter final {
+    std::coroutine_handle<> handle;
+    std::function<bool()> isReady;
+  };
+
+  static std::vector<Waiter>& waiters() {
+    static std::vector<Waiter> list;
+    return list;
+  }
+
+  static std::vector<std::coroutine_handle<>>& readyList() {
+    static std::vector<std::coroutine_handle<>> list;
+    return list;
+  }
+};
+
+// Task is the return type of a coroutine that runs on its own. It starts
+// running immediately and frees itself when it's done, so the caller doesn't
+// need to keep anything.
+//
+// For example:
+// coro::Task session(EthernetClient client) {
+//   uint8_t buf[64];
+//   int n;
+//   while ((n = co_await coro::read(client, buf, sizeof(buf))) > 0) {
+//     (void)co_await coro::writeFully(client, buf, n);
+//   }
+//   client.close();
+// }
+struct Task final {
+  struct promise_type final {
+    Task get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+// Job is the return type of a coroutine that produces a value for another
+// coroutine. It doesn't start running until it's awaited, and the awaiting
+// coroutine continues when it's done.
+template <typename T>
+class Job final {
+ public:
+  struct promise_type final {
+    T value{};
+    std::coroutine_handle<> continuation;
+
+    Job get_return_object() noexcept {
+      return Job{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    auto final_suspend() noexcept {
+      struct FinalAwaiter final {
+        bool await_ready() noexcept { return false; }
+        std::coroutine_handle<> await_suspend(
+            const std::coroutine_handle<promise_type> handle) noexcept {
+          return handle.promise().continuation;
+        }
+        void await_resume() noexcept {}
+      };
+      return FinalAwaiter{};
+    }
+    void return_value(T v) { value = std::move(v); }
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+
+  Job(Job&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Job(const Job&) = delete;
+  Job& operator=(const Job&) = delete;
+  Job& operator=(Job&&) = delete;
+
+  ~Job() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  std::coroutine_handle<> await_suspend(
+      const std::coroutine_handle<> continuation) noexcept {
+    handle_.promise().continuation = continuation;
+    return handle_;
+  }
+
+  T await_resume() {
+    return std::move(handle_.promise().value);
+  }
+
+ private:
+  explicit Job(const std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// Waits until a condition is true. The condition is checked once before
+// suspending and then every Scheduler::poll().
+template <typename F>
+class Until {
+ public:
+  explicit Until(F isReady) : isReady_(std::move(isReady)) {}
+
+  bool await_ready() {
+    return isReady_();
+  }
+
+  void await_suspend(const std::coroutine_handle<> handle) {
+    // This object lives in the coroutine frame while it's suspended
+    Scheduler::wait(handle, [this]() { return isReady_(); });
+  }
+
+  void await_resume() const {}
+
+ private:
+  F isReady_;
+};
+
+// Waits for the given number of milliseconds.
+inline auto delay(const uint32_t ms) {
+  const uint32_t start = sys_now();
+  return Until{[start, ms]() { return (sys_now() - start) >= ms; }};
+}
+
+// Connects the client without blocking. The result is whether the connection
+// was established. The client's connection timeout is used if it's enabled.
+//
+// If the result is false and there was an error then errno will be set. It
+// will be set to ETIMEDOUT if the connection attempt timed out.
+class Connect final {
+ public:
+  Connect(EthernetClient& client, const IPAddress& ip, const uint16_t port)
+      : client_(client), ip_(ip), port_(port) {}
+
+  bool await_ready() {
+    if (!client_.connectNoWait(ip_, port_)) {
+      return true;
+    }
+    start_ = sys_now();
+    return isDone();
+  }
+
+  void await_suspend(const std::coroutine_handle<> handle) {
+    Scheduler::wait(handle, [this]() { return isDone(); });
+  }
+
+  bool await_resume() {
+    if (client_.connecting()) {
+      client_.close();
+      errno = ETIMEDOUT;
+      return false;
+    }
+    return static_cast<bool>(client_);
+  }
+
+ private:
+  bool isDone() {
+    if (!client_.connecting()) {
+      return true;
+    }
+    return client_.isConnectionTimeoutEnabled() &&
+           ((sys_now() - start_) >= client_.connectionTimeout());
+  }
+
+  EthernetClient& client_;
+  IPAddress ip_;
+  uint16_t port_;
+  uint32_t start_ = 0;
+};
+
+inline Connect connect(EthernetClient& client, const IPAddress& ip,
+                       const uint16_t port) {
+  return Connect{client, ip, port};
+}
+
+// Reads up to 'size' bytes once there's data. The result is the number of
+// bytes read, or zero if the connection closed without any more data.
+class Read final {
+ public:
+  Read(EthernetClient& client, void* const buf, const size_t size)
+      : client_(client), buf_(static_cast<uint8_t*>(buf)), size_(size) {}
+
+  bool await_ready() {
+    return isDone();
+  }
+
+  void await_suspend(const std::coroutine_handle<> handle) {
+    Scheduler::wait(handle, [this]() { return isDone(); });
+  }
+
+  size_t await_resume() {
+    const int n = client_.read(buf_, size_);
+    return (n > 0) ? static_cast<size_t>(n) : 0;
+  }
+
+ private:
+  bool isDone() {
+    return (size_ == 0) || (client_.available() > 0) || !client_.connected();
+  }
+
+  EthernetClient& client_;
+  uint8_t* buf_;
+  size_t size_;
+};
+
+inline Read read(EthernetClient& client, void* const buf, const size_t size) {
+  return Read{client, buf, size};
+}
+
+// Writes all the data, sending whatever fits each time the stack makes room.
+// The result is the number of bytes written, which will be less than 'size'
+// only if the connection closed.
+//
+// The writing happens here, in the coroutine, and not in the condition, so
+// that nothing is sent while the scheduler is checking conditions.
+inline Job<size_t> writeFully(EthernetClient& client, const void* const buf,
+                              const size_t size) {
+  const auto b = static_cast<const uint8_t*>(buf);
+  size_t written = 0;
+  while (true) {
+    if (written < size) {
+      written += client.write(b + written, size - written);
+      client.flush();
+    }
+    if ((written >= size) || !client.connected()) {
+      co_return written;
+    }
+    co_await Until{[&client]() {
+      return !client.connected() || (client.availableForWrite() > 0);
+    }};
+  }
+}
+
+#if LWIP_DNS && LWIP_IPV4
+
+// Looks up a host by name. The result is whether the address was found, and
+// if so, 'ip' is filled in.
+//
+// If the result is false and there was an error then errno will be set. It
+// will be set to ETIMEDOUT if the lookup timed out.
+class Resolve final {
+ public:
+  Resolve(const char* const hostname, IPAddress& ip, const uint32_t timeout)
+      : hostname_(hostname), ip_(ip), timeout_(timeout) {}
+
+  bool await_ready() {
+    // The callback might outlive this object if the lookup times out here first
+    result_ = std::make_shared<Result>();
+    const std::shared_ptr<Result> result = result_;
+    const bool started = DNSClient::getHostByName(
+        hostname_,
+        [result](const ip_addr_t* const ipaddr) {
+          result->done = true;
+          if (ipaddr != nullptr) {
+            result->found = true;
+            result->ip = util::ip_addr_get_ip4_uint32(ipaddr);
+          }
+        },
+        timeout_);
+    if (!started) {
+      result_->done = true;
+      return true;
+    }
+    start_ = sys_now();
+    return isDone();
+  }
+
+  void await_suspend(const std::coroutine_handle<> handle) {
+    Scheduler::wait(handle, [this]() { return isDone(); });
+  }
+
+  bool await_resume() {
+    if (!result_->done) {
+      errno = ETIMEDOUT;
+      return false;
+    }
+    if (result_->found) {
+      ip_ = result_->ip;
+    }
+    return result_->found;
+  }
+
+ private:
+  struct Result final {
+    bool done = false;
+    bool found = false;
+    uint32_t ip = 0;
+  };
+
+  bool isDone() const {
+    return result_->done || ((sys_now() - start_) >= timeout_);
+  }
+
+  const char* hostname_;
+  IPAddress& ip_;
+  uint32_t timeout_;
+  uint32_t start_ = 0;
+  std::shared_ptr<Result> result_;
+};
+
+inline Resolve resolve(
+    const char* const hostname, IPAddress& ip,
+    const uint32_t timeout = QNETHERNET_DEFAULT_DNS_LOOKUP_TIMEOUT) {
+  return Resolve{hostname, ip, timeout};
+}
+
+#endif  // LWIP_DNS && LWIP_IPV4
+
+}  // namespace coro
+}  // namespace network
+}  // namespace qindesign
+
+#endif  // C++20 coroutines
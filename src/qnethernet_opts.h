@@ -36,6 +36,20 @@
 #define QNETHERNET_DEFAULT_DNS_LOOKUP_TIMEOUT (((DNS_MAX_RETRIES) + 1)*(DNS_TMR_INTERVAL))
 #endif
 
+// The default time, in milliseconds, that a corked TCP connection holds onto
+// data that doesn't fill a segment. See EthernetClient::setCork().
+#ifndef QNETHERNET_DEFAULT_TCP_CORK_TIMEOUT
+#define QNETHERNET_DEFAULT_TCP_CORK_TIMEOUT 200
+#endif
+
+// The default time, in milliseconds, that a closed TCP connection stays in the
+// TIME_WAIT state. This can be changed at runtime with
+// EthernetClient::setTimeWaitTimeout(). It's only used if
+// QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY is enabled.
+#ifndef QNETHERNET_DEFAULT_TCP_TIME_WAIT_TIMEOUT
+#define QNETHERNET_DEFAULT_TCP_TIME_WAIT_TIMEOUT (2*(TCP_MSL))
+#endif
+
 // The default MAC address if one isn't specified, or if a default one is needed.
 // Local, non-multicast: Lower two bits of the top byte must be 0b10.
 //
@@ -75,6 +89,10 @@
 #define QNETHERNET_DO_LOOP_IN_YIELD 1
 #endif
 
+// Builds with the host-native simulated driver. This is selected automatically
+// when building for Linux without an Arduino core.
+// #define QNETHERNET_DRIVER_HOST
+
 // Builds with the W5500 driver.
 // #define QNETHERNET_DRIVER_W5500
 
@@ -123,6 +141,42 @@
 #define QNETHERNET_ENABLE_SECURE_TCP_ISN 1
 #endif
 
+// Enables the cumulative per-connection TCP counters returned by
+// EthernetClient::tcpInfo(). They're kept by lwIP TCP hooks.
+#ifndef QNETHERNET_ENABLE_TCP_COUNTERS
+#define QNETHERNET_ENABLE_TCP_COUNTERS 1
+#endif
+
+// Enables SYN cookies. When a listener's backlog of half-open connections is
+// full, or there are no free PCBs, SYNs are answered without keeping any state
+// and the connection is created when a valid ACK comes back. This also limits
+// each listener's backlog, so it's disabled by default.
+#ifndef QNETHERNET_ENABLE_TCP_SYN_COOKIES
+#define QNETHERNET_ENABLE_TCP_SYN_COOKIES 0
+#endif
+
+// Enables the TIME_WAIT policy for connection churn: a settable TIME_WAIT
+// duration, letting a new SYN take over a matching TIME_WAIT connection
+// (RFC 6191), and counters for when TCP PCBs run out.
+#ifndef QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+#define QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY 1
+#endif
+
+// Enables zero-copy receive in drivers that support it. Received DMA buffers
+// are passed up the stack directly and replaced with spare buffers, instead of
+// being copied. This uses more buffer memory.
+#ifndef QNETHERNET_ENABLE_ZERO_COPY_RX
+#define QNETHERNET_ENABLE_ZERO_COPY_RX 0
+#endif
+
+// Enables zero-copy, non-blocking transmit in drivers that support it. Each
+// pbuf segment is given to the hardware directly and held until it's been
+// sent, instead of being copied. Output returns ERR_WOULDBLOCK instead of
+// waiting when there's no room.
+#ifndef QNETHERNET_ENABLE_ZERO_COPY_TX
+#define QNETHERNET_ENABLE_ZERO_COPY_TX 0
+#endif
+
 // Follows every call to 'EthernetClient::write()` with a flush. This may reduce
 // TCP efficency. This option is for use with hard-to-modify code or libraries
 // that assume data will get sent immediately. The preferred approach is to call
@@ -161,6 +215,30 @@
 #define QNETHERNET_PROVIDE_TEENSY_SETTIMEOFDAY 1
 #endif
 
+// The total of all the TCP connections' receive windows, in bytes, beyond which
+// no window grows. The default leaves room for two full windows when every
+// connection is in use. This can be changed at runtime with
+// EthernetClient::setReceiveWindowBudget().
+#ifndef QNETHERNET_TCP_WND_BUDGET
+#define QNETHERNET_TCP_WND_BUDGET \
+  ((MEMP_NUM_TCP_PCB) * (QNETHERNET_TCP_WND_INITIAL) + 2 * (TCP_WND))
+#endif
+
+// The time, in milliseconds, without received data after which a TCP
+// connection's receive window goes back to its initial size.
+#ifndef QNETHERNET_TCP_WND_IDLE_TIMEOUT
+#define QNETHERNET_TCP_WND_IDLE_TIMEOUT 1000
+#endif
+
+// The receive window, in bytes, that each TCP connection starts with. The
+// window grows, up to TCP_WND, as the remote side fills it. The default is
+// lwIP's usual TCP_WND, 4*TCP_MSS, so that no window starts smaller than a
+// fixed one would be, or TCP_WND itself if that's smaller.
+#ifndef QNETHERNET_TCP_WND_INITIAL
+#define QNETHERNET_TCP_WND_INITIAL \
+  (((TCP_WND) < 4 * (TCP_MSS)) ? (TCP_WND) : 4 * (TCP_MSS))
+#endif
+
 // Use the Entropy library instead of internal functions. (Teensy 4)
 #ifndef QNETHERNET_USE_ENTROPY_LIB
 #define QNETHERNET_USE_ENTROPY_LIB 0
@@ -16,10 +16,18 @@
 #include <QNEthernet.h>
 #include <lwip/debug.h>
 #include <lwip/dns.h>
+#include <lwip/inet_chksum.h>
+#include <lwip/ip4.h>
+#include <lwip/memp.h>
 #include <lwip/opt.h>
+#include <lwip/pbuf.h>
+#include <lwip/priv/tcp_priv.h>
+#include <lwip/udp.h>
 #include <qnethernet/QNDNSClient.h>
 #include <qnethernet/compat/c++11_compat.h>
+#include <qnethernet/drivers/driver_host_wire.h>
 #include <qnethernet/lwip_driver.h>
+#include <qnethernet/util/coroutines.h>
 #include <qnethernet_opts.h>
 #include <unity.h>
 
@@ -75,6 +83,16 @@ std::unique_ptr<EthernetUDP> udp;
 std::unique_ptr<EthernetClient> client;
 std::unique_ptr<EthernetServer> server;
 
+#if defined(QNETHERNET_INTERNAL_DRIVER_HOST)
+// Extra netif attached to the host driver's virtual wire.
+static struct netif s_peerNetif;
+
+// The virtual wire has no DHCP server, so tests that need one are ignored.
+#define IGNORE_IF_NO_DHCP() TEST_IGNORE_MESSAGE("No DHCP server on the wire")
+#else
+#define IGNORE_IF_NO_DHCP()
+#endif  // QNETHERNET_INTERNAL_DRIVER_HOST
+
 // Pre-test setup. This is run before every test.
 void setUp() {
 }
@@ -90,8 +108,17 @@ void tearDown() {
   server = nullptr;
 #if QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
   EthernetFrame.clear();
+  EthernetFrame.setReceiveQueueByteCapacity(0);
+  EthernetFrame.setMaxReceiveSize(0);
 #endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
 
+#if defined(QNETHERNET_INTERNAL_DRIVER_HOST)
+  // Restore the virtual wire
+  host::detach_netif(&s_peerNetif);
+  host::set_wire_config(host::WireConfig{});
+  host::flush_wire();
+#endif  // QNETHERNET_INTERNAL_DRIVER_HOST
+
   // Clean up mDNS
   MDNS.end();
 
@@ -104,6 +131,9 @@ void tearDown() {
   // Stop Ethernet and other services
   Ethernet.end();
   TEST_ASSERT_FALSE_MESSAGE(static_cast<bool>(Ethernet), "Expected stopped");
+#if LWIP_TCP
+  (void)EthernetClient::setReceivePool(0, 0);
+#endif  // LWIP_TCP
 
   // Restore the MAC address
   uint8_t mac[6];
@@ -237,6 +267,8 @@ static void test_get_mac() {
 
 // Obtains an IP address via DHCP and returns whether successful.
 static bool waitForLocalIP() {
+  IGNORE_IF_NO_DHCP();
+
   TEST_ASSERT_FALSE_MESSAGE(static_cast<bool>(Ethernet), "Expected not started");
   TEST_ASSERT_FALSE_MESSAGE(Ethernet.isDHCPActive(), "Expected DHCP inactive");
   TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(), "Expected start with DHCP okay");
@@ -271,6 +303,8 @@ static bool waitForLocalIP() {
 
 // Tests NULL MAC address passed to the begin(...) functions.
 static void test_other_null_mac() {
+  IGNORE_IF_NO_DHCP();
+
   TEST_MESSAGE(format("Starting Ethernet with DHCP timeout of %d ms...",
                       QNETHERNET_DEFAULT_DHCP_CLIENT_TIMEOUT)
                    .data());
@@ -331,6 +365,8 @@ static void test_dhcp() {
 
 // Tests double DHCP: begin() twice.
 static void test_double_dhcp() {
+  IGNORE_IF_NO_DHCP();
+
   TEST_ASSERT_EQUAL_MESSAGE(INADDR_NONE, Ethernet.localIP(), "Expected invalid IP");
 
   TEST_MESSAGE("Begin (1)...");
@@ -976,6 +1012,408 @@ static void test_udp_receive_queueing() {
   udp->stop();
 }
 
+// Tests UDP zero-copy receive.
+static void test_udp_zero_copy_receive() {
+  constexpr uint16_t kPort = 1025;
+  constexpr size_t kSize = 200;
+  constexpr int kCount = 300;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // send() won't work unless there's a link
+
+  udp = compat::make_unique<EthernetUDP>();
+  TEST_ASSERT_FALSE_MESSAGE(udp->isZeroCopyReceive(),
+                            "Expected zero-copy receive off by default");
+  udp->setZeroCopyReceive(true);
+  TEST_ASSERT_TRUE_MESSAGE(udp->isZeroCopyReceive(),
+                           "Expected zero-copy receive on");
+  TEST_ASSERT_TRUE_MESSAGE(udp->begin(kPort), "Expected UDP listen success");
+
+  uint8_t buf[kSize];
+
+  // The oldest packet is still dropped
+  for (uint8_t i = 1; i <= 2; ++i) {
+    std::fill_n(buf, kSize, i);
+    TEST_ASSERT_TRUE_MESSAGE(udp->send(Ethernet.localIP(), kPort, buf, kSize),
+                             "Expected packet send success");
+    Ethernet.loop();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(1, udp->droppedReceiveCount(), "Expected dropped 1");
+  TEST_ASSERT_EQUAL_MESSAGE(2, udp->totalReceiveCount(), "Expected total 2");
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, udp->parsePacket(), "Expected packet");
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, udp->size(), "Expected size");
+  TEST_ASSERT_EQUAL_MESSAGE(2, udp->data()[kSize - 1], "Expected packet 2 data");
+  TEST_ASSERT_EQUAL_MESSAGE(2, udp->peek(), "Expected peek");
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, udp->read(buf, kSize), "Expected read");
+  TEST_ASSERT_EQUAL_MESSAGE(2, buf[0], "Expected read data");
+  TEST_ASSERT_EQUAL_MESSAGE(0, udp->available(), "Expected nothing available");
+
+  // Overwrite and parse many held buffers
+  udp->setReceiveQueueCapacity(2);
+  for (int i = 0; i < kCount; ++i) {
+    buf[0] = static_cast<uint8_t>(i);
+    TEST_ASSERT_TRUE_MESSAGE(udp->send(Ethernet.localIP(), kPort, buf, kSize),
+                             "Expected packet send success");
+    Ethernet.loop();
+    if ((i % 4) != 3) {
+      continue;  // Let the queue overflow sometimes
+    }
+    int last = -1;
+    while (udp->parsePacket() == static_cast<int>(kSize)) {
+      last = udp->read();
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<uint8_t>(i), last,
+                              "Expected latest packet");
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(kCount + 2, udp->totalReceiveCount(),
+                            "Expected all received");
+
+  udp->stop();
+}
+
+#if LWIP_SUPPORT_CUSTOM_PBUF
+// Counts the frees of the custom pbufs in test_udp_stop_releases_pbufs().
+static int s_freedCustomPbufs = 0;
+#endif  // LWIP_SUPPORT_CUSTOM_PBUF
+
+// Tests that stopping a UDP socket releases the pbufs held by zero-copy
+// receive, both the queued ones and the current packet, and keeps their
+// data readable.
+static void test_udp_stop_releases_pbufs() {
+#if LWIP_SUPPORT_CUSTOM_PBUF
+  constexpr uint16_t kPort = 1025;
+  constexpr int kCapacity = 3;
+  constexpr int kCount = kCapacity + 1;
+  constexpr uint16_t kSize = 10;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+
+  udp = compat::make_unique<EthernetUDP>(kCapacity);
+  udp->setZeroCopyReceive(true);
+  TEST_ASSERT_TRUE_MESSAGE(udp->begin(kPort), "Expected UDP listen success");
+
+  struct udp_pcb* pcb = udp_pcbs;
+  while ((pcb != nullptr) && (pcb->local_port != kPort)) {
+    pcb = pcb->next;
+  }
+  TEST_ASSERT_NOT_NULL_MESSAGE(pcb, "Expected UDP PCB");
+
+  // Deliver custom pbufs so that their frees can be counted
+  static uint8_t data[kCount][kSize];
+  static struct pbuf_custom pbufs[kCount];
+  s_freedCustomPbufs = 0;
+  for (int i = 0; i < kCount; ++i) {
+    std::fill_n(data[i], kSize, static_cast<uint8_t>(i + 1));
+    pbufs[i].custom_free_function = [](struct pbuf* const p) {
+      (void)p;
+      ++s_freedCustomPbufs;
+    };
+    struct pbuf* const p = pbuf_alloced_custom(PBUF_RAW, kSize, PBUF_REF,
+                                               &pbufs[i], data[i], kSize);
+    TEST_ASSERT_NOT_NULL_MESSAGE(p, "Expected custom pbuf");
+    pcb->recv(pcb->recv_arg, pcb, p, IP_ADDR_ANY, kPort);
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(1, s_freedCustomPbufs,
+                            "Expected the dropped packet freed");
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, udp->parsePacket(), "Expected packet");
+  TEST_ASSERT_EQUAL_MESSAGE(kCapacity - 1, udp->receiveQueueSize(),
+                            "Expected queued packets");
+  TEST_ASSERT_EQUAL_MESSAGE(1, s_freedCustomPbufs, "Expected no more frees");
+
+  udp->stop();
+  TEST_ASSERT_EQUAL_MESSAGE(kCount, s_freedCustomPbufs,
+                            "Expected all pbufs freed by stop()");
+
+  // The packets are still readable, from copies
+  std::memset(data, 0, sizeof(data));
+  TEST_ASSERT_EQUAL_MESSAGE(kCapacity - 1, udp->receiveQueueSize(),
+                            "Expected queued packets after stop()");
+  TEST_ASSERT_EQUAL_MESSAGE((kCapacity - 1) * kSize, udp->receiveQueueBytes(),
+                            "Expected queued bytes after stop()");
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, udp->size(), "Expected current packet");
+  uint8_t buf[kSize];
+  uint8_t expected[kSize];
+  std::fill_n(expected, kSize, uint8_t{2});
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, udp->read(buf, kSize), "Expected read");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(expected, buf, kSize,
+                                        "Expected current packet data");
+#endif  // LWIP_SUPPORT_CUSTOM_PBUF
+}
+
+// Tests UDP batch receive.
+static void test_udp_receive_batch() {
+  constexpr uint16_t kPort = 1025;
+  constexpr size_t kBufSize = 4;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // send() won't work unless there's a link
+
+  udp = compat::make_unique<EthernetUDP>(4);
+  TEST_ASSERT_TRUE_MESSAGE(udp->begin(kPort), "Expected UDP listen success");
+
+  // Send 5 packets of sizes 1-5 so that the first is dropped
+  const uint8_t data[5]{1, 2, 3, 4, 5};
+  for (size_t i = 1; i <= 5; ++i) {
+    TEST_ASSERT_TRUE_MESSAGE(udp->send(Ethernet.localIP(), kPort, data, i),
+                             "Expected packet send success");
+    Ethernet.loop();
+  }
+
+  uint8_t bufs[3][kBufSize];
+  EthernetUDP::Message msgs[3];
+  for (size_t i = 0; i < 3; ++i) {
+    msgs[i].buf = bufs[i];
+    msgs[i].bufSize = kBufSize;
+  }
+  EthernetUDP::BatchInfo info;
+
+  TEST_ASSERT_EQUAL_MESSAGE(3, udp->receiveBatch(msgs, 3, &info),
+                            "Expected 3 packets");
+  TEST_ASSERT_EQUAL_MESSAGE(0, info.truncatedCount, "Expected none truncated");
+  TEST_ASSERT_EQUAL_MESSAGE(1, info.droppedCount, "Expected 1 dropped");
+  for (size_t i = 0; i < 3; ++i) {
+    TEST_ASSERT_EQUAL_MESSAGE(i + 2, msgs[i].size, "Expected packet size");
+    TEST_ASSERT_EQUAL_MESSAGE(i + 2, msgs[i].len, "Expected copied size");
+    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(data, bufs[i], msgs[i].len,
+                                          "Expected matching data");
+    TEST_ASSERT_TRUE_MESSAGE(msgs[i].remoteIP == Ethernet.localIP(),
+                             "Expected matching remote IP");
+    TEST_ASSERT_EQUAL_MESSAGE(kPort, msgs[i].remotePort,
+                              "Expected matching remote port");
+  }
+
+  TEST_ASSERT_EQUAL_MESSAGE(1, udp->receiveBatch(msgs, 3, &info),
+                            "Expected 1 packet");
+  TEST_ASSERT_EQUAL_MESSAGE(5, msgs[0].size, "Expected packet size 5");
+  TEST_ASSERT_EQUAL_MESSAGE(kBufSize, msgs[0].len, "Expected truncation");
+  TEST_ASSERT_EQUAL_MESSAGE(1, info.truncatedCount, "Expected 1 truncated");
+  TEST_ASSERT_EQUAL_MESSAGE(0, info.droppedCount, "Expected none dropped");
+
+  TEST_ASSERT_EQUAL_MESSAGE(0, udp->receiveBatch(msgs, 3, nullptr),
+                            "Expected no packets");
+
+  udp->stop();
+}
+
+// Tests UDP zero-copy send.
+static void test_udp_zero_copy_send() {
+  constexpr uint16_t kPort = 1025;
+  constexpr uint8_t data[]{1, 2, 3, 4, 5};
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // send() won't work unless there's a link
+
+  udp = compat::make_unique<EthernetUDP>();
+  TEST_ASSERT_FALSE_MESSAGE(udp->isZeroCopySend(),
+                            "Expected zero-copy send off by default");
+  udp->setZeroCopySend(true);
+  TEST_ASSERT_TRUE_MESSAGE(udp->isZeroCopySend(), "Expected zero-copy send on");
+  TEST_ASSERT_TRUE_MESSAGE(udp->begin(kPort), "Expected UDP listen success");
+
+  TEST_ASSERT_TRUE_MESSAGE(udp->beginPacket(Ethernet.localIP(), kPort),
+                           "Expected begin packet success");
+  const int avail = udp->availableForWrite();
+  TEST_ASSERT_EQUAL_MESSAGE(EthernetClass::mtu() - 28, avail,
+                            "Expected unfragmented payload size available");
+  TEST_ASSERT_EQUAL_MESSAGE(1, udp->write(data[0]), "Expected write 1 byte");
+  TEST_ASSERT_EQUAL_MESSAGE(sizeof(data) - 1,
+                            udp->write(&data[1], sizeof(data) - 1),
+                            "Expected write the rest");
+  TEST_ASSERT_EQUAL_MESSAGE(avail - static_cast<int>(sizeof(data)),
+                            udp->availableForWrite(),
+                            "Expected less available");
+  TEST_ASSERT_TRUE_MESSAGE(udp->endPacket(), "Expected end packet success");
+  TEST_ASSERT_EQUAL_MESSAGE(0, udp->availableForWrite(),
+                            "Expected nothing available after end");
+
+  Ethernet.loop();
+  TEST_ASSERT_EQUAL_MESSAGE(sizeof(data), udp->parsePacket(),
+                            "Expected packet");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(data, udp->data(), sizeof(data),
+                                        "Expected matching data");
+
+  udp->stop();
+}
+
+// Tests UDP batch send.
+static void test_udp_send_batch() {
+  constexpr uint16_t kPort = 1025;
+  constexpr size_t kCount = 6;
+  const IPAddress other{192, 168, 0, 3};
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // send() won't work unless there's a link
+
+  udp = compat::make_unique<EthernetUDP>(kCount);
+  TEST_ASSERT_TRUE_MESSAGE(udp->begin(kPort), "Expected UDP listen success");
+
+  // Alternate between runs to this host and to another one
+  uint8_t data[kCount];
+  EthernetUDP::Datagram datagrams[kCount];
+  for (size_t i = 0; i < kCount; ++i) {
+    data[i] = static_cast<uint8_t>(i);
+    datagrams[i].ip = ((i % 4) < 2) ? Ethernet.localIP() : other;
+    datagrams[i].port = kPort;
+    datagrams[i].data = &data[i];
+    datagrams[i].len = 1;
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(kCount, udp->sendBatch(datagrams, kCount),
+                            "Expected all sent");
+  Ethernet.loop();
+
+  // Only the local ones come back
+  EthernetUDP::Message msgs[kCount];
+  uint8_t bufs[kCount];
+  for (size_t i = 0; i < kCount; ++i) {
+    msgs[i].buf = &bufs[i];
+    msgs[i].bufSize = 1;
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(4, udp->receiveBatch(msgs, kCount, nullptr),
+                            "Expected the local packets");
+  const uint8_t expected[4]{0, 1, 4, 5};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(expected, bufs, 4,
+                                        "Expected packets in order");
+
+  // Too-large packets stop the batch
+  datagrams[1].len = 65536;
+  errno = 0;
+  TEST_ASSERT_EQUAL_MESSAGE(1, udp->sendBatch(datagrams, kCount),
+                            "Expected only the first sent");
+  TEST_ASSERT_EQUAL_MESSAGE(ENOBUFS, errno, "Expected ENOBUFS");
+
+  udp->stop();
+}
+
+// Tests the UDP receive callback.
+static void test_udp_receive_callback() {
+  constexpr uint16_t kPort = 1025;
+  constexpr uint8_t data[]{1, 2, 3};
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // send() won't work unless there's a link
+
+  udp = compat::make_unique<EthernetUDP>();
+  TEST_ASSERT_TRUE_MESSAGE(udp->begin(kPort), "Expected UDP listen success");
+
+  int count = 0;
+  std::vector<uint8_t> received;
+  IPAddress remoteIP;
+  uint16_t remotePort = 0;
+  udp->onReceive([&](const EthernetUDP::PacketView& packet) {
+    ++count;
+    received.assign(packet.data, packet.data + packet.size);
+    remoteIP = packet.remoteIP;
+    remotePort = packet.remotePort;
+  });
+
+  TEST_ASSERT_TRUE_MESSAGE(
+      udp->send(Ethernet.localIP(), kPort, data, sizeof(data)),
+      "Expected packet send success");
+  Ethernet.loop();
+  TEST_ASSERT_EQUAL_MESSAGE(1, count, "Expected callback called once");
+  TEST_ASSERT_EQUAL_MESSAGE(sizeof(data), received.size(), "Expected size");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(data, received.data(), sizeof(data),
+                                        "Expected matching data");
+  TEST_ASSERT_TRUE_MESSAGE(remoteIP == Ethernet.localIP(),
+                           "Expected matching remote IP");
+  TEST_ASSERT_EQUAL_MESSAGE(kPort, remotePort, "Expected matching remote port");
+  TEST_ASSERT_EQUAL_MESSAGE(0, udp->receiveQueueSize(), "Expected nothing queued");
+  TEST_ASSERT_EQUAL_MESSAGE(1, udp->totalReceiveCount(), "Expected total 1");
+  TEST_ASSERT_LESS_THAN_MESSAGE(0, udp->parsePacket(), "Expected no packet");
+
+  // Clearing the callback goes back to queuing
+  udp->onReceive(nullptr);
+  TEST_ASSERT_TRUE_MESSAGE(
+      udp->send(Ethernet.localIP(), kPort, data, sizeof(data)),
+      "Expected packet send success");
+  Ethernet.loop();
+  TEST_ASSERT_EQUAL_MESSAGE(1, count, "Expected no more callbacks");
+  TEST_ASSERT_EQUAL_MESSAGE(sizeof(data), udp->parsePacket(),
+                            "Expected queued packet");
+
+  udp->stop();
+}
+
+// Tests the UDP receive queue byte capacity and maximum receive size.
+static void test_udp_receive_byte_capacity() {
+  constexpr uint16_t kPort = 1025;
+  uint8_t data[100];
+  for (size_t i = 0; i < sizeof(data); ++i) {
+    data[i] = static_cast<uint8_t>(i);
+  }
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // send() won't work unless there's a link
+
+  udp = compat::make_unique<EthernetUDP>(10);
+  TEST_ASSERT_EQUAL_MESSAGE(0, udp->receiveQueueByteCapacity(),
+                            "Expected no byte limit by default");
+  TEST_ASSERT_EQUAL_MESSAGE(0, udp->maxReceiveSize(),
+                            "Expected no maximum by default");
+  udp->setReceiveQueueByteCapacity(100);
+  TEST_ASSERT_EQUAL_MESSAGE(100, udp->receiveQueueByteCapacity(),
+                            "Expected byte capacity 100");
+  TEST_ASSERT_TRUE_MESSAGE(udp->begin(kPort), "Expected UDP listen success");
+
+  // Three 40-byte packets don't fit into 100 bytes
+  for (int i = 0; i < 3; ++i) {
+    TEST_ASSERT_TRUE_MESSAGE(udp->send(Ethernet.localIP(), kPort, data, 40),
+                             "Expected packet send success");
+    Ethernet.loop();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(2, udp->receiveQueueSize(), "Expected queue size 2");
+  TEST_ASSERT_EQUAL_MESSAGE(80, udp->receiveQueueBytes(), "Expected 80 bytes");
+  TEST_ASSERT_EQUAL_MESSAGE(1, udp->droppedReceiveCount(), "Expected dropped 1");
+  TEST_ASSERT_EQUAL_MESSAGE(3, udp->totalReceiveCount(), "Expected total 3");
+
+  // A packet larger than the byte capacity is dropped
+  TEST_ASSERT_TRUE_MESSAGE(udp->send(Ethernet.localIP(), kPort, data, 0),
+                           "Expected packet send success");
+  Ethernet.loop();
+  uint8_t big[101]{0};
+  TEST_ASSERT_TRUE_MESSAGE(
+      udp->send(Ethernet.localIP(), kPort, big, sizeof(big)),
+      "Expected packet send success");
+  Ethernet.loop();
+  TEST_ASSERT_EQUAL_MESSAGE(3, udp->receiveQueueSize(), "Expected queue size 3");
+  TEST_ASSERT_EQUAL_MESSAGE(2, udp->droppedReceiveCount(), "Expected dropped 2");
+
+  // Draining the queue frees the bytes
+  TEST_ASSERT_EQUAL_MESSAGE(40, udp->parsePacket(), "Expected 40-byte packet");
+  TEST_ASSERT_EQUAL_MESSAGE(40, udp->receiveQueueBytes(), "Expected 40 bytes");
+
+  // Shrinking the byte capacity drops and counts the oldest packets
+  udp->setReceiveQueueByteCapacity(10);
+  TEST_ASSERT_EQUAL_MESSAGE(1, udp->receiveQueueSize(), "Expected queue size 1");
+  TEST_ASSERT_EQUAL_MESSAGE(0, udp->receiveQueueBytes(), "Expected 0 bytes");
+  TEST_ASSERT_EQUAL_MESSAGE(3, udp->droppedReceiveCount(), "Expected dropped 3");
+  udp->setReceiveQueueByteCapacity(0);
+
+  // Larger packets are truncated
+  udp->setMaxReceiveSize(10);
+  TEST_ASSERT_TRUE_MESSAGE(udp->send(Ethernet.localIP(), kPort, data, 40),
+                           "Expected packet send success");
+  Ethernet.loop();
+  TEST_ASSERT_EQUAL_MESSAGE(1, udp->truncatedReceiveCount(),
+                            "Expected truncated 1");
+  while (udp->receiveQueueSize() > 1) {
+    (void)udp->parsePacket();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(10, udp->parsePacket(), "Expected truncated size");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(data, udp->data(), 10,
+                                        "Expected matching data");
+  TEST_ASSERT_EQUAL_MESSAGE(0, udp->receiveQueueBytes(), "Expected 0 bytes");
+
+  udp->stop();
+}
+
 // Tests the UDP receive timestamp.
 static void test_udp_receive_timestamp() {
   constexpr uint16_t kPort = 1025;
@@ -1588,93 +2026,1609 @@ static void test_server_accept() {
   server->end();
 }
 
-// Tests state from some of the other classes.
-static void test_other_state() {
-  TEST_ASSERT_EQUAL_MESSAGE(DNS_MAX_SERVERS, DNSClient::maxServers(), "Expected default DNS max. servers");
-  TEST_ASSERT_EQUAL_MESSAGE(MEMP_NUM_IGMP_GROUP > 0 ? MEMP_NUM_IGMP_GROUP - 1 : 0,
-                            Ethernet.maxMulticastGroups(),
-                            "Expected default max. multicast groups");
-  TEST_ASSERT_EQUAL_MESSAGE(enet::get_mtu(), Ethernet.mtu(), "Expected default MTU");
-#if QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
-  TEST_ASSERT_EQUAL_MESSAGE(enet::get_max_frame_len(), EthernetFrame.maxFrameLen(),
-                            "Expected default max. frame len");
-  TEST_ASSERT_EQUAL_MESSAGE(60, EthernetFrame.minFrameLen(), "Expected default min. frame len");
-#endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
-  TEST_ASSERT_EQUAL_MESSAGE(MDNS_MAX_SERVICES, MDNS.maxServices(), "Expected default mDNS max. services");
-}
+// Tests that the server accepts in order and serves available data
+// round-robin.
+static void test_server_available_round_robin() {
+  constexpr uint16_t kPort = 1025;
+  constexpr int kCount = 3;
 
-// Tests EthernetFrame.
-static void test_raw_frames() {
-#if QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
-  constexpr uint8_t srcMAC[6]{QNETHERNET_DEFAULT_MAC_ADDRESS};
-  constexpr uint8_t data[10]{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
 
-  (void)Ethernet.setDHCPEnabled(false);
-  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(), "Expected Ethernet start success");
+  server = compat::make_unique<EthernetServer>();
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
 
-  // Check that there's nothing there.
-  TEST_ASSERT_EQUAL_MESSAGE(-1, EthernetFrame.parseFrame(), "Expected nothing there");
+  EthernetClient clients[kCount];
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_TRUE_MESSAGE(clients[i].connect(Ethernet.localIP(), kPort),
+                             "Expected connect success");
+  }
 
-  // Create and listen
-  EthernetFrame.beginFrame(Ethernet.macAddress(), srcMAC, sizeof(data));
-  TEST_ASSERT_EQUAL_MESSAGE(sizeof(data),
-                            EthernetFrame.write(data, sizeof(data)),
-                            "Expected complete write");
+  // Accepted in the order they connected
+  EthernetClient accepted[kCount];
+  for (int i = 0; i < kCount; ++i) {
+    accepted[i] = server->accept();
+    TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(accepted[i]), "Expected accepted connection");
+    TEST_ASSERT_EQUAL_MESSAGE(clients[i].localPort(), accepted[i].remotePort(),
+                              "Expected accept order");
+  }
+  TEST_ASSERT_FALSE_MESSAGE(server->accept(), "Expected no more connections");
 
-  uint32_t t = millis();  // Current timestamp
+  TEST_ASSERT_FALSE_MESSAGE(server->available(), "Expected no data yet");
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_EQUAL_MESSAGE(1, clients[i].write(static_cast<uint8_t>(i)), "Expected write");
+    clients[i].flush();
+  }
+  const uint32_t t = millis();
+  while ((accepted[kCount - 1].available() == 0) && (millis() - t < 1000)) {
+    Ethernet.loop();
+  }
 
-  // NOTE: Use >= for receive counts because if this is on a network
-  //       then many frames might have been received or dropped
+  // Each connection with data is served once before any is served again
+  uint16_t ports[kCount + 1];
+  for (int i = 0; i < kCount + 1; ++i) {
+    EthernetClient c = server->available();
+    TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(c), "Expected available connection");
+    ports[i] = c.remotePort();
+  }
+  TEST_ASSERT_NOT_EQUAL_MESSAGE(ports[0], ports[1], "Expected different 0 and 1");
+  TEST_ASSERT_NOT_EQUAL_MESSAGE(ports[1], ports[2], "Expected different 1 and 2");
+  TEST_ASSERT_NOT_EQUAL_MESSAGE(ports[0], ports[2], "Expected different 0 and 2");
+  TEST_ASSERT_EQUAL_MESSAGE(ports[0], ports[kCount], "Expected wraparound");
+
+  // Read everything
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_EQUAL_MESSAGE(i, accepted[i].read(), "Expected data");
+  }
+  TEST_ASSERT_FALSE_MESSAGE(server->available(), "Expected no more data");
 
-  TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.endFrame(), "Expected send success");
-  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(1, EthernetFrame.totalReceiveCount(),
-                                       "Expected at least 1 frame");
+  for (int i = 0; i < kCount; ++i) {
+    accepted[i].close();
+    clients[i].close();
+  }
+  server->end();
+}
 
-  // Test that we actually received the packet
-  TEST_ASSERT_EQUAL_MESSAGE(14 + sizeof(data), EthernetFrame.parseFrame(),
-                            "Expected frame of proper size");
-  TEST_ASSERT_EQUAL_MESSAGE(14 + sizeof(data), EthernetFrame.size(),
-                            "Expected correct frame size");
+// Reads from each client until it has received 'size' bytes or the timeout
+// expires, and returns whether all of them did.
+static bool readAll(EthernetClient clients[], const int count,
+                    std::vector<uint8_t> bufs[], const size_t size,
+                    const uint32_t timeout) {
+  const uint32_t t = millis();
+  while (millis() - t < timeout) {
+    bool done = true;
+    for (int i = 0; i < count; ++i) {
+      int avail = clients[i].available();
+      while (avail-- > 0) {
+        bufs[i].push_back(static_cast<uint8_t>(clients[i].read()));
+      }
+      done = done && (bufs[i].size() >= size);
+    }
+    if (done) {
+      return true;
+    }
+    Ethernet.loop();
+  }
+  return false;
+}
 
-  if (EthernetFrame.size() > 0) {  // Avoid potentially accessing NULL data
-    const uint8_t* const frameData = EthernetFrame.data();
-    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(Ethernet.macAddress(), &frameData[0], 6,
-                                          "Expected matching dest MAC");
-    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(srcMAC, &frameData[6], 6,
-                                          "Expected matching src MAC");
-    TEST_ASSERT_EQUAL_MESSAGE(sizeof(data) >> 8, frameData[12],
-                              "Expected matching data len (1)");
-    TEST_ASSERT_EQUAL_MESSAGE(sizeof(data) & 0xff, frameData[13],
-                              "Expected matching data len (2)");
-    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(data, &frameData[14], 10,
-                                          "Expected matching data");
+// Tests sending one message to all of a server's connections.
+static void test_server_broadcast() {
+  constexpr uint16_t kPort = 1025;
+  constexpr int kCount = 2;
+  constexpr size_t kSize = TCP_SND_BUF + 100;  // Doesn't fit
 
-    TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(t, EthernetFrame.receivedTimestamp(),
-                                         "Expected valid timestamp");
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+
+  EthernetServer::BroadcastOptions options;
+  TEST_ASSERT_EQUAL_MESSAGE(
+      0, server->broadcast("x", 1, options).sent, "Expected no connections");
+
+  EthernetClient clients[kCount];
+  EthernetClient accepted[kCount];
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_TRUE_MESSAGE(clients[i].connect(Ethernet.localIP(), kPort),
+                             "Expected connect success");
+    accepted[i] = server->accept();
+    TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(accepted[i]), "Expected accepted connection");
   }
-#endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
-}
 
-// Tests raw frame receive queueing.
-static void test_raw_frames_receive_queueing() {
-#if QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
-  (void)Ethernet.setDHCPEnabled(false);
-  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(), "Expected Ethernet start success");
+  // A small message reaches everyone
+  static const char kMsg[] = "status";
+  int statusCount = 0;
+  EthernetServer::BroadcastResult result = server->broadcast(
+      kMsg, sizeof(kMsg), options,
+      [&statusCount](EthernetClient& c, EthernetServer::BroadcastStatus s) {
+        TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(c), "Expected connected client");
+        TEST_ASSERT_TRUE_MESSAGE(s == EthernetServer::BroadcastStatus::kSent,
+                                 "Expected sent status");
+        statusCount++;
+      });
+  TEST_ASSERT_EQUAL_MESSAGE(kCount, result.sent, "Expected all sent");
+  TEST_ASSERT_EQUAL_MESSAGE(kCount, statusCount, "Expected status for each");
+  server->flush();
+
+  std::vector<uint8_t> bufs[kCount];
+  TEST_ASSERT_TRUE_MESSAGE(readAll(clients, kCount, bufs, sizeof(kMsg), 2000),
+                           "Expected message");
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_EQUAL_MESSAGE(sizeof(kMsg), bufs[i].size(), "Expected size");
+    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(kMsg, bufs[i].data(), sizeof(kMsg),
+                                          "Expected data");
+    bufs[i].clear();
+  }
 
-  TEST_ASSERT_EQUAL_MESSAGE(1, EthernetFrame.receiveQueueCapacity(),
-                            "Expected default queue capacity");
+  // A large message is dropped without a buffer
+  std::vector<uint8_t> big(kSize);
+  for (size_t i = 0; i < kSize; ++i) {
+    big[i] = static_cast<uint8_t>(i * 7);
+  }
+  result = server->broadcast(big.data(), big.size(), options);
+  TEST_ASSERT_EQUAL_MESSAGE(kCount, result.dropped, "Expected all dropped");
+
+  // ...and queued with one
+  options.bufferLimit = kSize;
+  result = server->broadcast(big.data(), big.size(), options);
+  TEST_ASSERT_EQUAL_MESSAGE(kCount, result.queued, "Expected all queued");
+  TEST_ASSERT_EQUAL_MESSAGE(0, server->availableForWrite(),
+                            "Expected no room while queued");
+  server->flush();
+  TEST_ASSERT_TRUE_MESSAGE(readAll(clients, kCount, bufs, kSize, 10000),
+                           "Expected queued message");
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_EQUAL_MESSAGE(kSize, bufs[i].size(), "Expected size");
+    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(big.data(), bufs[i].data(), kSize,
+                                          "Expected data");
+  }
 
-  uint8_t buf[15];
-  (void)std::copy_n(Ethernet.macAddress(), 6, &buf[0]);
-  (void)std::copy_n(Ethernet.macAddress(), 6, &buf[6]);
-  buf[12] = 0;  // Length (16-bit)
-  buf[13] = 1;
+  // Slow consumers can be disconnected
+  options.bufferLimit = 0;
+  options.policy = EthernetServer::SlowConsumerPolicy::kDisconnect;
+  result = server->broadcast(big.data(), big.size(), options);
+  TEST_ASSERT_EQUAL_MESSAGE(kCount, result.disconnected, "Expected all disconnected");
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_FALSE_MESSAGE(accepted[i].connected(), "Expected aborted");
+  }
+  const uint32_t t = millis();
+  while ((clients[0].connected() || clients[1].connected()) &&
+         (millis() - t < 2000)) {
+    Ethernet.loop();
+  }
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_FALSE_MESSAGE(clients[i].connected(), "Expected remote disconnect");
+    clients[i].close();
+  }
+  server->end();
+}
 
-  // NOTE: Use >= for receive counts because if this is on a network
-  //       then many frames might have been received or dropped
+// Tests that queued broadcast data is sent after the stack refuses a write
+// while nothing is in flight, when there won't be a 'sent' callback.
+static void test_server_broadcast_retry() {
+  constexpr uint16_t kPort = 1025;
+  constexpr size_t kSize = 100;
 
-  // Send two frames
-  buf[14] = 1;
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+
+  EthernetClient clients[1];
+  TEST_ASSERT_TRUE_MESSAGE(clients[0].connect(Ethernet.localIP(), kPort),
+                           "Expected connect success");
+  EthernetClient accepted = server->accept();
+  TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(accepted), "Expected accepted connection");
+
+  std::vector<uint8_t> msg(kSize);
+  for (size_t i = 0; i < kSize; ++i) {
+    msg[i] = static_cast<uint8_t>(i * 3);
+  }
+
+  // Make the stack refuse the write by using up all the TCP segments
+  std::vector<void*> segs;
+  void* seg;
+  while ((seg = memp_malloc(MEMP_TCP_SEG)) != nullptr) {
+    segs.push_back(seg);
+  }
+  EthernetServer::BroadcastOptions options;
+  options.bufferLimit = kSize;
+  const EthernetServer::BroadcastResult result =
+      server->broadcast(msg.data(), msg.size(), options);
+  for (void* const p : segs) {
+    memp_free(MEMP_TCP_SEG, p);
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(1, result.queued, "Expected queued");
+
+  std::vector<uint8_t> bufs[1];
+  TEST_ASSERT_TRUE_MESSAGE(readAll(clients, 1, bufs, kSize, 2000),
+                           "Expected queued message");
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, bufs[0].size(), "Expected size");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(msg.data(), bufs[0].data(), kSize,
+                                        "Expected data");
+
+  clients[0].close();
+  accepted.close();
+  server->end();
+}
+
+// Tests that a listener answers with a SYN cookie when its backlog is full,
+// and that it has no backlog limit when SYN cookies are disabled.
+static void test_server_syn_cookies() {
+  constexpr uint16_t kPort = 1025;
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+  constexpr int kCount = TCP_DEFAULT_LISTEN_BACKLOG + 1;
+#else
+  constexpr int kCount = (MEMP_NUM_TCP_PCB + 3) / 4 + 1;
+#endif  // QNETHERNET_ENABLE_TCP_SYN_COOKIES
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+
+  const EthernetServer::SynCookieStats before = EthernetServer::synCookieStats();
+
+  // Send all the SYNs before any handshake completes
+  EthernetClient clients[kCount];
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_TRUE_MESSAGE(clients[i].connectNoWait(Ethernet.localIP(), kPort),
+                             "Expected connect start");
+  }
+  const uint32_t t = millis();
+  bool connected = false;
+  while (!connected && (millis() - t < 2000)) {
+    Ethernet.loop();
+    connected = true;
+    for (int i = 0; i < kCount; ++i) {
+      connected = connected && clients[i].connected();
+    }
+  }
+  TEST_ASSERT_TRUE_MESSAGE(connected, "Expected all connected");
+
+  const EthernetServer::SynCookieStats after = EthernetServer::synCookieStats();
+#if QNETHERNET_ENABLE_TCP_SYN_COOKIES
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(before.sent + 1, after.sent,
+                                       "Expected a cookie sent");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(before.accepted + 1, after.accepted,
+                                       "Expected a cookie accepted");
+  TEST_ASSERT_EQUAL_MESSAGE(before.rejected, after.rejected,
+                            "Expected no cookies rejected");
+  TEST_ASSERT_EQUAL_MESSAGE(before.failed, after.failed,
+                            "Expected no cookie allocation failures");
+#else
+  TEST_ASSERT_EQUAL_MESSAGE(before.sent, after.sent, "Expected no cookies");
+#endif  // QNETHERNET_ENABLE_TCP_SYN_COOKIES
+
+  // Every connection, including those from a cookie, works
+  EthernetClient accepted[kCount];
+  for (int i = 0; i < kCount; ++i) {
+    accepted[i] = server->accept();
+    TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(accepted[i]), "Expected accepted connection");
+    TEST_ASSERT_EQUAL_MESSAGE(1, accepted[i].write(static_cast<uint8_t>(i)), "Expected write");
+    accepted[i].flush();
+  }
+  TEST_ASSERT_FALSE_MESSAGE(server->accept(), "Expected no more connections");
+
+  std::vector<uint8_t> bufs[kCount];
+  TEST_ASSERT_TRUE_MESSAGE(readAll(clients, kCount, bufs, 1, 2000),
+                           "Expected data on each connection");
+  std::vector<bool> seen(kCount, false);
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_EQUAL_MESSAGE(1, bufs[i].size(), "Expected size");
+    TEST_ASSERT_LESS_THAN_MESSAGE(kCount, bufs[i][0], "Expected data");
+    seen[bufs[i][0]] = true;
+  }
+  for (int i = 0; i < kCount; ++i) {
+    TEST_ASSERT_TRUE_MESSAGE(seen[i], "Expected each accepted connection");
+  }
+
+  for (int i = 0; i < kCount; ++i) {
+    accepted[i].close();
+    clients[i].close();
+  }
+  server->end();
+}
+
+// Tests opening and closing many more connections than there are PCBs.
+static void test_server_connection_churn() {
+  constexpr uint16_t kPort = 1025;
+  constexpr int kCount = 50 * MEMP_NUM_TCP_PCB;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+
+  EthernetClient::resetPcbStats();
+  const uint32_t timeout = EthernetClient::timeWaitTimeout();
+
+  // The server closes first, leaving its side in TIME_WAIT, as with HTTP
+  const uint32_t start = millis();
+  for (int i = 0; i < kCount; ++i) {
+    EthernetClient client;
+    TEST_ASSERT_TRUE_MESSAGE(client.connect(Ethernet.localIP(), kPort),
+                             format("Expected connect success: %d", i).data());
+    EthernetClient accepted = server->accept();
+    TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(accepted),
+                             format("Expected accepted connection: %d", i).data());
+    TEST_ASSERT_EQUAL_MESSAGE(1, accepted.write(static_cast<uint8_t>(i)), "Expected write");
+    accepted.flush();
+    const uint32_t t = millis();
+    while ((client.available() == 0) && (millis() - t < 1000)) {
+      Ethernet.loop();
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<uint8_t>(i), client.read(), "Expected data");
+    accepted.close();
+    client.close();
+  }
+  const uint32_t elapsed = millis() - start;
+  TEST_MESSAGE(format("%d connections in %" PRIu32 "ms (%" PRIu32 "/min)",
+                      kCount, elapsed,
+                      static_cast<uint32_t>(kCount * 60000ULL /
+                                            std::max(elapsed, uint32_t{1})))
+                   .data());
+
+  EthernetClient::PcbStats stats = EthernetClient::pcbStats();
+  TEST_ASSERT_EQUAL_MESSAGE(MEMP_NUM_TCP_PCB, stats.capacity, "Expected capacity");
+  TEST_ASSERT_EQUAL_MESSAGE(0, stats.failed, "Expected no failed allocations");
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+  TEST_ASSERT_GREATER_THAN_MESSAGE(0, stats.exhausted, "Expected exhaustion");
+  TEST_ASSERT_GREATER_THAN_MESSAGE(0, stats.recycled, "Expected recycled PCBs");
+  TEST_ASSERT_GREATER_THAN_MESSAGE(0, stats.timeWait, "Expected TIME_WAIT PCBs");
+
+  // A short TIME_WAIT frees the PCBs
+  EthernetClient::setTimeWaitTimeout(0);
+  TEST_ASSERT_EQUAL_MESSAGE(0, EthernetClient::timeWaitTimeout(), "Expected timeout");
+  const uint32_t t = millis();
+  while ((EthernetClient::pcbStats().timeWait > 0) && (millis() - t < 2000)) {
+    Ethernet.loop();
+  }
+  EthernetClient::setTimeWaitTimeout(timeout);
+  stats = EthernetClient::pcbStats();
+  TEST_ASSERT_EQUAL_MESSAGE(0, stats.timeWait, "Expected no TIME_WAIT PCBs");
+
+  EthernetClient::resetPcbStats();
+  TEST_ASSERT_EQUAL_MESSAGE(0, EthernetClient::pcbStats().recycled, "Expected reset");
+#else
+  (void)timeout;
+#endif  // QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+
+  server->end();
+}
+
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+// Raw connection states.
+enum class RawState {
+  kConnecting,
+  kConnected,
+  kError,  // The PCB has been freed
+};
+
+// Starts a raw TCP connection from a fixed local port and tracks its state in
+// *state. The PCB is freed by the stack after the peer closes or if there's
+// an error.
+static struct tcp_pcb* rawConnect(const uint16_t localPort,
+                                  const uint16_t remotePort,
+                                  RawState* const state) {
+  struct tcp_pcb* const pcb = tcp_new();
+  if (pcb == nullptr) {
+    return nullptr;
+  }
+  *state = RawState::kConnecting;
+  ip_set_option(pcb, SOF_REUSEADDR);
+  tcp_arg(pcb, state);
+  tcp_err(pcb, [](void* const arg, const err_t err) {
+    LWIP_UNUSED_ARG(err);
+    *static_cast<RawState*>(arg) = RawState::kError;
+  });
+  if (tcp_bind(pcb, IP_ANY_TYPE, localPort) != ERR_OK) {
+    tcp_abort(pcb);
+    return nullptr;
+  }
+  const ip_addr_t ip IPADDR4_INIT(static_cast<uint32_t>(Ethernet.localIP()));
+  const err_t err = tcp_connect(
+      pcb, &ip, remotePort,
+      [](void* const arg, struct tcp_pcb* const tpcb, const err_t err) -> err_t {
+        LWIP_UNUSED_ARG(tpcb);
+        LWIP_UNUSED_ARG(err);  // Always ERR_OK
+        *static_cast<RawState*>(arg) = RawState::kConnected;
+        return ERR_OK;
+      });
+  if (err != ERR_OK) {
+    tcp_abort(pcb);
+    return nullptr;
+  }
+  return pcb;
+}
+
+// Returns the TIME_WAIT PCB for the given ports, or NULL if there isn't one.
+static struct tcp_pcb* findTimeWait(const uint16_t localPort,
+                                    const uint16_t remotePort) {
+  for (struct tcp_pcb* pcb = tcp_tw_pcbs; pcb != nullptr; pcb = pcb->next) {
+    if ((pcb->local_port == localPort) && (pcb->remote_port == remotePort)) {
+      return pcb;
+    }
+  }
+  return nullptr;
+}
+
+// Sends a SYN with the given sequence number from the local address and
+// 'localPort' to the local address and 'remotePort'. It's input directly,
+// as if it had come from the loopback interface, so that the sequence number
+// can be chosen.
+static bool injectSyn(const uint16_t localPort, const uint16_t remotePort,
+                      const uint32_t seqno) {
+  struct pbuf* const p = pbuf_alloc(PBUF_RAW, IP_HLEN + TCP_HLEN, PBUF_RAM);
+  if (p == nullptr) {
+    return false;
+  }
+  const ip_addr_t addr IPADDR4_INIT(static_cast<uint32_t>(Ethernet.localIP()));
+
+  struct tcp_hdr* const tcphdr =
+      reinterpret_cast<struct tcp_hdr*>(static_cast<uint8_t*>(p->payload) +
+                                        IP_HLEN);
+  std::memset(tcphdr, 0, TCP_HLEN);
+  tcphdr->src = lwip_htons(localPort);
+  tcphdr->dest = lwip_htons(remotePort);
+  tcphdr->seqno = lwip_htonl(seqno);
+  TCPH_HDRLEN_FLAGS_SET(tcphdr, TCP_HLEN / 4, TCP_SYN);
+  tcphdr->wnd = lwip_htons(static_cast<uint16_t>(TCPWND_MIN16(TCP_WND)));
+  pbuf_remove_header(p, IP_HLEN);
+  tcphdr->chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, TCP_HLEN, &addr, &addr);
+  pbuf_add_header(p, IP_HLEN);
+
+  struct ip_hdr* const iphdr = static_cast<struct ip_hdr*>(p->payload);
+  std::memset(iphdr, 0, IP_HLEN);
+  IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+  IPH_LEN_SET(iphdr, lwip_htons(IP_HLEN + TCP_HLEN));
+  IPH_TTL_SET(iphdr, TCP_TTL);
+  IPH_PROTO_SET(iphdr, IP_PROTO_TCP);
+  ip4_addr_copy(iphdr->src, *ip_2_ip4(&addr));
+  ip4_addr_copy(iphdr->dest, *ip_2_ip4(&addr));
+  IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+
+  return ip4_input(p, netif_default) == ERR_OK;
+}
+#endif  // QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+
+// Tests that a SYN from the same address and port can take over a connection
+// in TIME_WAIT, but only if its sequence number is past the old connection.
+static void test_server_time_wait_reuse() {
+#if QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+  constexpr uint16_t kPort = 1025;
+  constexpr uint16_t kClientPort = 40000;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+
+  EthernetClient::resetPcbStats();
+
+  // Connect from the same port twice, with the server closing first each
+  // time; the second SYN arrives while the first connection is in TIME_WAIT
+  for (int i = 0; i < 2; ++i) {
+    RawState state;
+    TEST_ASSERT_NOT_NULL_MESSAGE(rawConnect(kClientPort, kPort, &state),
+                                 format("Expected connect start: %d", i).data());
+    uint32_t t = millis();
+    while ((state == RawState::kConnecting) && (millis() - t < 1000)) {
+      Ethernet.loop();
+    }
+    TEST_ASSERT_TRUE_MESSAGE(state == RawState::kConnected,
+                             format("Expected connected: %d", i).data());
+    EthernetClient accepted = server->accept();
+    TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(accepted),
+                             format("Expected accepted connection: %d", i).data());
+    TEST_ASSERT_EQUAL_MESSAGE(i, EthernetClient::pcbStats().reused,
+                              format("Expected reuse count: %d", i).data());
+
+    // The raw connection closes when it receives the FIN
+    accepted.close();
+    t = millis();
+    while ((findTimeWait(kPort, kClientPort) == nullptr) &&
+           (millis() - t < 1000)) {
+      Ethernet.loop();
+    }
+    TEST_ASSERT_NOT_NULL_MESSAGE(findTimeWait(kPort, kClientPort),
+                                 format("Expected TIME_WAIT: %d", i).data());
+  }
+
+  // A SYN whose sequence number isn't past the old connection is not allowed
+  // to take it over; send one from the same port with an ISN before the end
+  // of the old connection
+  struct tcp_pcb* const tw = findTimeWait(kPort, kClientPort);
+  TEST_ASSERT_TRUE_MESSAGE(injectSyn(kClientPort, kPort, tw->rcv_nxt - 1),
+                           "Expected SYN input");
+  uint32_t t = millis();
+  while (millis() - t < 500) {
+    Ethernet.loop();
+  }
+  TEST_ASSERT_FALSE_MESSAGE(server->accept(), "Expected no accepted connection");
+  TEST_ASSERT_EQUAL_MESSAGE(1, EthernetClient::pcbStats().reused,
+                            "Expected no more reuse");
+  TEST_ASSERT_TRUE_MESSAGE(findTimeWait(kPort, kClientPort) == tw,
+                           "Expected TIME_WAIT kept");
+
+  // The same SYN, with an ISN past the end of the old connection, takes it
+  // over; the listener's SYN|ACK goes unanswered since there's no client PCB
+  TEST_ASSERT_TRUE_MESSAGE(injectSyn(kClientPort, kPort, tw->rcv_nxt + 1),
+                           "Expected SYN input");
+  TEST_ASSERT_EQUAL_MESSAGE(2, EthernetClient::pcbStats().reused,
+                            "Expected reuse");
+  TEST_ASSERT_TRUE_MESSAGE(findTimeWait(kPort, kClientPort) == nullptr,
+                           "Expected TIME_WAIT freed");
+  t = millis();
+  while (millis() - t < 500) {
+    Ethernet.loop();
+  }
+  TEST_ASSERT_FALSE_MESSAGE(server->accept(), "Expected no accepted connection");
+
+  server->end();
+#else
+  TEST_IGNORE_MESSAGE("TIME_WAIT policy disabled");
+#endif  // QNETHERNET_ENABLE_TCP_TIME_WAIT_POLICY
+}
+
+// Tests that connection objects come from the pools.
+static void test_client_connection_pool() {
+  constexpr uint16_t kPort = 1025;
+  constexpr int kCount = 2;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  const EthernetClient::ConnectionPoolStats before =
+      EthernetClient::connectionPoolStats();
+  TEST_ASSERT_EQUAL_MESSAGE(EthernetClient::maxSockets(), before.capacity,
+                            "Expected capacity");
+
+  server = compat::make_unique<EthernetServer>();
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+
+  for (int round = 0; round < 3; ++round) {
+    {
+      EthernetClient clients[kCount];
+      EthernetClient accepted[kCount];
+      for (int i = 0; i < kCount; ++i) {
+        TEST_ASSERT_TRUE_MESSAGE(clients[i].connect(Ethernet.localIP(), kPort),
+                                 "Expected connect success");
+        accepted[i] = server->accept();
+        TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(accepted[i]),
+                                 "Expected accepted connection");
+      }
+
+      // Both ends of each connection
+      const EthernetClient::ConnectionPoolStats during =
+          EthernetClient::connectionPoolStats();
+      TEST_ASSERT_EQUAL_MESSAGE(before.holdersInUse + 2*kCount,
+                                during.holdersInUse, "Expected holders in use");
+      TEST_ASSERT_EQUAL_MESSAGE(before.statesInUse + 2*kCount,
+                                during.statesInUse, "Expected states in use");
+
+      for (int i = 0; i < kCount; ++i) {
+        clients[i].abort();
+        accepted[i].abort();
+      }
+    }
+    Ethernet.loop();
+
+    const EthernetClient::ConnectionPoolStats after =
+        EthernetClient::connectionPoolStats();
+    TEST_ASSERT_EQUAL_MESSAGE(before.holdersInUse, after.holdersInUse,
+                              "Expected holders returned");
+    TEST_ASSERT_EQUAL_MESSAGE(before.statesInUse, after.statesInUse,
+                              "Expected states returned");
+    TEST_ASSERT_EQUAL_MESSAGE(before.overflows, after.overflows,
+                              "Expected no heap use");
+  }
+
+  server->end();
+}
+
+// Sends 'size' bytes from 'from' while reading them promptly on 'to' and
+// returns the number of bytes received. The largest receive window seen on 'to'
+// is stored in 'maxWnd'.
+static size_t transferAndWatchWindow(EthernetClient& from, EthernetClient& to,
+                                     const size_t size, size_t& maxWnd) {
+  uint8_t buf[256];
+  for (size_t i = 0; i < sizeof(buf); ++i) {
+    buf[i] = static_cast<uint8_t>(i);
+  }
+  size_t sent = 0;
+  size_t received = 0;
+  maxWnd = 0;
+  const uint32_t t = millis();
+  while ((received < size) && (millis() - t < 20000)) {
+    if (sent < size) {
+      sent += from.write(buf, std::min(sizeof(buf), size - sent));
+      from.flush();
+    }
+    Ethernet.loop();
+    int n;
+    while ((n = to.read(buf, sizeof(buf))) > 0) {
+      received += n;
+    }
+    maxWnd = std::max(maxWnd, to.receiveWindow());
+  }
+  return received;
+}
+
+// Tests receive window autotuning.
+static void test_client_window_autotune() {
+  constexpr uint16_t kPort = 1025;
+  constexpr size_t kInitial = std::min(QNETHERNET_TCP_WND_INITIAL, TCP_WND);
+  constexpr size_t kSize = 8 * TCP_WND;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  TEST_ASSERT_EQUAL_MESSAGE(0, client->receiveWindow(),
+                            "Expected no window when not connected");
+
+  // With the default options, windows have room to grow, even with every
+  // connection in use
+  TEST_ASSERT_LESS_THAN_MESSAGE(TCP_WND, kInitial, "Expected room to grow");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(MEMP_NUM_TCP_PCB*kInitial + TCP_WND,
+                                       EthernetClient::receiveWindowBudget(),
+                                       "Expected budget headroom");
+
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+  TEST_ASSERT_TRUE_MESSAGE(client->connect(Ethernet.localIP(), kPort),
+                           "Expected connect success");
+  EthernetClient accepted = server->accept();
+  TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(accepted),
+                           "Expected accepted connection");
+  TEST_ASSERT_EQUAL_MESSAGE(kInitial, accepted.receiveWindow(),
+                            "Expected initial window");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(2*kInitial,
+                                       EthernetClient::receiveWindowTotal(),
+                                       "Expected both windows counted");
+
+  // The window grows while the application keeps up
+  size_t maxWnd;
+  size_t received = transferAndWatchWindow(*client, accepted, kSize, maxWnd);
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, received, "Expected all data received");
+  TEST_MESSAGE(format("Max. window: %zu", maxWnd).data());
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(2*kInitial, maxWnd,
+                                       "Expected window growth");
+  TEST_ASSERT_GREATER_THAN_MESSAGE(4*TCP_MSS, maxWnd,
+                                   "Expected growth past a fixed window");
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(TCP_WND, maxWnd, "Expected window cap");
+
+  // Being idle starts the window over
+  delay(QNETHERNET_TCP_WND_IDLE_TIMEOUT + 50);
+  TEST_ASSERT_EQUAL_MESSAGE(1, client->write('a'), "Expected write");
+  client->flush();
+  const uint32_t t = millis();
+  while ((accepted.available() == 0) && (millis() - t < 2000)) {
+    Ethernet.loop();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE('a', accepted.read(), "Expected data");
+  TEST_ASSERT_EQUAL_MESSAGE(kInitial, accepted.receiveWindow(),
+                            "Expected initial window after idle");
+
+  // No growth past the budget
+  const size_t budget = EthernetClient::receiveWindowBudget();
+  EthernetClient::setReceiveWindowBudget(EthernetClient::receiveWindowTotal());
+  received = transferAndWatchWindow(*client, accepted, kSize, maxWnd);
+  EthernetClient::setReceiveWindowBudget(budget);
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, received, "Expected all data received");
+  TEST_ASSERT_EQUAL_MESSAGE(kInitial, maxWnd, "Expected no growth");
+
+  accepted.abort();
+  client->abort();
+  server->end();
+}
+
+// Loops for the given time and returns the number of bytes that became
+// available on the client.
+static int availableAfter(EthernetClient& c, const uint32_t ms) {
+  const uint32_t t = millis();
+  while (millis() - t < ms) {
+    Ethernet.loop();
+  }
+  return c.available();
+}
+
+// Tests corking writes.
+static void test_client_cork() {
+  constexpr uint16_t kPort = 1025;
+  constexpr uint32_t kTimeout = 300;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  TEST_ASSERT_FALSE_MESSAGE(client->setCork(true),
+                            "Expected no option set when not connected");
+  TEST_ASSERT_FALSE_MESSAGE(client->isCorked(), "Expected not corked");
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+  TEST_ASSERT_TRUE_MESSAGE(client->connect(Ethernet.localIP(), kPort),
+                           "Expected connect success");
+  EthernetClient accepted = server->accept();
+  TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(accepted),
+                           "Expected accepted connection");
+
+  TEST_ASSERT_EQUAL_MESSAGE(QNETHERNET_DEFAULT_TCP_CORK_TIMEOUT,
+                            client->corkTimeout(), "Expected default timeout");
+  TEST_ASSERT_TRUE_MESSAGE(client->setCorkTimeout(kTimeout),
+                           "Expected timeout set");
+  TEST_ASSERT_TRUE_MESSAGE(client->setCork(true), "Expected cork set");
+  TEST_ASSERT_TRUE_MESSAGE(client->isCorked(), "Expected corked");
+
+  // Small writes are held until the timeout
+  for (int i = 0; i < 10; ++i) {
+    TEST_ASSERT_EQUAL_MESSAGE(4, client->print("abcd"), "Expected print");
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(0, availableAfter(accepted, kTimeout / 3),
+                            "Expected data held");
+  TEST_ASSERT_EQUAL_MESSAGE(40, availableAfter(accepted, kTimeout),
+                            "Expected data after timeout");
+  TEST_ASSERT_EQUAL_MESSAGE(40, accepted.read(nullptr, 40), "Expected skip");
+
+  // Full segments go right away, and the rest waits for the uncork
+  const size_t mss = TCP_MSS;  // Both ends use the same MSS
+  std::vector<uint8_t> data(mss + 10);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i);
+  }
+  size_t sent = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    sent += client->write(data[i]);
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(data.size(), sent, "Expected all written");
+  TEST_ASSERT_EQUAL_MESSAGE(mss, availableAfter(accepted, kTimeout / 3),
+                            "Expected one full segment");
+  TEST_ASSERT_TRUE_MESSAGE(client->setCork(false), "Expected uncork");
+  TEST_ASSERT_EQUAL_MESSAGE(data.size(), availableAfter(accepted, 50),
+                            "Expected the rest after uncork");
+  std::vector<uint8_t> received(data.size());
+  TEST_ASSERT_EQUAL_MESSAGE(data.size(),
+                            accepted.read(received.data(), received.size()),
+                            "Expected read");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(data.data(), received.data(),
+                                        data.size(), "Expected same data");
+
+  // Flushing sends corked data
+  TEST_ASSERT_TRUE_MESSAGE(client->setCork(true), "Expected cork set");
+  TEST_ASSERT_EQUAL_MESSAGE(3, client->print("xyz"), "Expected print");
+  client->flush();
+  TEST_ASSERT_EQUAL_MESSAGE(3, availableAfter(accepted, kTimeout / 3),
+                            "Expected data after flush");
+
+  accepted.abort();
+  client->abort();
+  server->end();
+}
+
+// Tests the TCP state snapshot and counters.
+static void test_client_tcp_info() {
+  constexpr uint16_t kPort = 1025;
+  constexpr size_t kSize = 4 * TCP_WND;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  EthernetClient::TcpInfo info;
+  TEST_ASSERT_FALSE_MESSAGE(client->tcpInfo(info),
+                            "Expected no info when not connected");
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+  TEST_ASSERT_TRUE_MESSAGE(client->connect(Ethernet.localIP(), kPort),
+                           "Expected connect success");
+  EthernetClient accepted = server->accept();
+  TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(accepted),
+                           "Expected accepted connection");
+
+  TEST_ASSERT_TRUE_MESSAGE(client->tcpInfo(info), "Expected info");
+  TEST_ASSERT_EQUAL_MESSAGE(ESTABLISHED, info.state, "Expected established");
+  TEST_ASSERT_GREATER_THAN_MESSAGE(0, info.mss, "Expected an MSS");
+  TEST_ASSERT_GREATER_THAN_MESSAGE(0, info.rto, "Expected an RTO");
+#if QNETHERNET_ENABLE_TCP_COUNTERS
+  TEST_ASSERT_EQUAL_MESSAGE(0, info.bytesSent, "Expected no data yet");
+#endif  // QNETHERNET_ENABLE_TCP_COUNTERS
+
+  size_t maxWnd;
+  const size_t received =
+      transferAndWatchWindow(*client, accepted, kSize, maxWnd);
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, received, "Expected all data received");
+
+  // Wait for the last, possibly delayed, ACK
+  const uint32_t t = millis();
+  while (client->tcpInfo(info) && (info.unackedBytes != 0) &&
+         (millis() - t < 2000)) {
+    Ethernet.loop();
+  }
+
+  TEST_ASSERT_TRUE_MESSAGE(client->tcpInfo(info), "Expected info");
+  TEST_ASSERT_EQUAL_MESSAGE(0, info.unackedBytes, "Expected all acknowledged");
+  TEST_ASSERT_EQUAL_MESSAGE(0, info.unsentBytes, "Expected all sent");
+#if QNETHERNET_ENABLE_TCP_COUNTERS
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, info.bytesSent, "Expected bytes sent");
+  TEST_ASSERT_EQUAL_MESSAGE(0, info.retransmits, "Expected no retransmits");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(kSize / info.mss, info.segmentsSent,
+                                       "Expected segments sent");
+  TEST_ASSERT_GREATER_THAN_MESSAGE(0, info.segmentsReceived,
+                                   "Expected ACKs received");
+
+  EthernetClient::TcpInfo peer;
+  TEST_ASSERT_TRUE_MESSAGE(accepted.tcpInfo(peer), "Expected peer info");
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, peer.bytesReceived, "Expected bytes received");
+  TEST_ASSERT_EQUAL_MESSAGE(0, peer.outOfOrder, "Expected in-order data");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(kSize / peer.mss, peer.segmentsReceived,
+                                       "Expected segments received");
+
+  // A receiver that doesn't read closes its window. Zero-copy receive only
+  // opens the window as data is read. The last of the window may only be
+  // filled by the sender's persist timer.
+  TEST_ASSERT_TRUE_MESSAGE(accepted.setZeroCopyReceive(true),
+                           "Expected zero-copy set");
+  std::vector<uint8_t> buf(info.mss);
+  const uint32_t t2 = millis();
+  while (client->tcpInfo(info) && (info.zeroWindowsReceived == 0) &&
+         (millis() - t2 < 5000)) {
+    (void)client->write(buf.data(), buf.size());
+    client->flush();
+    Ethernet.loop();
+  }
+  TEST_ASSERT_TRUE_MESSAGE(client->tcpInfo(info), "Expected info");
+  TEST_ASSERT_TRUE_MESSAGE(accepted.tcpInfo(peer), "Expected peer info");
+  TEST_ASSERT_GREATER_THAN_MESSAGE(0, info.zeroWindowsReceived,
+                                   "Expected a zero window received");
+  TEST_ASSERT_GREATER_THAN_MESSAGE(0, peer.zeroWindowsSent,
+                                   "Expected a zero window sent");
+#endif  // QNETHERNET_ENABLE_TCP_COUNTERS
+
+  accepted.abort();
+  client->abort();
+  server->end();
+}
+
+// Tests zero-copy TCP receive.
+static void test_client_zero_copy_receive() {
+  constexpr uint16_t kPort = 1025;
+  constexpr size_t kSize = 3 * TCP_WND + 123;  // More than the window
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  TEST_ASSERT_FALSE_MESSAGE(client->setZeroCopyReceive(true),
+                            "Expected no option set when not connected");
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+  TEST_ASSERT_TRUE_MESSAGE(client->connect(Ethernet.localIP(), kPort), "Expected connect success");
+  EthernetClient c = server->accept();
+  TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(c), "Expected accepted connection");
+
+  TEST_ASSERT_FALSE_MESSAGE(c.isZeroCopyReceive(), "Expected off by default");
+  TEST_ASSERT_TRUE_MESSAGE(c.setZeroCopyReceive(true), "Expected option set");
+  TEST_ASSERT_TRUE_MESSAGE(c.isZeroCopyReceive(), "Expected on");
+
+  // Send more than a window's worth while reading in odd-sized pieces
+  size_t sent = 0;
+  size_t received = 0;
+  bool peeked = false;
+  uint8_t buf[97];
+  const uint32_t t = millis();
+  while ((received < kSize) && (millis() - t < 5000)) {
+    while (sent < kSize) {
+      const size_t n = std::min(sizeof(buf), kSize - sent);
+      for (size_t i = 0; i < n; ++i) {
+        buf[i] = static_cast<uint8_t>(sent + i);
+      }
+      const size_t written = client->write(buf, n);
+      sent += written;
+      if (written < n) {
+        break;
+      }
+    }
+    client->flush();
+
+    if (!peeked && (c.available() > 0)) {
+      TEST_ASSERT_EQUAL_MESSAGE(static_cast<uint8_t>(received), c.peek(),
+                                "Expected peek data");
+      TEST_ASSERT_EQUAL_MESSAGE(static_cast<uint8_t>(received), c.read(),
+                                "Expected single-byte read data");
+      ++received;
+      peeked = true;
+    }
+    const int n = c.read(buf, sizeof(buf));
+    for (int i = 0; i < n; ++i) {
+      TEST_ASSERT_EQUAL_MESSAGE(static_cast<uint8_t>(received + i), buf[i],
+                                "Expected matching data");
+    }
+    received += n;
+    Ethernet.loop();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, sent, "Expected all sent");
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, received, "Expected all received");
+  TEST_ASSERT_EQUAL_MESSAGE(0, c.available(), "Expected nothing available");
+
+  // Data that's still queued is readable after the remote side closes
+  TEST_ASSERT_EQUAL_MESSAGE(5, client->write(buf, 5), "Expected write");
+  client->flush();
+  const uint32_t t2 = millis();
+  while ((c.available() < 5) && (millis() - t2 < 1000)) {
+    Ethernet.loop();
+  }
+  client->close();
+  for (int i = 0; i < 100; ++i) {
+    Ethernet.loop();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(5, c.read(nullptr, 10), "Expected remaining data");
+
+  c.close();
+  server->end();
+}
+
+// Tests zero-copy reading of a pbuf chain that has zero-length pbufs, like the
+// ones lwIP leaves when it trims an overlapping segment.
+static void test_client_zero_copy_empty_pbufs() {
+  constexpr uint16_t kPort = 1025;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+  TEST_ASSERT_TRUE_MESSAGE(client->connect(Ethernet.localIP(), kPort), "Expected connect success");
+  EthernetClient c = server->accept();
+  TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(c), "Expected accepted connection");
+  TEST_ASSERT_TRUE_MESSAGE(c.setZeroCopyReceive(true), "Expected option set");
+
+  const uint16_t clientPort = client->localPort();
+  struct tcp_pcb* pcb = tcp_active_pcbs;
+  while ((pcb != nullptr) &&
+         ((pcb->local_port != kPort) || (pcb->remote_port != clientPort))) {
+    pcb = pcb->next;
+  }
+  TEST_ASSERT_NOT_NULL_MESSAGE(pcb, "Expected accepted PCB");
+
+  // Deliver: empty, {1, 2, 3}, empty, {4, 5}, empty
+  constexpr uint8_t data1[]{1, 2, 3};
+  constexpr uint8_t data2[]{4, 5};
+  struct pbuf* const p = pbuf_alloc(PBUF_RAW, 0, PBUF_RAM);
+  struct pbuf* const p1 = pbuf_alloc(PBUF_RAW, sizeof(data1), PBUF_RAM);
+  struct pbuf* const p2 = pbuf_alloc(PBUF_RAW, 0, PBUF_RAM);
+  struct pbuf* const p3 = pbuf_alloc(PBUF_RAW, sizeof(data2), PBUF_RAM);
+  struct pbuf* const p4 = pbuf_alloc(PBUF_RAW, 0, PBUF_RAM);
+  TEST_ASSERT_TRUE_MESSAGE((p != nullptr) && (p1 != nullptr) &&
+                               (p2 != nullptr) && (p3 != nullptr) &&
+                               (p4 != nullptr),
+                           "Expected pbufs");
+  (void)pbuf_take(p1, data1, sizeof(data1));
+  (void)pbuf_take(p3, data2, sizeof(data2));
+  pbuf_cat(p, p1);
+  pbuf_cat(p, p2);
+  pbuf_cat(p, p3);
+  pbuf_cat(p, p4);
+  TEST_ASSERT_EQUAL_MESSAGE(ERR_OK, pcb->recv(pcb->callback_arg, pcb, p, ERR_OK),
+                            "Expected pbufs accepted");
+
+  TEST_ASSERT_EQUAL_MESSAGE(5, c.available(), "Expected 5 available");
+  TEST_ASSERT_EQUAL_MESSAGE(1, c.peek(), "Expected peek past an empty pbuf");
+  uint8_t buf[10];
+  TEST_ASSERT_EQUAL_MESSAGE(3, c.read(buf, 3), "Expected 3 read");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(data1, buf, 3, "Expected first data");
+  TEST_ASSERT_EQUAL_MESSAGE(4, c.peek(), "Expected peek past an empty pbuf");
+  TEST_ASSERT_EQUAL_MESSAGE(2, c.read(buf, sizeof(buf)), "Expected 2 read");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(data2, buf, 2, "Expected second data");
+  TEST_ASSERT_EQUAL_MESSAGE(0, c.available(), "Expected nothing available");
+  TEST_ASSERT_EQUAL_MESSAGE(0, c.read(buf, sizeof(buf)), "Expected 0 read");
+  TEST_ASSERT_EQUAL_MESSAGE(-1, c.peek(), "Expected nothing to peek");
+
+  c.close();
+  server->end();
+}
+
+// Tests closing a zero-copy connection that has unread data. The data has to be
+// given back to the stack first or the connection is reset instead of closed.
+static void test_client_zero_copy_close_unread() {
+  constexpr uint16_t kPort = 1025;
+  constexpr size_t kSize = 100;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+  TEST_ASSERT_TRUE_MESSAGE(client->connect(Ethernet.localIP(), kPort), "Expected connect success");
+  EthernetClient c = server->accept();
+  TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(c), "Expected accepted connection");
+  TEST_ASSERT_TRUE_MESSAGE(c.setZeroCopyReceive(true), "Expected option set");
+
+  uint8_t buf[kSize]{0};
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, client->write(buf, kSize), "Expected write");
+  client->flush();
+  uint32_t t = millis();
+  while ((c.available() < static_cast<int>(kSize)) && (millis() - t < 1000)) {
+    Ethernet.loop();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, c.available(), "Expected queued data");
+
+  // Close without reading anything
+  const uint16_t clientPort = client->localPort();
+  c.close();
+  t = millis();
+  while (client->connected() && (millis() - t < 1000)) {
+    Ethernet.loop();
+  }
+  TEST_ASSERT_FALSE_MESSAGE(client->connected(), "Expected remote side closed");
+
+  // A normal close leaves the closing side in TIME_WAIT; a reset frees it
+  bool timeWait = false;
+  t = millis();
+  while (!timeWait && (millis() - t < 1000)) {
+    Ethernet.loop();
+    for (const struct tcp_pcb* pcb = tcp_tw_pcbs; pcb != nullptr;
+         pcb = pcb->next) {
+      if ((pcb->local_port == kPort) && (pcb->remote_port == clientPort)) {
+        timeWait = true;
+      }
+    }
+  }
+  TEST_ASSERT_TRUE_MESSAGE(timeWait, "Expected a close and not a reset");
+
+  server->end();
+}
+
+// Tests that closing a connection while the stack holds data it refused resets
+// the connection instead of closing it.
+static void test_client_close_refused() {
+  constexpr uint16_t kPort = 1025;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+  TEST_ASSERT_TRUE_MESSAGE(client->connect(Ethernet.localIP(), kPort), "Expected connect success");
+  EthernetClient c = server->accept();
+  TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(c), "Expected accepted connection");
+
+  // Send more than the receiver can buffer, without reading any of it
+  std::vector<uint8_t> buf(TCP_MSS);
+  uint32_t t = millis();
+  while ((c.available() < static_cast<int>(TCP_WND)) && (millis() - t < 2000)) {
+    (void)client->write(buf.data(), buf.size());
+    client->flush();
+    Ethernet.loop();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(TCP_WND, c.available(), "Expected a full buffer");
+  t = millis();
+  while (millis() - t < 200) {
+    (void)client->write(buf.data(), buf.size());
+    client->flush();
+    Ethernet.loop();
+  }
+
+  // The closing side is reset and freed, and not left in TIME_WAIT
+  const uint16_t clientPort = client->localPort();
+  c.close();
+  TEST_ASSERT_FALSE_MESSAGE(c.connected(), "Expected closed");
+  t = millis();
+  while (client->connected() && (millis() - t < 1000)) {
+    Ethernet.loop();
+  }
+  TEST_ASSERT_FALSE_MESSAGE(client->connected(), "Expected remote side reset");
+  for (const struct tcp_pcb* pcb = tcp_tw_pcbs; pcb != nullptr;
+       pcb = pcb->next) {
+    TEST_ASSERT_FALSE_MESSAGE(
+        (pcb->local_port == kPort) && (pcb->remote_port == clientPort),
+        "Expected a reset and not a close");
+  }
+
+  server->end();
+}
+
+// Tests the shared TCP receive buffer pool.
+static void test_client_receive_pool() {
+  constexpr uint16_t kPort = 1025;
+  constexpr size_t kChunkSize = 512;
+  constexpr size_t kChunkCount = 8;  // Less than a window's worth
+  constexpr size_t kSize = 2 * TCP_WND;
+
+  TEST_ASSERT_FALSE_MESSAGE(EthernetClient::setReceivePool(0, 1),
+                            "Expected invalid chunk size");
+  TEST_ASSERT_EQUAL_MESSAGE(EINVAL, errno, "Expected EINVAL");
+  TEST_ASSERT_TRUE_MESSAGE(EthernetClient::setReceivePool(kChunkSize, kChunkCount),
+                           "Expected pool set");
+  EthernetClient::ReceivePoolStats stats = EthernetClient::receivePoolStats();
+  TEST_ASSERT_EQUAL_MESSAGE(kChunkSize, stats.chunkSize, "Expected chunk size");
+  TEST_ASSERT_EQUAL_MESSAGE(kChunkCount, stats.chunkCount, "Expected chunk count");
+  TEST_ASSERT_EQUAL_MESSAGE(0, stats.inUse, "Expected none in use");
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+  TEST_ASSERT_TRUE_MESSAGE(client->connect(Ethernet.localIP(), kPort), "Expected connect success");
+  EthernetClient c = server->accept();
+  TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(c), "Expected accepted connection");
+
+  // Nothing is borrowed while idle
+  TEST_ASSERT_EQUAL_MESSAGE(0, EthernetClient::receivePoolStats().inUse,
+                            "Expected none in use while idle");
+
+  // Fill the pool before reading anything
+  uint8_t buf[100];
+  size_t sent = 0;
+  uint32_t t = millis();
+  while ((EthernetClient::receivePoolStats().exhausted == 0) &&
+         (millis() - t < 2000)) {
+    for (size_t i = 0; i < sizeof(buf); ++i) {
+      buf[i] = static_cast<uint8_t>(sent + i);
+    }
+    sent += client->write(buf, sizeof(buf));
+    client->flush();
+    Ethernet.loop();
+  }
+  stats = EthernetClient::receivePoolStats();
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(1, stats.exhausted, "Expected exhausted");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(1, stats.inUse, "Expected some in use");
+  const size_t inUse = stats.inUse;
+  TEST_ASSERT_FALSE_MESSAGE(EthernetClient::setReceivePool(kChunkSize, 1),
+                            "Expected no resize while in use");
+  TEST_ASSERT_EQUAL_MESSAGE(EBUSY, errno, "Expected EBUSY");
+
+  // Read everything
+  size_t received = 0;
+  t = millis();
+  while ((received < kSize) && (millis() - t < 10000)) {
+    while (sent < kSize) {
+      const size_t n = std::min(sizeof(buf), kSize - sent);
+      for (size_t i = 0; i < n; ++i) {
+        buf[i] = static_cast<uint8_t>(sent + i);
+      }
+      const size_t written = client->write(buf, n);
+      sent += written;
+      if (written < n) {
+        break;
+      }
+    }
+    client->flush();
+
+    const int n = c.read(buf, sizeof(buf));
+    for (int i = 0; i < n; ++i) {
+      TEST_ASSERT_EQUAL_MESSAGE(static_cast<uint8_t>(received + i), buf[i],
+                                "Expected matching data");
+    }
+    received += n;
+    Ethernet.loop();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, received, "Expected all received");
+
+  // Everything is returned once drained
+  stats = EthernetClient::receivePoolStats();
+  TEST_ASSERT_EQUAL_MESSAGE(0, stats.inUse, "Expected none in use after reading");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(inUse, stats.highWatermark, "Expected high watermark");
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(kChunkCount, stats.highWatermark, "Expected bounded high watermark");
+  EthernetClient::resetReceivePoolStats();
+  stats = EthernetClient::receivePoolStats();
+  TEST_ASSERT_EQUAL_MESSAGE(0, stats.highWatermark, "Expected reset high watermark");
+  TEST_ASSERT_EQUAL_MESSAGE(0, stats.exhausted, "Expected reset exhausted");
+
+  c.close();
+  client->close();
+  server->end();
+}
+
+// Tests zero-copy TCP writes.
+static void test_client_write_no_copy() {
+  constexpr uint16_t kPort = 1025;
+  constexpr size_t kSize = TCP_SND_BUF + 17;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+  TEST_ASSERT_TRUE_MESSAGE(client->connect(Ethernet.localIP(), kPort), "Expected connect success");
+  EthernetClient c = server->accept();
+  TEST_ASSERT_TRUE_MESSAGE(static_cast<bool>(c), "Expected accepted connection");
+
+  static uint8_t data[kSize];
+  for (size_t i = 0; i < kSize; ++i) {
+    data[i] = static_cast<uint8_t>(i * 7);
+  }
+
+  // Stream the buffer and wait for all the completions
+  size_t sent = 0;
+  size_t received = 0;
+  int writeCount = 0;
+  int ackedCount = 0;
+  int failedCount = 0;
+  const auto cb = [&ackedCount, &failedCount](bool acked) {
+    if (acked) {
+      ++ackedCount;
+    } else {
+      ++failedCount;
+    }
+  };
+  uint8_t buf[128];
+  const uint32_t t = millis();
+  while (((received < kSize) || (ackedCount < writeCount)) &&
+         (millis() - t < 5000)) {
+    if (sent < kSize) {
+      const size_t n = client->writeNoCopy(&data[sent], kSize - sent, cb);
+      if (n > 0) {
+        sent += n;
+        ++writeCount;
+      }
+    }
+    client->flush();
+
+    const int n = c.read(buf, sizeof(buf));
+    for (int i = 0; i < n; ++i) {
+      TEST_ASSERT_EQUAL_MESSAGE(data[received + i], buf[i], "Expected matching data");
+    }
+    received += n;
+    Ethernet.loop();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, received, "Expected all received");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(2, writeCount, "Expected more than one write");
+  TEST_ASSERT_EQUAL_MESSAGE(writeCount, ackedCount, "Expected all acknowledged");
+  TEST_ASSERT_EQUAL_MESSAGE(0, failedCount, "Expected no failures");
+
+  // Aborting with unacknowledged data fails the write
+  TEST_ASSERT_EQUAL_MESSAGE(10, client->writeNoCopy(data, 10, cb), "Expected write");
+  client->abort();
+  TEST_ASSERT_EQUAL_MESSAGE(writeCount, ackedCount, "Expected no more acknowledged");
+  TEST_ASSERT_EQUAL_MESSAGE(1, failedCount, "Expected failure after abort");
+
+  c.close();
+  server->end();
+}
+
+// Tests the asynchronous client and server callbacks.
+static void test_client_async_events() {
+  constexpr uint16_t kPort = 1025;
+  constexpr char kMessage[] = "Hello, async!";
+  constexpr size_t kSize = sizeof(kMessage) - 1;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  // The server echoes everything back
+  int acceptCount = 0;
+  int serverClosedCount = 0;
+  server->onAccept([&](EthernetClient& c) {
+    ++acceptCount;
+    c.onData([](EthernetClient& c) {
+      uint8_t buf[64];
+      int n;
+      while ((n = c.read(buf, sizeof(buf))) > 0) {
+        TEST_ASSERT_EQUAL_MESSAGE(n, c.write(buf, n), "Expected echo write");
+      }
+      c.flush();
+    });
+    c.onClosed([&serverClosedCount](EthernetClient& c) {
+      (void)c;
+      ++serverClosedCount;
+    });
+  });
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+
+  // The client sends the message and closes when it's all come back
+  int connectedCount = 0;
+  int writableCount = 0;
+  int clientClosedCount = 0;
+  std::vector<uint8_t> received;
+  TEST_ASSERT_TRUE_MESSAGE(client->connectNoWait(Ethernet.localIP(), kPort),
+                           "Expected connect start success");
+  client->onConnected([&](EthernetClient& c) {
+    ++connectedCount;
+    TEST_ASSERT_EQUAL_MESSAGE(kSize, c.write(kMessage, kSize), "Expected write");
+    c.flush();
+  });
+  client->onWritable([&writableCount](EthernetClient& c) {
+    (void)c;
+    ++writableCount;
+  });
+  client->onData([&](EthernetClient& c) {
+    int b;
+    while ((b = c.read()) >= 0) {
+      received.push_back(b);
+    }
+    if (received.size() >= kSize) {
+      c.close();
+    }
+  });
+  client->onClosed([&clientClosedCount](EthernetClient& c) {
+    (void)c;
+    ++clientClosedCount;
+  });
+
+  // Nothing here polls or blocks
+  const uint32_t t = millis();
+  while (((serverClosedCount == 0) || (clientClosedCount == 0)) &&
+         (millis() - t < 5000)) {
+    Ethernet.loop();
+  }
+
+  TEST_ASSERT_EQUAL_MESSAGE(1, acceptCount, "Expected one accept");
+  TEST_ASSERT_EQUAL_MESSAGE(1, connectedCount, "Expected one connect");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(1, writableCount, "Expected writable");
+  TEST_ASSERT_EQUAL_MESSAGE(kSize, received.size(), "Expected echoed size");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(kMessage, received.data(), kSize,
+                                       "Expected echoed data");
+  TEST_ASSERT_EQUAL_MESSAGE(1, serverClosedCount, "Expected server close");
+  TEST_ASSERT_EQUAL_MESSAGE(1, clientClosedCount, "Expected client close");
+  TEST_ASSERT_FALSE_MESSAGE(server->accept(), "Expected no polled accept");
+
+  server->end();
+}
+
+#if QNETHERNET_HAS_COROUTINES
+
+// Echoes everything back until the connection closes.
+static coro::Task coroEchoSession(EthernetClient c) {
+  uint8_t buf[64];
+  size_t n;
+  while ((n = co_await coro::read(c, buf, sizeof(buf))) > 0) {
+    (void)co_await coro::writeFully(c, buf, n);
+  }
+  c.close();
+}
+
+// Sends a message and collects the echo.
+static coro::Task coroEchoClient(EthernetClient* const c, const IPAddress ip,
+                                 const uint16_t port,
+                                 std::vector<uint8_t>* const received,
+                                 int* const state) {
+  if (!co_await coro::connect(*c, ip, port)) {
+    *state = -1;
+    co_return;
+  }
+  *state = 1;
+
+  static const char kMessage[] = "Hello, coroutines!";
+  const size_t written = co_await coro::writeFully(*c, kMessage,
+                                                   sizeof(kMessage) - 1);
+  if (written != sizeof(kMessage) - 1) {
+    *state = -2;
+    co_return;
+  }
+
+  uint8_t buf[8];
+  while (received->size() < written) {
+    const size_t n = co_await coro::read(*c, buf, sizeof(buf));
+    if (n == 0) {
+      break;
+    }
+    received->insert(received->end(), &buf[0], &buf[n]);
+  }
+
+  co_await coro::delay(10);
+  c->close();
+  *state = 2;
+}
+
+// Tests the coroutine awaitables.
+static void test_client_coroutines() {
+  constexpr uint16_t kPort = 1025;
+  constexpr char kMessage[] = "Hello, coroutines!";
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // connect() won't work unless there's a link
+
+  server = compat::make_unique<EthernetServer>();
+  client = compat::make_unique<EthernetClient>();
+
+  server->onAccept([](EthernetClient& c) { coroEchoSession(c); });
+  TEST_ASSERT_TRUE_MESSAGE(server->beginWithReuse(kPort), "Expected listen success");
+
+  std::vector<uint8_t> received;
+  int state = 0;
+  coroEchoClient(client.get(), Ethernet.localIP(), kPort, &received, &state);
+  TEST_ASSERT_NOT_EQUAL_MESSAGE(2, state, "Expected not finished yet");
+
+  const uint32_t t = millis();
+  while (((state == 0) || (state == 1) || (coro::Scheduler::waiting() > 0)) &&
+         (millis() - t < 5000)) {
+    coro::Scheduler::poll();
+  }
+
+  TEST_ASSERT_EQUAL_MESSAGE(2, state, "Expected finished");
+  TEST_ASSERT_EQUAL_MESSAGE(0, coro::Scheduler::waiting(), "Expected none waiting");
+  TEST_ASSERT_EQUAL_MESSAGE(sizeof(kMessage) - 1, received.size(), "Expected echoed size");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(kMessage, received.data(), received.size(),
+                                       "Expected echoed data");
+
+  server->end();
+}
+
+// Waits for a flag and then counts itself as done.
+static coro::Task coroWaitForFlag(const bool* const flag, int* const done) {
+  co_await coro::Until{[flag]() { return *flag; }};
+  ++*done;
+}
+
+// Starts coroutines from inside its condition, the way an event callback run
+// by Ethernet.loop() might, when it's first checked. The condition fits in
+// std::function's local storage and it uses its capture after the new
+// coroutines start waiting.
+static coro::Task coroSpawner(const int count, const bool* const flag,
+                              int* const done) {
+  struct Awaiter final {
+    int count;
+    const bool* flag;
+    int* done;
+
+    bool await_ready() const { return false; }
+    void await_suspend(const std::coroutine_handle<> handle) const {
+      coro::Scheduler::wait(
+          handle, [this]() {
+            for (int i = 0; i < count; ++i) {
+              coroWaitForFlag(flag, done);
+            }
+            return true;
+          });
+    }
+    void await_resume() const {}
+  };
+  co_await Awaiter{count, flag, done};
+}
+
+// Tests that coroutines can start waiting while the scheduler is checking
+// conditions.
+static void test_coroutines_wait_while_polling() {
+  constexpr int kCount = 32;  // Enough to grow the waiter list
+
+  bool flag = false;
+  int done = 0;
+  coroSpawner(kCount, &flag, &done);
+  TEST_ASSERT_EQUAL_MESSAGE(1, coro::Scheduler::waiting(), "Expected 1 waiting");
+
+  coro::Scheduler::poll();
+  TEST_ASSERT_EQUAL_MESSAGE(kCount, coro::Scheduler::waiting(),
+                            "Expected new coroutines waiting");
+  TEST_ASSERT_EQUAL_MESSAGE(0, done, "Expected none done");
+
+  flag = true;
+  coro::Scheduler::poll();
+  TEST_ASSERT_EQUAL_MESSAGE(0, coro::Scheduler::waiting(), "Expected none waiting");
+  TEST_ASSERT_EQUAL_MESSAGE(kCount, done, "Expected all done");
+}
+
+#endif  // QNETHERNET_HAS_COROUTINES
+
+// Tests state from some of the other classes.
+static void test_other_state() {
+  TEST_ASSERT_EQUAL_MESSAGE(DNS_MAX_SERVERS, DNSClient::maxServers(), "Expected default DNS max. servers");
+  TEST_ASSERT_EQUAL_MESSAGE(MEMP_NUM_IGMP_GROUP > 0 ? MEMP_NUM_IGMP_GROUP - 1 : 0,
+                            Ethernet.maxMulticastGroups(),
+                            "Expected default max. multicast groups");
+  TEST_ASSERT_EQUAL_MESSAGE(enet::get_mtu(), Ethernet.mtu(), "Expected default MTU");
+#if QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+  TEST_ASSERT_EQUAL_MESSAGE(enet::get_max_frame_len(), EthernetFrame.maxFrameLen(),
+                            "Expected default max. frame len");
+  TEST_ASSERT_EQUAL_MESSAGE(60, EthernetFrame.minFrameLen(), "Expected default min. frame len");
+#endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+  TEST_ASSERT_EQUAL_MESSAGE(MDNS_MAX_SERVICES, MDNS.maxServices(), "Expected default mDNS max. services");
+}
+
+// Tests EthernetFrame.
+static void test_raw_frames() {
+#if QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+  constexpr uint8_t srcMAC[6]{QNETHERNET_DEFAULT_MAC_ADDRESS};
+  constexpr uint8_t data[10]{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+  (void)Ethernet.setDHCPEnabled(false);
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(), "Expected Ethernet start success");
+
+  // Check that there's nothing there.
+  TEST_ASSERT_EQUAL_MESSAGE(-1, EthernetFrame.parseFrame(), "Expected nothing there");
+
+  // Create and listen
+  EthernetFrame.beginFrame(Ethernet.macAddress(), srcMAC, sizeof(data));
+  TEST_ASSERT_EQUAL_MESSAGE(sizeof(data),
+                            EthernetFrame.write(data, sizeof(data)),
+                            "Expected complete write");
+
+  uint32_t t = millis();  // Current timestamp
+
+  // NOTE: Use >= for receive counts because if this is on a network
+  //       then many frames might have been received or dropped
+
+  TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.endFrame(), "Expected send success");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(1, EthernetFrame.totalReceiveCount(),
+                                       "Expected at least 1 frame");
+
+  // Test that we actually received the packet
+  TEST_ASSERT_EQUAL_MESSAGE(14 + sizeof(data), EthernetFrame.parseFrame(),
+                            "Expected frame of proper size");
+  TEST_ASSERT_EQUAL_MESSAGE(14 + sizeof(data), EthernetFrame.size(),
+                            "Expected correct frame size");
+
+  if (EthernetFrame.size() > 0) {  // Avoid potentially accessing NULL data
+    const uint8_t* const frameData = EthernetFrame.data();
+    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(Ethernet.macAddress(), &frameData[0], 6,
+                                          "Expected matching dest MAC");
+    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(srcMAC, &frameData[6], 6,
+                                          "Expected matching src MAC");
+    TEST_ASSERT_EQUAL_MESSAGE(sizeof(data) >> 8, frameData[12],
+                              "Expected matching data len (1)");
+    TEST_ASSERT_EQUAL_MESSAGE(sizeof(data) & 0xff, frameData[13],
+                              "Expected matching data len (2)");
+    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(data, &frameData[14], 10,
+                                          "Expected matching data");
+
+    TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(t, EthernetFrame.receivedTimestamp(),
+                                         "Expected valid timestamp");
+  }
+#endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+}
+
+// Tests raw frame receive queueing.
+static void test_raw_frames_receive_queueing() {
+#if QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+  (void)Ethernet.setDHCPEnabled(false);
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(), "Expected Ethernet start success");
+
+  TEST_ASSERT_EQUAL_MESSAGE(1, EthernetFrame.receiveQueueCapacity(),
+                            "Expected default queue capacity");
+
+  uint8_t buf[15];
+  (void)std::copy_n(Ethernet.macAddress(), 6, &buf[0]);
+  (void)std::copy_n(Ethernet.macAddress(), 6, &buf[6]);
+  buf[12] = 0;  // Length (16-bit)
+  buf[13] = 1;
+
+  // NOTE: Use >= for receive counts because if this is on a network
+  //       then many frames might have been received or dropped
+
+  // Send two frames
+  buf[14] = 1;
   TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.send(buf, sizeof(buf)),
                            "Expected frame 1 send success");
   TEST_ASSERT_EQUAL_MESSAGE(1, EthernetFrame.receiveQueueCapacity(),
@@ -1784,9 +3738,352 @@ static void test_raw_frames_receive_queueing() {
                                        "Expected at least 1 dropped");
   TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(4, EthernetFrame.totalReceiveCount(),
                                        "Expected at least 4 total");
+
+  // Clearing also releases the current frame and the queued ones
+  buf[14] = 5;
+  TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.send(buf, sizeof(buf)),
+                           "Expected frame 5 send success");
+  TEST_ASSERT_EQUAL_MESSAGE(1, EthernetFrame.receiveQueueSize(),
+                            "Expected queue size 1");
+  EthernetFrame.clear();
+  TEST_ASSERT_EQUAL_MESSAGE(0, EthernetFrame.receiveQueueSize(),
+                            "Expected queue size 0 after clear");
+  TEST_ASSERT_EQUAL_MESSAGE(0, EthernetFrame.receiveQueueBytes(),
+                            "Expected no queued bytes after clear");
+  TEST_ASSERT_EQUAL_MESSAGE(0, EthernetFrame.size(),
+                            "Expected no current frame after clear");
+  TEST_ASSERT_LESS_THAN_MESSAGE(0, EthernetFrame.read(),
+                                "Expected nothing to read after clear");
+#endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+}
+
+// Tests the raw frame receive queue byte capacity and maximum receive size.
+static void test_raw_frames_receive_byte_capacity() {
+#if QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+  (void)Ethernet.setDHCPEnabled(false);
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(), "Expected Ethernet start success");
+
+  uint8_t buf[15];
+  (void)std::copy_n(Ethernet.macAddress(), 6, &buf[0]);
+  (void)std::copy_n(Ethernet.macAddress(), 6, &buf[6]);
+  buf[12] = 0;  // Length (16-bit)
+  buf[13] = 1;
+
+  EthernetFrame.setReceiveQueueCapacity(4);
+  EthernetFrame.setReceiveQueueByteCapacity(2 * sizeof(buf));
+  TEST_ASSERT_EQUAL_MESSAGE(2 * sizeof(buf),
+                            EthernetFrame.receiveQueueByteCapacity(),
+                            "Expected byte capacity");
+
+  // Only two frames fit
+  const uint32_t dropped = EthernetFrame.droppedReceiveCount();
+  for (uint8_t i = 1; i <= 3; ++i) {
+    buf[14] = i;
+    TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.send(buf, sizeof(buf)),
+                             "Expected frame send success");
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(2, EthernetFrame.receiveQueueSize(),
+                            "Expected queue size 2");
+  TEST_ASSERT_EQUAL_MESSAGE(2 * sizeof(buf), EthernetFrame.receiveQueueBytes(),
+                            "Expected queued bytes");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(dropped + 1,
+                                       EthernetFrame.droppedReceiveCount(),
+                                       "Expected at least 1 more dropped");
+  TEST_ASSERT_EQUAL_MESSAGE(sizeof(buf), EthernetFrame.parseFrame(),
+                            "Expected frame");
+  TEST_ASSERT_EQUAL_MESSAGE(2, EthernetFrame.data()[14], "Expected frame 2");
+  TEST_ASSERT_EQUAL_MESSAGE(sizeof(buf), EthernetFrame.receiveQueueBytes(),
+                            "Expected fewer queued bytes");
+
+  // Shrinking the byte capacity drops and counts the oldest frames
+  const uint32_t droppedBeforeShrink = EthernetFrame.droppedReceiveCount();
+  EthernetFrame.setReceiveQueueByteCapacity(sizeof(buf) - 1);
+  TEST_ASSERT_EQUAL_MESSAGE(0, EthernetFrame.receiveQueueSize(),
+                            "Expected queue size 0");
+  TEST_ASSERT_EQUAL_MESSAGE(droppedBeforeShrink + 1,
+                            EthernetFrame.droppedReceiveCount(),
+                            "Expected 1 more dropped");
+
+  // Larger frames are truncated
+  EthernetFrame.setReceiveQueueByteCapacity(0);
+  EthernetFrame.clear();
+  EthernetFrame.setMaxReceiveSize(14);
+  const uint32_t truncated = EthernetFrame.truncatedReceiveCount();
+  TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.send(buf, sizeof(buf)),
+                           "Expected frame send success");
+  TEST_ASSERT_EQUAL_MESSAGE(truncated + 1,
+                            EthernetFrame.truncatedReceiveCount(),
+                            "Expected 1 more truncated");
+  TEST_ASSERT_EQUAL_MESSAGE(14, EthernetFrame.parseFrame(),
+                            "Expected truncated frame");
+
+  EthernetFrame.setReceiveQueueCapacity(1);
 #endif  // QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
 }
 
+#if defined(QNETHERNET_INTERNAL_DRIVER_HOST)
+// Reflects frames received by the peer netif back to the sender.
+static err_t peerReflectInput(struct pbuf* const p, struct netif* const netif) {
+  uint8_t buf[MAX_FRAME_LEN];
+  const u16_t len = pbuf_copy_partial(p, buf, p->tot_len - ETH_PAD_SIZE,
+                                      ETH_PAD_SIZE);
+  (void)std::copy_n(&buf[6], 6, &buf[0]);
+  (void)std::copy_n(netif->hwaddr, 6, &buf[6]);
+  (void)pbuf_take_at(p, buf, len, ETH_PAD_SIZE);
+  (void)netif->linkoutput(netif, p);
+  (void)pbuf_free(p);
+  return ERR_OK;
+}
+#endif  // QNETHERNET_INTERNAL_DRIVER_HOST
+
+// Tests the host driver's virtual wire.
+static void test_host_wire() {
+#if defined(QNETHERNET_INTERNAL_DRIVER_HOST) && \
+    QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+  constexpr uint8_t peerMAC[6]{0x02, 0, 0, 0, 0, 0x01};
+  constexpr uint8_t data[10]{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  constexpr uint32_t kLatency = 20;  // In milliseconds
+
+  (void)Ethernet.setDHCPEnabled(false);
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(), "Expected Ethernet start success");
+
+  // Attach a peer that reflects everything it receives
+  (void)std::copy_n(peerMAC, 6, s_peerNetif.hwaddr);
+  s_peerNetif.input = peerReflectInput;
+  TEST_ASSERT_TRUE_MESSAGE(host::attach_netif(&s_peerNetif),
+                           "Expected peer attach success");
+  TEST_ASSERT_FALSE_MESSAGE(host::attach_netif(&s_peerNetif),
+                            "Expected no double attach");
+
+  host::WireConfig config;
+  config.latencyMicros = kLatency * 1000;
+  host::set_wire_config(config);
+  host::reset_wire_stats();
+
+  EthernetFrame.beginFrame(peerMAC, Ethernet.macAddress(), sizeof(data));
+  TEST_ASSERT_EQUAL_MESSAGE(sizeof(data),
+                            EthernetFrame.write(data, sizeof(data)),
+                            "Expected complete write");
+  const uint32_t t = millis();
+  TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.endFrame(), "Expected send success");
+
+  int size;
+  while (((size = EthernetFrame.parseFrame()) < 0) &&
+         ((millis() - t) < 10 * kLatency)) {
+    yield();
+  }
+  const uint32_t elapsed = millis() - t;
+  TEST_ASSERT_EQUAL_MESSAGE(MIN_FRAME_LEN, size,
+                            "Expected padded reflected frame");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(2 * kLatency, elapsed,
+                                       "Expected round-trip latency");
+
+  const uint8_t* const frameData = EthernetFrame.data();
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(Ethernet.macAddress(), &frameData[0], 6,
+                                        "Expected matching dest MAC");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(peerMAC, &frameData[6], 6,
+                                        "Expected matching src MAC");
+  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(data, &frameData[14], sizeof(data),
+                                        "Expected matching data");
+
+  const host::WireStats stats = host::get_wire_stats();
+  TEST_ASSERT_EQUAL_MESSAGE(2, stats.framesSent, "Expected 2 sent");
+  TEST_ASSERT_EQUAL_MESSAGE(2, stats.framesDelivered, "Expected 2 delivered");
+  TEST_ASSERT_EQUAL_MESSAGE(0, stats.framesDropped, "Expected none dropped");
+
+  // Frames for other addresses are filtered
+  const uint8_t otherMAC[6]{0x02, 0, 0, 0, 0, 0x02};
+  EthernetFrame.beginFrame(otherMAC, peerMAC, sizeof(data));
+  (void)EthernetFrame.write(data, sizeof(data));
+  TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.endFrame(), "Expected send success");
+  const uint32_t t2 = millis();
+  while ((millis() - t2) < 4 * kLatency) {
+    yield();
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(1, host::get_wire_stats().framesFiltered,
+                            "Expected 1 filtered");
+#endif  // QNETHERNET_INTERNAL_DRIVER_HOST && QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+}
+
+// Tests the per-loop receive budget and receive loop statistics.
+static void test_rx_budget() {
+#if defined(QNETHERNET_INTERNAL_DRIVER_HOST) && \
+    QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+  constexpr uint8_t peerMAC[6]{0x02, 0, 0, 0, 0, 0x01};
+  constexpr uint8_t data[10]{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  constexpr int kBudget = 2;
+  constexpr uint32_t kFrames = 5;
+
+  (void)Ethernet.setDHCPEnabled(false);
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(), "Expected Ethernet start success");
+
+  // Attach a peer that reflects everything it receives
+  (void)std::copy_n(peerMAC, 6, s_peerNetif.hwaddr);
+  s_peerNetif.input = peerReflectInput;
+  TEST_ASSERT_TRUE_MESSAGE(host::attach_netif(&s_peerNetif),
+                           "Expected peer attach success");
+
+  RxSettings settings;
+  settings.budget = kBudget;
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.setRxSettings(settings),
+                           "Expected settings accepted");
+  Ethernet.resetRxLoopStats();
+
+  for (uint32_t i = 0; i < kFrames; ++i) {
+    EthernetFrame.beginFrame(peerMAC, Ethernet.macAddress(), sizeof(data));
+    (void)EthernetFrame.write(data, sizeof(data));
+    TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.endFrame(), "Expected send success");
+  }
+
+  uint32_t t = millis();
+  while ((Ethernet.rxLoopStats().frames < kFrames) && ((millis() - t) < 1000)) {
+    Ethernet.loop();
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(kBudget,
+                                      Ethernet.rxLoopStats().lastFrames,
+                                      "Expected frames within budget");
+  }
+
+  const RxLoopStats stats = Ethernet.rxLoopStats();
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(kFrames, stats.frames,
+                                       "Expected all frames processed");
+  TEST_ASSERT_EQUAL_MESSAGE(kBudget, stats.maxFrames,
+                            "Expected max. frames equal to the budget");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(2, stats.budgetHits,
+                                       "Expected budget hits");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(3, stats.loops, "Expected 3 loops");
+
+  // Adaptive polling starts once the rate is reached and stops when it drops
+  settings.budget   = 0;
+  settings.pollRate = 10;
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.setRxSettings(settings),
+                           "Expected polling settings accepted");
+  TEST_ASSERT_FALSE_MESSAGE(host::is_rx_polling(), "Expected not polling");
+  for (uint32_t i = 0; i < kFrames; ++i) {
+    EthernetFrame.beginFrame(peerMAC, Ethernet.macAddress(), sizeof(data));
+    (void)EthernetFrame.write(data, sizeof(data));
+    TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.endFrame(), "Expected send success");
+  }
+  t = millis();
+  while (!host::is_rx_polling() && ((millis() - t) < 1000)) {
+    Ethernet.loop();
+  }
+  TEST_ASSERT_TRUE_MESSAGE(host::is_rx_polling(), "Expected polling");
+  t = millis();
+  while (host::is_rx_polling() && ((millis() - t) < 1000)) {
+    Ethernet.loop();
+  }
+  TEST_ASSERT_FALSE_MESSAGE(host::is_rx_polling(),
+                            "Expected interrupt-driven again");
+  settings.pollRate = 0;
+
+  // Coalescing is only accepted by drivers that support it
+  settings.coalesceFrames = 4;
+  settings.coalesceMicros = 100;
+  TEST_ASSERT_EQUAL_MESSAGE(
+      Ethernet.driverCapabilities().isRxCoalescingSettable,
+      Ethernet.setRxSettings(settings),
+      "Expected coalescing accepted only if settable");
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.setRxSettings(RxSettings{}),
+                           "Expected default settings accepted");
+#endif  // QNETHERNET_INTERNAL_DRIVER_HOST && QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+}
+
+// Tests that software checksums are only turned off where they're offloaded.
+static void test_checksum_offload() {
+  constexpr uint16_t kPort = 1025;
+
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(kStaticIP, kSubnetMask, kGateway),
+                           "Expected successful Ethernet start");
+  Ethernet.setLinkState(true);  // send() won't work unless there's a link
+
+  const DriverCapabilities& dc = Ethernet.driverCapabilities();
+
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+  const struct netif* const netif = enet::netif();
+  TEST_ASSERT_EQUAL_MESSAGE(
+      !dc.isTxChecksumOffloadable,
+      NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_UDP),
+      "Expected UDP checksum generation only if not offloaded");
+  TEST_ASSERT_EQUAL_MESSAGE(
+      !dc.isTxChecksumOffloadable,
+      NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_IP),
+      "Expected IP checksum generation only if not offloaded");
+  TEST_ASSERT_EQUAL_MESSAGE(
+      !dc.isRxChecksumOffloadable,
+      NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_CHECK_TCP),
+      "Expected TCP checksum checking only if not offloaded");
+  TEST_ASSERT_EQUAL_MESSAGE(
+      !dc.isRxChecksumOffloadable,
+      NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_CHECK_IP),
+      "Expected IP checksum checking only if not offloaded");
+#endif  // LWIP_CHECKSUM_CTRL_PER_NETIF
+
+  Ethernet.resetChecksumOffloadStats();
+
+  // Send a broadcast so that it goes out the driver
+  udp = compat::make_unique<EthernetUDP>();
+  TEST_ASSERT_TRUE_MESSAGE(udp->send(IPAddress{192, 168, 0, 255}, kPort,
+                                     nullptr, 0),
+                           "Expected packet send success");
+  Ethernet.loop();
+
+  const ChecksumOffloadStats stats = Ethernet.checksumOffloadStats();
+  if (dc.isTxChecksumOffloadable) {
+    TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(1, stats.txFrames,
+                                         "Expected offloaded TX frame");
+  } else {
+    TEST_ASSERT_EQUAL_MESSAGE(0, stats.txFrames, "Expected no TX offloads");
+  }
+  if (!dc.isRxChecksumOffloadable) {
+    TEST_ASSERT_EQUAL_MESSAGE(0, stats.rxFrames, "Expected no RX offloads");
+  }
+}
+
+// Tests hardware frame timestamps.
+static void test_frame_timestamps() {
+#if defined(QNETHERNET_INTERNAL_DRIVER_HOST) && \
+    QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+  constexpr uint8_t peerMAC[6]{0x02, 0, 0, 0, 0, 0x01};
+  constexpr uint8_t data[10]{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  constexpr uint32_t kLatency = 5;  // In milliseconds
+
+  (void)Ethernet.setDHCPEnabled(false);
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.begin(), "Expected Ethernet start success");
+  TEST_ASSERT_TRUE_MESSAGE(Ethernet.driverCapabilities().isFrameTimestampable,
+                           "Expected timestampable frames");
+
+  // Attach a peer that reflects everything it receives
+  (void)std::copy_n(peerMAC, 6, s_peerNetif.hwaddr);
+  s_peerNetif.input = peerReflectInput;
+  TEST_ASSERT_TRUE_MESSAGE(host::attach_netif(&s_peerNetif),
+                           "Expected peer attach success");
+
+  host::WireConfig config;
+  config.latencyMicros = kLatency * 1000;
+  host::set_wire_config(config);
+
+  EthernetFrame.beginFrame(peerMAC, Ethernet.macAddress(), sizeof(data));
+  (void)EthernetFrame.write(data, sizeof(data));
+  TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.endFrame(), "Expected send success");
+
+  const uint32_t t = millis();
+  while ((EthernetFrame.parseFrame() < 0) && ((millis() - t) < 10 * kLatency)) {
+    yield();
+  }
+
+  uint64_t rxTimestamp;
+  uint64_t txTimestamp;
+  TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.receivedHardwareTimestamp(rxTimestamp),
+                           "Expected RX timestamp");
+  TEST_ASSERT_TRUE_MESSAGE(EthernetFrame.sentHardwareTimestamp(txTimestamp),
+                           "Expected TX timestamp");
+  TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(uint64_t{2} * kLatency * 1'000'000,
+                                       rxTimestamp - txTimestamp,
+                                       "Expected round-trip latency");
+#endif  // QNETHERNET_INTERNAL_DRIVER_HOST && QNETHERNET_ENABLE_RAW_FRAME_SUPPORT
+}
+
 // Tests ping.
 static void test_ping() {
   constexpr char kHost[]{"www.google.com"};
@@ -1860,6 +4157,13 @@ void setup() {
   RUN_TEST(test_interface_listener);
   RUN_TEST(test_udp);
   RUN_TEST(test_udp_receive_queueing);
+  RUN_TEST(test_udp_zero_copy_receive);
+  RUN_TEST(test_udp_stop_releases_pbufs);
+  RUN_TEST(test_udp_receive_batch);
+  RUN_TEST(test_udp_zero_copy_send);
+  RUN_TEST(test_udp_send_batch);
+  RUN_TEST(test_udp_receive_callback);
+  RUN_TEST(test_udp_receive_byte_capacity);
   RUN_TEST(test_udp_receive_timestamp);
   RUN_TEST(test_udp_state);
   RUN_TEST(test_udp_options);
@@ -1881,9 +4185,35 @@ void setup() {
   RUN_TEST(test_server_construct_int_port);
   RUN_TEST(test_server_zero_port);
   RUN_TEST(test_server_accept);
+  RUN_TEST(test_server_available_round_robin);
+  RUN_TEST(test_server_broadcast);
+  RUN_TEST(test_server_broadcast_retry);
+  RUN_TEST(test_server_syn_cookies);
+  RUN_TEST(test_server_connection_churn);
+  RUN_TEST(test_server_time_wait_reuse);
+  RUN_TEST(test_client_connection_pool);
+  RUN_TEST(test_client_window_autotune);
+  RUN_TEST(test_client_cork);
+  RUN_TEST(test_client_tcp_info);
+  RUN_TEST(test_client_zero_copy_receive);
+  RUN_TEST(test_client_zero_copy_empty_pbufs);
+  RUN_TEST(test_client_zero_copy_close_unread);
+  RUN_TEST(test_client_close_refused);
+  RUN_TEST(test_client_receive_pool);
+  RUN_TEST(test_client_write_no_copy);
+  RUN_TEST(test_client_async_events);
+#if QNETHERNET_HAS_COROUTINES
+  RUN_TEST(test_client_coroutines);
+  RUN_TEST(test_coroutines_wait_while_polling);
+#endif  // QNETHERNET_HAS_COROUTINES
   RUN_TEST(test_other_state);
   RUN_TEST(test_raw_frames);
   RUN_TEST(test_raw_frames_receive_queueing);
+  RUN_TEST(test_raw_frames_receive_byte_capacity);
+  RUN_TEST(test_host_wire);
+  RUN_TEST(test_rx_budget);
+  RUN_TEST(test_checksum_offload);
+  RUN_TEST(test_frame_timestamps);
   RUN_TEST(test_ping);
   RUN_TEST(test_ping_reply);
   UNITY_END();
@@ -118,6 +118,41 @@ static void test_NullPrint() {
                             "Expected max. bytes available to write");
 }
 
+// Tests the BufferedPrint class.
+static void test_BufferedPrint() {
+  s_outputString.clear();
+  StringPrint sp{s_outputString};
+  {
+    BufferedPrint<8> bp{sp};
+    TEST_ASSERT_EQUAL_MESSAGE(8, bp.availableForWrite(),
+                              "Expected empty buffer");
+    TEST_ASSERT_EQUAL_MESSAGE(3, bp.print("abc"), "Expected print");
+    TEST_ASSERT_EQUAL_MESSAGE(1, bp.write('d'), "Expected write");
+    TEST_ASSERT_EQUAL_MESSAGE(4, bp.buffered(), "Expected buffered");
+    TEST_ASSERT_EQUAL_MESSAGE("", s_outputString, "Expected nothing written");
+
+    // Filling the buffer writes it all at once
+    TEST_ASSERT_EQUAL_MESSAGE(6, bp.print("efghij"), "Expected print");
+    TEST_ASSERT_EQUAL_MESSAGE("abcdefgh", s_outputString,
+                              "Expected full buffer written");
+    TEST_ASSERT_EQUAL_MESSAGE(2, bp.buffered(), "Expected the rest buffered");
+
+    bp.flush();
+    TEST_ASSERT_EQUAL_MESSAGE("abcdefghij", s_outputString,
+                              "Expected all written after flush");
+    TEST_ASSERT_EQUAL_MESSAGE(0, bp.buffered(), "Expected empty buffer");
+
+    // Large writes go straight through
+    TEST_ASSERT_EQUAL_MESSAGE(10, bp.print("0123456789"), "Expected print");
+    TEST_ASSERT_EQUAL_MESSAGE("abcdefghij0123456789", s_outputString,
+                              "Expected large write passed through");
+
+    TEST_ASSERT_EQUAL_MESSAGE(1, bp.print('z'), "Expected print");
+  }
+  TEST_ASSERT_EQUAL_MESSAGE("abcdefghij0123456789z", s_outputString,
+                            "Expected buffer written on destruction");
+}
+
 // Makes a 32-bit IP address in network order.
 ATTRIBUTE_NODISCARD
 static inline constexpr uint32_t makeIP(uint8_t a, uint8_t b, uint8_t c,
@@ -162,6 +197,7 @@ void setup() {
   RUN_TEST(test_writeMagic);
   RUN_TEST(test_StdioPrint);
   RUN_TEST(test_NullPrint);
+  RUN_TEST(test_BufferedPrint);
   RUN_TEST(test_isBroadcast);
   UNITY_END();
 }